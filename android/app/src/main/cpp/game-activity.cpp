@@ -7,6 +7,8 @@
 #include <android_native_app_glue.h>
 #include <aaudio/AAudio.h>
 #include <string>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <cmath>
 #include <unistd.h>
@@ -32,6 +34,7 @@ static const int INPUT_BUFFER_SIZE = 100;
 
 static ANativeWindow *window = nullptr;
 static AAssetManager *manager = nullptr;
+static const char* dataPath = nullptr;
 EGLDisplay display;
 EGLContext context;
 EGLSurface surface;
@@ -89,7 +92,44 @@ PLATFORM_LOG(AndroidLog) {
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "%s", str);
 }
 
+// Files the game writes go to internal storage, the APK assets are read only.
+// The shader cache is the only one, other reads go straight to the assets.
+static bool is_data_file(const char* path) {
+    return strcmp(path, SHADER_CACHE_PATH) == 0;
+}
+
+static FILE* open_data_file(const char* path, const char* mode) {
+    char fullPath[1024];
+    snprintf(fullPath, sizeof(fullPath), "%s/%s", dataPath, strip_path(path));
+    return fopen(fullPath, mode);
+}
+
+PLATFORM_WRITE_FILE(WriteFile) {
+    FILE* file = open_data_file(path, "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Can't write %s", path);
+        return;
+    }
+
+    size_t written = fwrite(memory, 1, size, file);
+    fclose(file);
+
+    HOKI_ASSERT(written == size);
+}
+
 PLATFORM_READ_FILE(ReadFile) {
+    FILE* file = is_data_file(path) ? open_data_file(path, "rb") : nullptr;
+    if (file != nullptr) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        size_t read = fread(memory, 1, (size_t) size, file);
+        fclose(file);
+
+        HOKI_ASSERT(read == (size_t) size);
+        return;
+    }
+
     AAsset* asset = AAssetManager_open(manager, strip_path(path), AASSET_MODE_STREAMING);
     off_t size = AAsset_getLength(asset);
     off_t start = 0;
@@ -102,7 +142,19 @@ PLATFORM_READ_FILE(ReadFile) {
 }
 
 PLATFORM_GET_FILE_SIZE(GetFileSize) {
+    FILE* file = is_data_file(path) ? open_data_file(path, "rb") : nullptr;
+    if (file != nullptr) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+
+        return (size_t) size;
+    }
+
     AAsset* asset = AAssetManager_open(manager, strip_path(path), AASSET_MODE_STREAMING);
+    if (asset == nullptr) {
+        return 0;
+    }
     off_t size = AAsset_getLength(asset);
 
     AAsset_close(asset);
@@ -452,6 +504,7 @@ void android_main(struct android_app* state) {
     state->onInputEvent = handle_input;
 
     manager = state->activity->assetManager;
+    dataPath = state->activity->internalDataPath;
 
     size_t permanentSize = SIZE_MB(64);
     size_t transientSize = SIZE_MB(128);
@@ -467,6 +520,7 @@ void android_main(struct android_app* state) {
     memory.TransientStorage = malloc(transientSize);
     memory.GetFileSize = &GetFileSize;
     memory.ReadFile = &ReadFile;
+    memory.WriteFile = &WriteFile;
     memory.Log = &AndroidLog;
     memory.AddWorkEntry = AndroidPushJob;
     memory.CompleteAllQueueWork = AndroidCompleteAllWork;
@@ -544,7 +598,6 @@ void android_main(struct android_app* state) {
             game_window_info localWindowInfo = {};
             localWindowInfo.Width = w;
             localWindowInfo.Height = h;
-            RenderContext.Commands.Count = 0;
             GameMain(memory,
                      localWindowInfo,
                      RenderContext,
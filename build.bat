@@ -12,14 +12,21 @@ SET RendererLinkerFlags=opengl32.lib
 SET PlatformLinkerFlags=user32.lib gdi32.lib winmm.lib xaudio2.lib opengl32.lib
 SET GameExportFlags=/EXPORT:GameMain /EXPORT:GameGetSoundSamples
 SET RendererExportFlags=/EXPORT:RendererMain /EXPORT:RendererLoadExtensions
+SET NullRendererExportFlags=%RendererExportFlags% /EXPORT:NullRendererGetTrace /EXPORT:NullRendererFormatCall
 
 IF NOT EXIST build mkdir build && xcopy /E res build\res\
 cd build
 
-DEL /Q "game_*.pdb" "renderer_*.pdb" 1> NUL 2>NUL
+DEL /Q "game_*.pdb" "renderer_*.pdb" "null_renderer_*.pdb" 1> NUL 2>NUL
 
 PUSHD "..\glsl\"
 FOR %%F IN ("*") DO CALL :SHADER_PROCESS %%F
+REM PBR programs are specialized per skinning and material map combination
+FOR /L %%S IN (0,1,1) DO (
+  CALL :SHADER_VARIANT vertexshader.vert pbr_skinned%%S.vert "SHADER_SKINNED=%%S"
+  CALL :SHADER_VARIANT vertex_shader_inst.vert pbr_inst_skinned%%S.vert "SHADER_SKINNED=%%S"
+)
+FOR /L %%M IN (0,1,7) DO CALL :SHADER_VARIANT pbr.frag pbr_maps%%M.frag "PBR_MAPS=%%M"
 POPD
 
 SET FAILED = 0
@@ -27,10 +34,22 @@ cl %ExternalIncludes% %CommonCompilerFlags% %GameLinkerFlags%  "..\game\game_mai
 if %ERRORLEVEL% neq 0 (SET FAILED=%ERRORLEVEL%)
 cl %ExternalIncludes% %CommonCompilerFlags% %RendererLinkerFlags% "..\ogl\ogl_main.cpp" /LD /link %CommonLinkerFlags% /PDB:renderer_%PDB_SUFFIX%.pdb %RendererExportFlags%
 if %ERRORLEVEL% neq 0 (SET FAILED=%ERRORLEVEL%)
+cl %ExternalIncludes% %CommonCompilerFlags% "..\null\null_main.cpp" /LD /link %CommonLinkerFlags% /PDB:null_renderer_%PDB_SUFFIX%.pdb %NullRendererExportFlags%
+if %ERRORLEVEL% neq 0 (SET FAILED=%ERRORLEVEL%)
 cl %ExternalIncludes% %CommonCompilerFlags% %PlatformCompilerFlags% "..\windows\win_main.cpp" /link %CommonLinkerFlags% %PlatformLinkerFlags%
 if %ERRORLEVEL% neq 0 (SET FAILED=%ERRORLEVEL%)
 GOTO EOF
 
+:SHADER_VARIANT
+SET INTERMEDIARY_FILE=%~n1.i
+SET DEST_PATH_GL="..\res\shaders\preprocessed\gl\%~2"
+SET DEST_PATH_GLES="..\res\shaders\preprocessed\gles\%~2"
+cl /I "incl" /EP /D%~3 /P "%~1"
+MOVE /Y %INTERMEDIARY_FILE% %DEST_PATH_GL%
+cl /I "incl" /EP /DGLES=1 /D%~3 /P "%~1"
+MOVE /Y %INTERMEDIARY_FILE% %DEST_PATH_GLES%
+EXIT /B 0
+
 :SHADER_PROCESS
 SET FILENAME=%~1
 SET SOURCE_PATH="%~1"
@@ -1,7 +1,6 @@
 #include "anim_system.h"
 
 namespace AnimationSystem {
-static run_id NextRunId;
 
 void reset_frame_animation_data(game_entity* entityPtr, size_t entityCount)
 {
@@ -20,29 +19,18 @@ void reset_frame_animation_data(game_entity* entityPtr, size_t entityCount)
   }
 }
 
-void reset_frame_animation_data(instanced_entity* entityPtr, size_t entityCount)
-{
-  for (size_t i = 0; i < entityCount; i++) {
-    instanced_entity& entity = entityPtr[i];
-    for (uint32_t j = 0; j < entity.BoneCount; j++) {
-      entity.Bones[j].Scale = V3_ZERO;
-      entity.Bones[j].Translation = V3_ZERO;
-      entity.Bones[j].Rotation = QUAT_ZERO;
-#if 0
-      // TODO: Check if these need to be reset
-      entity.Bones[j].Transform = MAT4_ZERO;
-      entity.BoneTransforms[j] = MAT4_ZERO;
-#endif
-    }
-  }
-}
-
 void reset_animator(animator& animator)
 {
-  for (size_t i = 0; i < ANIMATOR_MAX_ANIMATIONS; i++) {
-    animator.RunningAnimations[i].Loops = 0;
-    animator.RunningAnimations[i].EntityCount = 0;
-    animator.RunningAnimations[i].Animation = nullptr;
+  // Push in reverse so slots are handed out from the front
+  animator.FreeRunCount = 0;
+  for (size_t i = ANIMATOR_MAX_ANIMATIONS - 1; i > 0; i--) {
+    animation_run& run = animator.RunningAnimations[i];
+    run.Id = ANIMATION_NO_ID;
+    run.Loops = 0;
+    run.EntityCount = 0;
+    run.Animation = nullptr;
+    animator.RunGenerations[i]++;
+    animator.FreeRuns[animator.FreeRunCount++] = (uint32_t)i;
   }
   animation_run* emptyRun = animator.RunningAnimations;
   emptyRun->Id = ANIMATION_NO_ID;
@@ -59,12 +47,43 @@ void reset_animator(animator& animator)
   emptyRun->EntityCount = 999;
 }
 
+size_t get_max_channel_count(const Asset::model& model)
+{
+  size_t result = 0;
+  for (size_t i = 0; i < model.AnimationCount; i++) {
+    if (model.Animations[i].ChannelCount > result) {
+      result = model.Animations[i].ChannelCount;
+    }
+  }
+
+  return result;
+}
+
+// Channel buffers are allocated once per slot here, starting a run only hands
+// out a slot from the free list
+void init_animator(animator& animator, const size_t maxChannelCount)
+{
+  animator.MaxChannelCount = maxChannelCount;
+  for (size_t i = 1; i < ANIMATOR_MAX_ANIMATIONS; i++) {
+    animation_run& run = animator.RunningAnimations[i];
+    run.ChannelKeyframes =
+      (uint32_t*)allocate_t(sizeof(uint32_t) * maxChannelCount);
+    run.ChannelTransforms = (animation_update_transform*)allocate_t(
+      sizeof(animation_update_transform) * maxChannelCount);
+  }
+
+  reset_animator(animator);
+}
+
 animation_run* get_run(const run_id runId, const animator& animator)
 {
-  animation_run* run = (animation_run*)animator.RunningAnimations +
-                       (runId % ANIMATOR_MAX_ANIMATIONS);
-  if (run->Id == runId) {
-    return run;
+  // Stale and unset ids resolve to the empty run
+  const uint32_t index = runId & ANIMATION_RUN_INDEX_MASK;
+  if (runId != ANIMATION_NO_ID && index < ANIMATOR_MAX_ANIMATIONS) {
+    animation_run* run = (animation_run*)animator.RunningAnimations + index;
+    if (run->Id == runId) {
+      return run;
+    }
   }
 
   return (animation_run*)&animator.RunningAnimations[0];
@@ -102,43 +121,64 @@ const animation& find_animation(const char* name,
 
 run_id setup_animation(const animation& animation, animator& animator)
 {
+  if (animator.FreeRunCount == 0) {
+    HOKI_WARN_MESSAGE(false,
+                      "Animator out of run slots (%zu), not starting %s",
+                      ANIMATOR_MAX_ANIMATIONS - 1,
+                      animation.Name.Value);
+    return ANIMATION_NO_ID;
+  }
+  if (animation.ChannelCount > animator.MaxChannelCount) {
+    HOKI_WARN_MESSAGE(false,
+                      "%s has %zu channels, animator slots fit %zu",
+                      animation.Name.Value,
+                      animation.ChannelCount,
+                      animator.MaxChannelCount);
+    return ANIMATION_NO_ID;
+  }
+
+  const uint32_t index = animator.FreeRuns[--animator.FreeRunCount];
+  animation_run& runSlot = animator.RunningAnimations[index];
+
   animation_run newRun = {};
-  newRun.Id = ANIMATION_NO_ID;
+  newRun.Id = index | (animator.RunGenerations[index]
+                       << ANIMATION_RUN_INDEX_BITS);
   newRun.Animation = &animation;
   newRun.Speed = ANIMATION_DEFAULT_SPEED;
   newRun.Loops = ANIMATION_LOOPS_INFINITE;
   newRun.LoopStyle = animation_loop_style::WRAP;
   newRun.Weight = ANIMATION_FULL_WEIGHT;
   newRun.ChannelCount = animation.ChannelCount;
-
-  HOKI_ASSERT(newRun.StartDelay >= 0.0f);
-  animation_run* handle = nullptr;
-
-  uint32_t index = 0;
-  for (size_t i = 0; i < ANIMATOR_MAX_ANIMATIONS; i++) {
-    animation_run& runSlot = animator.RunningAnimations[i];
-    if (run_slot_free(&runSlot)) {
-      newRun.ChannelKeyframes = (uint32_t*)reallocate_t(
-        runSlot.ChannelKeyframes,
-        sizeof(uint32_t) * newRun.Animation->ChannelCount);
-      newRun.ChannelTransforms = (animation_update_transform*)reallocate_t(
-        runSlot.ChannelTransforms,
-        sizeof(animation_update_transform) * newRun.Animation->ChannelCount);
-      for (size_t c = 0; c < newRun.Animation->ChannelCount; c++) {
-        newRun.ChannelKeyframes[c] = 0;
-        newRun.ChannelTransforms[c] = {};
-      }
-      runSlot = newRun;
-      handle = &runSlot;
-      index = (uint32_t)i;
-      break;
-    }
+  newRun.ChannelKeyframes = runSlot.ChannelKeyframes;
+  newRun.ChannelTransforms = runSlot.ChannelTransforms;
+  for (size_t c = 0; c < newRun.ChannelCount; c++) {
+    newRun.ChannelKeyframes[c] = 0;
+    newRun.ChannelTransforms[c] = {};
   }
-  HOKI_ASSERT_MESSAGE(handle != nullptr, "Animator capacity exceeded", 0);
+  HOKI_ASSERT(newRun.StartDelay >= 0.0f);
 
-  handle->Id = index + (++NextRunId * ANIMATOR_MAX_ANIMATIONS);
+  runSlot = newRun;
 
-  return handle->Id;
+  return runSlot.Id;
+}
+
+// Runs that finished or lost their last entity go back to the free list and
+// their ids stop resolving
+void release_finished_runs(animator& animator)
+{
+  for (size_t i = 1; i < ANIMATOR_MAX_ANIMATIONS; i++) {
+    animation_run& run = animator.RunningAnimations[i];
+    if (run.Id == ANIMATION_NO_ID || !run_slot_free(&run)) {
+      continue;
+    }
+
+    run.Id = ANIMATION_NO_ID;
+    run.Loops = 0;
+    run.EntityCount = 0;
+    run.Animation = nullptr;
+    animator.RunGenerations[i]++;
+    animator.FreeRuns[animator.FreeRunCount++] = (uint32_t)i;
+  }
 }
 
 run_id setup_animation(const char* name,
@@ -189,10 +229,15 @@ void validate_weights(run_id* animationIds,
 #endif
 }
 
+// Ids setup_animation failed to start, ANIMATION_NO_ID, are not added
 void add_animation_for_entity(game_entity& entity,
                               const run_id runId,
                               animator& animator)
 {
+  if (runId == ANIMATION_NO_ID) {
+    return;
+  }
+
   animation_run* addedRun = get_run(runId, animator);
   addedRun->EntityCount++;
   entity.ActiveAnimations[entity.ActiveAnimationCount++] = runId;
@@ -202,6 +247,10 @@ void set_animation_for_entity(game_entity& entity,
                               const run_id runId,
                               animator& animator)
 {
+  if (runId == ANIMATION_NO_ID) {
+    return;
+  }
+
   for (size_t i = 0; i < entity.ActiveAnimationCount; i++) {
     animation_run* existingRun = get_run(entity.ActiveAnimations[i], animator);
     if (existingRun->Id == runId) {
@@ -219,15 +268,26 @@ void set_animation_group_for_entity(game_entity& entity,
   if (group.Size == 0) {
     return;
   }
+  // Keep the entity's current runs rather than start only part of the group
+  if (!group.UpdateWeightsOnly && animator.FreeRunCount < group.Size) {
+    HOKI_WARN_MESSAGE(false,
+                      "Animator out of run slots for a group of %u",
+                      (uint32_t)group.Size);
+    return;
+  }
 
   if (!group.UpdateWeightsOnly) {
+    // Stale ids resolve to the shared empty run, which must stay untouched
     for (size_t i = 0; i < entity.ActiveAnimationCount; i++) {
       animation_run* run = get_run(entity.ActiveAnimations[i], animator);
-      run->EntityCount--;
+      if (run->Id != ANIMATION_NO_ID) {
+        run->EntityCount--;
+      }
     }
     entity.ActiveAnimationCount = 0;
   }
 
+  bool allStarted = true;
   for (size_t i = 0; i < group.Size; i++) {
     const animation* animation = group.Animations[i];
     const float animationWeight = group.Weights[i];
@@ -241,6 +301,10 @@ void set_animation_group_for_entity(game_entity& entity,
       }
     } else {
       run_id runId = setup_animation(*animation, animator);
+      if (runId == ANIMATION_NO_ID) {
+        allStarted = false;
+        continue;
+      }
       animation_run* run = get_run(runId, animator);
       run->LoopStyle = group.LoopStyle;
       run->Weight = animationWeight;
@@ -248,11 +312,74 @@ void set_animation_group_for_entity(game_entity& entity,
     }
   }
 
+  // A clip with more channels than the slots fit didn't start, the rest of
+  // the group's weights can't add up so let go of them too
+  if (!allStarted) {
+    for (size_t i = 0; i < entity.ActiveAnimationCount; i++) {
+      get_run(entity.ActiveAnimations[i], animator)->EntityCount--;
+    }
+    entity.ActiveAnimationCount = 0;
+    return;
+  }
+
   entity.ActiveAnimationCount = group.Size;
   validate_weights(
     entity.ActiveAnimations, entity.ActiveAnimationCount, animator);
 }
 
+void blend_animation_run(game_entity& entity,
+                         const animation_run& run,
+                         const uint32_t maxBoneDepth)
+{
+  for (uint32_t c = 0; c < run.ChannelCount; c++) {
+    const animation_update_transform* transform = run.ChannelTransforms + c;
+    model_bone* targetBone = entity.Bones + transform->BoneIndex;
+    if (targetBone->Depth > maxBoneDepth) {
+      continue;
+    }
+    switch (transform->PathType) {
+      case Asset::TRANSFORMATION:
+        targetBone->Translation += transform->NewTranslation * run.Weight;
+        targetBone->Rotation += transform->NewRotation * run.Weight;
+        targetBone->Scale += transform->NewScale * run.Weight;
+        break;
+      case Asset::TRANSLATION:
+        targetBone->Translation += transform->NewTranslation * run.Weight;
+        break;
+      case Asset::ROTATION:
+        // The first weighted rotation seeds the bone, slerping from the
+        // reset QUAT_ZERO would only scale it
+        if (targetBone->Rotation.W == 0.0f && targetBone->Rotation.X == 0.0f &&
+            targetBone->Rotation.Y == 0.0f && targetBone->Rotation.Z == 0.0f) {
+          targetBone->Rotation = transform->NewRotation;
+        } else {
+          targetBone->Rotation =
+            slerp(targetBone->Rotation, transform->NewRotation, run.Weight);
+        }
+        break;
+      case Asset::SCALE:
+        targetBone->Scale += transform->NewScale * run.Weight;
+        break;
+    }
+  }
+}
+
+void blend_animation_runs(game_entity& entity,
+                          const animator& animator,
+                          const uint32_t maxBoneDepth)
+{
+  validate_weights(
+    entity.ActiveAnimations, entity.ActiveAnimationCount, animator);
+  for (uint32_t j = 0; j < entity.ActiveAnimationCount; j++) {
+    const animation_run* run = get_run(entity.ActiveAnimations[j], animator);
+    if (!run_active(run) || run->Weight == 0.0f) {
+      continue;
+    }
+
+    blend_animation_run(entity, *run, maxBoneDepth);
+  }
+}
+
 void update_bone_transforms(const game_entity& entity)
 {
   for (uint32_t b = 0; b < entity.BoneCount; b++) {
@@ -290,11 +417,13 @@ void update_bone_transforms(const game_entity& entity)
     // Bone world positions for physics/debug systems
     entity.BoneWorldPositions[b] =
       mat4x4_translate(entity.Position) * quat_to_mat4x4(entity.Rotation) *
-      finalTransform * mat4x4_invert(bone.InverseBind);
+      finalTransform * bone.Bind;
   }
 }
 
-void update_animation_run(animation_run& animationRun, const float deltaTime)
+void update_animation_run(animation_run& animationRun,
+                          const float deltaTime,
+                          const bool sampleChannels)
 {
   const animation& animation = *animationRun.Animation;
 
@@ -333,7 +462,7 @@ void update_animation_run(animation_run& animationRun, const float deltaTime)
     }
   }
 
-  if (animationRun.Loops <= 0) {
+  if (animationRun.Loops <= 0 || !sampleChannels) {
     return;
   }
 
@@ -425,8 +554,9 @@ PLATFORM_WORK_QUEUE_CALLBACK(update_animation_work)
     run->StartDelay -= deltaTime;
   }
   if (run_active(run)) {
-    update_animation_run(*run, deltaTime);
+    update_animation_run(*run, deltaTime, run->SampleDue);
   }
+  run->SampleDue = false;
 }
 
 void update_animator(game_memory* gameMemory, animator& animator)
@@ -449,8 +579,197 @@ void update_animator(game_memory* gameMemory, animator& animator)
   }
 
   gameMemory->CompleteAllQueueWork(gameMemory->WorkQueue);
+  release_finished_runs(animator);
 
   animator.DeltaTime = 0.0f;
   animator.DeltaInput = 0.0f;
 }
+
+float get_projected_size(const game_entity& entity, const v3& cameraPosition)
+{
+  const Asset::model& model = *entity.Model;
+  const float scale =
+    max_f(entity.Scale.X, max_f(entity.Scale.Y, entity.Scale.Z));
+  const v4 center = mat4x4_translate(entity.Position) *
+                    quat_to_mat4x4(entity.Rotation) *
+                    mat4x4_scale(entity.Scale) * _v4(model.BoundsCenter, 1.0f);
+  const float distance = length(center.XYZ - cameraPosition);
+
+  return (model.BoundsRadius * scale) / max_f(distance, 0.001f);
+}
+
+void update_animation_lod(game_entity& entity,
+                          const v3& cameraPosition,
+                          animator& animator)
+{
+  animation_lod& lod = entity.AnimationLod;
+
+  const float screenSize = get_projected_size(entity, cameraPosition);
+  uint32_t level = 0;
+  while (screenSize < ANIMATION_LOD_LEVELS[level].MinScreenSize) {
+    level++;
+  }
+  const animation_lod_level& lodLevel = ANIMATION_LOD_LEVELS[level];
+
+  lod.FramesSinceUpdate++;
+  lod.UpdateDue = !lod.HasSample || lod.Level != level ||
+                  lod.FramesSinceUpdate >= lodLevel.UpdateInterval;
+  lod.Level = level;
+  lod.UpdateInterval = lodLevel.UpdateInterval;
+  lod.MaxBoneDepth = lodLevel.MaxBoneDepth;
+  if (!lod.UpdateDue) {
+    return;
+  }
+
+  lod.FramesSinceUpdate = 0;
+  for (size_t i = 0; i < entity.ActiveAnimationCount; i++) {
+    animation_run* run = get_run(entity.ActiveAnimations[i], animator);
+    run->SampleDue = true;
+  }
+}
+
+// Only touches the entity and reads the animator, so entities can be posed in
+// parallel once update_animator has sampled the runs
+PLATFORM_WORK_QUEUE_CALLBACK(update_entity_pose_work)
+{
+  animator_pose_update* poseData = (animator_pose_update*)data;
+  game_entity& entity = *poseData->Entity;
+
+  animation_lod& lod = entity.AnimationLod;
+
+  if (lod.UpdateDue) {
+    reset_frame_animation_data(&entity, 1);
+    for (uint32_t b = 0; b < entity.BoneCount; b++) {
+      if (entity.Bones[b].Depth > lod.MaxBoneDepth) {
+        const model_bone& restBone = entity.Model->Bones[b];
+        entity.Bones[b].Translation = restBone.Translation;
+        entity.Bones[b].Rotation = restBone.Rotation;
+        entity.Bones[b].Scale = restBone.Scale;
+      }
+    }
+    blend_animation_runs(entity, *poseData->Animator, lod.MaxBoneDepth);
+    update_bone_transforms(entity);
+
+    for (uint32_t b = 0; b < entity.BoneCount; b++) {
+      entity.PreviousBoneTransforms[b] = lod.HasSample
+                                           ? entity.SampledBoneTransforms[b]
+                                           : entity.BoneTransforms[b];
+      entity.SampledBoneTransforms[b] = entity.BoneTransforms[b];
+    }
+    lod.HasSample = true;
+    lod.UpdateDue = false;
+  }
+
+  if (lod.UpdateInterval > 1) {
+    const float t =
+      (float)(lod.FramesSinceUpdate + 1) / (float)lod.UpdateInterval;
+    const mat4x4 entityTransform =
+      mat4x4_translate(entity.Position) * quat_to_mat4x4(entity.Rotation);
+    for (uint32_t b = 0; b < entity.BoneCount; b++) {
+      entity.BoneTransforms[b] = lerp(
+        entity.PreviousBoneTransforms[b], entity.SampledBoneTransforms[b], t);
+      entity.BoneWorldPositions[b] =
+        entityTransform * entity.BoneTransforms[b] * entity.Bones[b].Bind;
+    }
+  }
+}
+
+void push_entity_pose(game_memory* gameMemory,
+                      animator& animator,
+                      game_entity& entity)
+{
+  HOKI_ASSERT_MESSAGE(animator.PoseCount < ANIMATOR_MAX_POSED_ENTITIES,
+                      "Posed entity capacity exceeded",
+                      0);
+
+  animator_pose_update* poseData = animator.PoseData + animator.PoseCount++;
+  poseData->Entity = &entity;
+  poseData->Animator = &animator;
+  gameMemory->AddWorkEntry(
+    gameMemory->WorkQueue, update_entity_pose_work, poseData);
+}
+
+void complete_entity_poses(game_memory* gameMemory, animator& animator)
+{
+  gameMemory->CompleteAllQueueWork(gameMemory->WorkQueue);
+  animator.PoseCount = 0;
+}
+
+/**
+ * Samples the clip on pose, an entity the baked frames are drawn for so its
+ * own bones aren't animated on the CPU, with a run borrowed from the
+ * animator. Both are back to their rest state afterwards.
+ */
+baked_animation bake_animation(const animation& animation,
+                               game_entity& pose,
+                               animator& animator,
+                               const float frameRate)
+{
+  HOKI_ASSERT(frameRate > 0.0f);
+
+  baked_animation result = {};
+  const run_id runId = setup_animation(animation, animator);
+  if (runId == ANIMATION_NO_ID) {
+    return result;
+  }
+  animation_run& run = *get_run(runId, animator);
+
+  result.Animation = &animation;
+  result.FrameRate = frameRate;
+  result.BoneCount = (uint32_t)pose.BoneCount;
+  result.FrameCount = (uint32_t)std::ceil(animation.Duration * frameRate);
+  if (result.FrameCount == 0) {
+    result.FrameCount = 1;
+  }
+  result.Frames = (mat4x4*)allocate_t(sizeof(mat4x4) * result.FrameCount *
+                                      result.BoneCount);
+
+  // Step back one frame so the first update lands on time zero
+  const float frameDelta = 1.0f / frameRate;
+  run.CurrentTime = -frameDelta;
+  for (uint32_t f = 0; f < result.FrameCount; f++) {
+    update_animation_run(run, frameDelta, true);
+    reset_frame_animation_data(&pose, 1);
+    blend_animation_run(pose, run, UINT32_MAX);
+    update_bone_transforms(pose);
+
+    mat4x4* frame = result.Frames + (f * result.BoneCount);
+    for (uint32_t b = 0; b < result.BoneCount; b++) {
+      frame[b] = pose.BoneTransforms[b];
+    }
+  }
+
+  run.Loops = 0;
+  release_finished_runs(animator);
+  for (size_t b = 0; b < pose.BoneCount; b++) {
+    pose.Bones[b] = pose.Model->Bones[b];
+    pose.BoneTransforms[b] = IDENTITY_MATRIX;
+  }
+
+  return result;
+}
+
+baked_animation bake_animation(const char* name,
+                               game_entity& pose,
+                               animator& animator,
+                               const float frameRate)
+{
+  const animation& animation = find_animation(
+    name, pose.Model->Animations, pose.Model->AnimationCount);
+  return bake_animation(animation, pose, animator, frameRate);
+}
+
+void update_baked_run(baked_animation_run& run, const float deltaTime)
+{
+  if (run.Baked == nullptr || run.Baked->Animation->Duration == 0.0f) {
+    return;
+  }
+
+  const float duration = run.Baked->Animation->Duration;
+  run.CurrentTime =
+    std::fmod(run.CurrentTime + deltaTime * run.Speed, duration);
+  if (run.CurrentTime < 0.0f) {
+    run.CurrentTime += duration;
+  }
+}
 }
\ No newline at end of file
@@ -18,7 +18,12 @@ static const float ANIMATION_DEFAULT_SPEED = 1.0f;
 static const uint16_t ANIMATION_STACK_MAX_SIZE = 16;
 static const size_t ANIMATOR_MAX_ANIMATIONS = 64;
 static const size_t ANIMATION_MAX_CHANNELS = 64;
+static const size_t ANIMATOR_MAX_POSED_ENTITIES = 32;
 static const uint32_t ANIMATION_NO_ID = 0;
+static const uint32_t ANIMATION_RUN_INDEX_BITS = 16;
+static const uint32_t ANIMATION_RUN_INDEX_MASK =
+  (1u << ANIMATION_RUN_INDEX_BITS) - 1;
+static const float ANIMATION_BAKE_FRAME_RATE = 30.0f;
 
 static const animation EMPTY_ANIMATION = { "EMPTY", nullptr, 0, 0.0f };
 
@@ -44,6 +49,9 @@ struct animation_update_transform
   Asset::animation_path_type PathType;
 };
 
+// Slot index in the low bits, slot generation in the high bits. The
+// generation is bumped whenever a slot is released so stale ids stop
+// resolving instead of aliasing whatever runs in the slot next.
 typedef uint32_t run_id;
 
 struct animation_run
@@ -61,6 +69,58 @@ struct animation_run
   float Weight;
   uint32_t EntityCount;
   animation_driver Driver;
+  bool SampleDue; // Set when an entity using the run needs a new pose
+};
+
+/**
+ * Looping clip pre-sampled into skinning matrices at a fixed rate, so
+ * instances can pick a frame on the GPU instead of being animated on the CPU
+ */
+struct baked_animation
+{
+  const animation* Animation;
+  mat4x4* Frames; // FrameCount * BoneCount, frame-major
+  uint32_t FrameCount;
+  uint32_t BoneCount;
+  float FrameRate;
+
+  uint32_t RenderHandle;
+};
+
+struct baked_animation_run
+{
+  const baked_animation* Baked;
+  float CurrentTime;
+  float Speed;
+};
+
+struct animation_lod_level
+{
+  float MinScreenSize;
+  uint32_t UpdateInterval;
+  uint32_t MaxBoneDepth;
+};
+
+/**
+ * Screen size is the bounding sphere radius over the distance to the camera,
+ * so 1.0 roughly covers half of the 90 degree view. Bones deeper than
+ * MaxBoneDepth are left in their rest pose.
+ */
+static const animation_lod_level ANIMATION_LOD_LEVELS[] = {
+  { 0.20f, 1, UINT32_MAX },
+  { 0.08f, 2, UINT32_MAX },
+  { 0.03f, 4, 4 },
+  { 0.0f, 8, 2 },
+};
+
+struct animation_lod
+{
+  uint32_t Level;
+  uint32_t UpdateInterval;
+  uint32_t MaxBoneDepth;
+  uint32_t FramesSinceUpdate;
+  bool UpdateDue;
+  bool HasSample;
 };
 
 struct animation_group
@@ -78,12 +138,25 @@ struct animator_update
   animation_run* Run;
 };
 
+struct animator;
+struct animator_pose_update
+{
+  game_entity* Entity;
+  const animator* Animator;
+};
+
 struct animator
 {
   float DeltaTime;
   float DeltaInput;
   animation_run RunningAnimations[ANIMATOR_MAX_ANIMATIONS];
+  uint32_t RunGenerations[ANIMATOR_MAX_ANIMATIONS];
+  uint32_t FreeRuns[ANIMATOR_MAX_ANIMATIONS];
+  size_t FreeRunCount;
+  size_t MaxChannelCount; // Size of each slot's channel buffers
   animator_update FrameData[ANIMATOR_MAX_ANIMATIONS];
+  animator_pose_update PoseData[ANIMATOR_MAX_POSED_ENTITIES];
+  size_t PoseCount;
 };
 
 }
@@ -21,6 +21,8 @@ struct material
   texture* NormalMap;
 
   float AmbientOcclusion;
+
+  uint32_t RenderHandle;
 };
 }
 
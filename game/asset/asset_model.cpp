@@ -1,3 +1,5 @@
+#include <float.h>
+
 #include "asset_model.h"
 
 // Define these only in *one* .cc file.
@@ -496,11 +498,472 @@ model_bone* load_bones(tinygltf::Model& model,
                                   newBone.Scale);
 
     newBone.InverseBind = boneOffsetCursor[b];
+    newBone.Bind = mat4x4_invert(newBone.InverseBind);
+  }
+
+  for (size_t b = 0; b < boneCount; b++) {
+    model_bone& bone = result[b];
+    bone.Depth = 0;
+    for (model_node* parent = nodes[bone.NodeId].Parent; parent;
+         parent = parent->Parent) {
+      if (parent->BoneId > -1) {
+        bone.Depth++;
+      }
+    }
+  }
+
+  return result;
+}
+
+void load_bounds(model& model)
+{
+  v3 boundsMin = _v3(FLT_MAX);
+  v3 boundsMax = _v3(-FLT_MAX);
+  for (size_t n = 0; n < model.NodeCount; n++) {
+    model_node* node = model.Nodes + n;
+    if (node->Mesh == nullptr) {
+      continue;
+    }
+
+    // Same node walk as the renderer, in rest pose
+    mat4x4 transform = node->Transform;
+    for (model_node* parent = node->Parent; !node->Skinned && parent;
+         parent = parent->Parent) {
+      if (parent->BoneId > -1) {
+        transform = model.Bones[parent->BoneId].Transform * transform;
+      } else {
+        transform = parent->Transform * transform;
+      }
+    }
+
+    for (size_t p = 0; p < node->Mesh->PrimitiveCount; p++) {
+      model_primitive& primitive = node->Mesh->Primitives[p];
+      uint16_t* indices =
+        model.Indices + (primitive.IndexOffsetBytes / sizeof(uint16_t));
+      for (size_t i = 0; i < primitive.IndexCount; i++) {
+        v4 position =
+          transform * _v4(model.Vertices[indices[i]].Position, 1.0f);
+        for (int e = 0; e < 3; e++) {
+          boundsMin.E[e] = min_f(boundsMin.E[e], position.E[e]);
+          boundsMax.E[e] = max_f(boundsMax.E[e], position.E[e]);
+        }
+      }
+    }
+  }
+
+  if (boundsMin.X > boundsMax.X) {
+    return;
+  }
+
+  // Sphere around the box, loose but cheap to test against
+  model.BoundsCenter = (boundsMin + boundsMax) * 0.5f;
+  model.BoundsRadius = length(boundsMax - boundsMin) * 0.5f;
+}
+
+/** Vertex cache */
+
+// LRU size the triangle order is scored for, and the FIFO the misses are
+// measured with
+static const int32_t VERTEX_CACHE_SIZE = 32;
+static const uint32_t VERTEX_CACHE_FIFO_SIZE = 16;
+
+struct vertex_cache_scratch
+{
+  primitive_data* Vertices;
+  // Per vertex
+  uint32_t* LiveTriangles;
+  uint32_t* AdjacencyOffsets;
+  int32_t* CachePositions;
+  float* Scores;
+  uint32_t* Remap;
+  // Per triangle
+  uint32_t* Adjacency;
+  float* TriangleScores;
+  uint16_t* Indices;
+  bool* Emitted;
+};
+
+static uint32_t count_cache_misses(const uint16_t* indices,
+                                   const size_t indexCount,
+                                   uint32_t* fifoStamps,
+                                   const uint32_t firstVertex,
+                                   const uint32_t vertexCount)
+{
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    fifoStamps[firstVertex + v] = 0;
+  }
+
+  // A vertex is in the FIFO while fewer than its size misses came after it
+  uint32_t misses = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    uint32_t& stamp = fifoStamps[indices[i]];
+    if (stamp == 0 || misses + 1 - stamp > VERTEX_CACHE_FIFO_SIZE) {
+      misses++;
+      stamp = misses;
+    }
+  }
+
+  return misses;
+}
+
+// Forsyth's "Linear-Speed Vertex Cache Optimisation" weights
+static float get_vertex_cache_score(const int32_t cachePosition,
+                                    const uint32_t liveTriangles)
+{
+  if (liveTriangles == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 0 && cachePosition < 3) {
+    // The last triangle's vertices, fixed so it isn't simply drawn again
+    score = 0.75f;
+  } else if (cachePosition >= 3) {
+    const float scale = 1.0f / (float)(VERTEX_CACHE_SIZE - 3);
+    score = powf(1.0f - (float)(cachePosition - 3) * scale, 1.5f);
+  }
+  // Favour vertices with few triangles left so they don't get stranded
+  score += 2.0f / sqrtf((float)liveTriangles);
+
+  return score;
+}
+
+// Greedily emits the best scoring live triangle into scratch.Indices
+static void order_triangles_for_cache(const uint16_t* indices,
+                                      const size_t indexCount,
+                                      const uint32_t firstVertex,
+                                      const uint32_t lastVertex,
+                                      vertex_cache_scratch& scratch)
+{
+  const size_t triangleCount = indexCount / 3;
+
+  // Triangles of each vertex, live ones first
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    scratch.LiveTriangles[v] = 0;
+    scratch.CachePositions[v] = -1;
+  }
+  for (size_t i = 0; i < indexCount; i++) {
+    scratch.LiveTriangles[indices[i]]++;
+  }
+  uint32_t offset = 0;
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    scratch.AdjacencyOffsets[v] = offset;
+    offset += scratch.LiveTriangles[v];
+    scratch.LiveTriangles[v] = 0;
+  }
+  for (size_t i = 0; i < indexCount; i++) {
+    const uint16_t v = indices[i];
+    scratch.Adjacency[scratch.AdjacencyOffsets[v] + scratch.LiveTriangles[v]] =
+      (uint32_t)(i / 3);
+    scratch.LiveTriangles[v]++;
+  }
+
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    scratch.Scores[v] = get_vertex_cache_score(-1, scratch.LiveTriangles[v]);
+  }
+  for (size_t t = 0; t < triangleCount; t++) {
+    scratch.Emitted[t] = false;
+    scratch.TriangleScores[t] = scratch.Scores[indices[t * 3]] +
+                                scratch.Scores[indices[t * 3 + 1]] +
+                                scratch.Scores[indices[t * 3 + 2]];
+  }
+
+  // Most recent first, the emitted triangle's vertices push out the oldest
+  uint16_t cache[VERTEX_CACHE_SIZE + 3];
+  int32_t cacheCount = 0;
+  size_t bestTriangle = SIZE_MAX;
+  for (size_t emitted = 0; emitted < triangleCount; emitted++) {
+    if (bestTriangle == SIZE_MAX) {
+      // Nothing in the cache touches a live triangle, start over anywhere
+      float bestScore = -FLT_MAX;
+      for (size_t t = 0; t < triangleCount; t++) {
+        if (!scratch.Emitted[t] && scratch.TriangleScores[t] > bestScore) {
+          bestScore = scratch.TriangleScores[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    const uint16_t* triangle = indices + bestTriangle * 3;
+    uint16_t* output = scratch.Indices + emitted * 3;
+    output[0] = triangle[0];
+    output[1] = triangle[1];
+    output[2] = triangle[2];
+    scratch.Emitted[bestTriangle] = true;
+
+    uint16_t newCache[VERTEX_CACHE_SIZE + 3];
+    int32_t newCacheCount = 0;
+    for (int c = 0; c < 3; c++) {
+      const uint16_t v = output[c];
+      // Degenerate triangles repeat a vertex, it only takes one entry
+      if ((c < 1 || v != output[0]) && (c < 2 || v != output[1])) {
+        newCache[newCacheCount++] = v;
+      }
+
+      uint32_t* adjacency = scratch.Adjacency + scratch.AdjacencyOffsets[v];
+      uint32_t& live = scratch.LiveTriangles[v];
+      for (uint32_t a = 0; a < live; a++) {
+        if (adjacency[a] == bestTriangle) {
+          adjacency[a] = adjacency[live - 1];
+          live--;
+          break;
+        }
+      }
+    }
+    for (int32_t c = 0; c < cacheCount; c++) {
+      const uint16_t v = cache[c];
+      if (v != output[0] && v != output[1] && v != output[2]) {
+        newCache[newCacheCount++] = v;
+      }
+    }
+
+    // Rescore what the change touched, the best live triangle goes next
+    float bestScore = -FLT_MAX;
+    bestTriangle = SIZE_MAX;
+    for (int32_t c = 0; c < newCacheCount; c++) {
+      const uint16_t v = newCache[c];
+      scratch.CachePositions[v] = c < VERTEX_CACHE_SIZE ? c : -1;
+      const float score = get_vertex_cache_score(scratch.CachePositions[v],
+                                                 scratch.LiveTriangles[v]);
+      const float delta = score - scratch.Scores[v];
+      scratch.Scores[v] = score;
+
+      const uint32_t* adjacency =
+        scratch.Adjacency + scratch.AdjacencyOffsets[v];
+      for (uint32_t a = 0; a < scratch.LiveTriangles[v]; a++) {
+        const uint32_t t = adjacency[a];
+        scratch.TriangleScores[t] += delta;
+        if (scratch.TriangleScores[t] > bestScore) {
+          bestScore = scratch.TriangleScores[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    cacheCount =
+      newCacheCount < VERTEX_CACHE_SIZE ? newCacheCount : VERTEX_CACHE_SIZE;
+    for (int32_t c = 0; c < cacheCount; c++) {
+      cache[c] = newCache[c];
+    }
+  }
+}
+
+/**
+ * Reorders a primitive's triangles so consecutive ones share vertices, then
+ * renumbers its vertices in the order the triangles first use them. The
+ * vertices of a primitive are contiguous, vertices the indices skip over
+ * stay where they are. Translucent primitives only get their vertices
+ * renumbered.
+ */
+static void optimize_primitive_vertex_cache(model& model,
+                                            model_primitive& primitive,
+                                            vertex_cache_scratch& scratch)
+{
+  uint16_t* indices =
+    model.Indices + (primitive.IndexOffsetBytes / sizeof(uint16_t));
+  const size_t indexCount = primitive.IndexCount;
+  if (indexCount < 3 || indexCount % 3 != 0) {
+    return;
+  }
+
+  uint32_t firstVertex = UINT16_MAX;
+  uint32_t lastVertex = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    firstVertex = indices[i] < firstVertex ? indices[i] : firstVertex;
+    lastVertex = indices[i] > lastVertex ? indices[i] : lastVertex;
+  }
+  const uint32_t vertexCount = lastVertex - firstVertex + 1;
+
+  model.ExportedCacheMisses += count_cache_misses(
+    indices, indexCount, scratch.Remap, firstVertex, vertexCount);
+
+  // Blending depends on the order overlapping triangles are drawn in
+  if (primitive.Material != nullptr && primitive.Material->Translucent) {
+    memcpy(scratch.Indices, indices, indexCount * sizeof(indices[0]));
+  } else {
+    order_triangles_for_cache(
+      indices, indexCount, firstVertex, lastVertex, scratch);
+  }
+
+  // Vertices in order of first use, unused ones after them
+  const uint32_t unmapped = UINT32_MAX;
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    scratch.Remap[v] = unmapped;
+  }
+  uint32_t nextVertex = firstVertex;
+  for (size_t i = 0; i < indexCount; i++) {
+    const uint16_t v = scratch.Indices[i];
+    if (scratch.Remap[v] == unmapped) {
+      scratch.Remap[v] = nextVertex++;
+    }
+  }
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    if (scratch.Remap[v] == unmapped) {
+      scratch.Remap[v] = nextVertex++;
+    }
+  }
+  HOKI_ASSERT(nextVertex == lastVertex + 1);
+
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    scratch.Vertices[scratch.Remap[v]] = model.Vertices[v];
+  }
+  for (uint32_t v = firstVertex; v <= lastVertex; v++) {
+    model.Vertices[v] = scratch.Vertices[v];
+  }
+  for (size_t i = 0; i < indexCount; i++) {
+    indices[i] = (uint16_t)scratch.Remap[scratch.Indices[i]];
+  }
+
+  model.OptimizedCacheMisses += count_cache_misses(
+    indices, indexCount, scratch.Remap, firstVertex, vertexCount);
+}
+
+/**
+ * glTF exporters write triangles in authoring order, reorders every
+ * primitive for the post-transform cache and vertex fetch. Each primitive
+ * loads its own copy of its vertices, so they can be moved independently.
+ */
+static void optimize_vertex_cache(model& model)
+{
+  if (model.VertexCount == 0 || model.IndexCount == 0) {
+    return;
+  }
+
+  // Scratch is sized for the whole model and shared by its primitives
+  const size_t vertexCount = model.VertexCount;
+  const size_t indexCount = model.IndexCount;
+  const size_t scratchSize =
+    vertexCount * (sizeof(primitive_data) + 4 * sizeof(uint32_t) +
+                   sizeof(float)) +
+    indexCount * (sizeof(uint32_t) + sizeof(uint16_t)) +
+    (indexCount / 3 + 1) * (sizeof(float) + sizeof(bool));
+  uint8_t* cursor = (uint8_t*)allocate_t(scratchSize);
+
+  vertex_cache_scratch scratch = {};
+  scratch.Vertices = (primitive_data*)cursor;
+  cursor += vertexCount * sizeof(primitive_data);
+  scratch.LiveTriangles = (uint32_t*)cursor;
+  cursor += vertexCount * sizeof(uint32_t);
+  scratch.AdjacencyOffsets = (uint32_t*)cursor;
+  cursor += vertexCount * sizeof(uint32_t);
+  scratch.CachePositions = (int32_t*)cursor;
+  cursor += vertexCount * sizeof(int32_t);
+  scratch.Remap = (uint32_t*)cursor;
+  cursor += vertexCount * sizeof(uint32_t);
+  scratch.Scores = (float*)cursor;
+  cursor += vertexCount * sizeof(float);
+  scratch.Adjacency = (uint32_t*)cursor;
+  cursor += indexCount * sizeof(uint32_t);
+  scratch.TriangleScores = (float*)cursor;
+  cursor += (indexCount / 3 + 1) * sizeof(float);
+  scratch.Indices = (uint16_t*)cursor;
+  cursor += indexCount * sizeof(uint16_t);
+  scratch.Emitted = (bool*)cursor;
+
+  for (size_t m = 0; m < model.MeshCount; m++) {
+    model_mesh& mesh = model.Meshes[m];
+    for (size_t p = 0; p < mesh.PrimitiveCount; p++) {
+      optimize_primitive_vertex_cache(model, mesh.Primitives[p], scratch);
+    }
+  }
+
+  unallocate_t(scratch.Vertices);
+}
+
+// Rounds to nearest, out of range values turn into infinity
+static uint16_t pack_half(const float value)
+{
+  union
+  {
+    float F;
+    uint32_t U;
+  } bits;
+  bits.F = value;
+
+  const uint32_t sign = (bits.U >> 16) & 0x8000;
+  const int32_t exponent = (int32_t)((bits.U >> 23) & 0xFF) - 127 + 15;
+  uint32_t mantissa = bits.U & 0x7FFFFF;
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return (uint16_t)sign;
+    }
+    // Subnormal, the implicit bit moves into the mantissa
+    mantissa = (mantissa | 0x800000) >> (1 - exponent);
+    return (uint16_t)(sign | ((mantissa + 0x1000) >> 13));
+  }
+  if (exponent >= 31) {
+    return (uint16_t)(sign | 0x7C00);
+  }
+
+  // A carry out of the mantissa correctly bumps the exponent
+  return (uint16_t)((sign | ((uint32_t)exponent << 10) | (mantissa >> 13)) +
+                    ((mantissa >> 12) & 1));
+}
+
+// GL_INT_2_10_10_10_REV, x in the low bits and w left 0
+static uint32_t pack_snorm_10_10_10_2(const v3 vector)
+{
+  uint32_t result = 0;
+  for (int e = 0; e < 3; e++) {
+    const int32_t value = (int32_t)roundf(clamp(vector.E[e], -1.0f, 1.0f) *
+                                          511.0f);
+    result |= ((uint32_t)value & 0x3FF) << (e * 10);
   }
 
   return result;
 }
 
+/**
+ * Packs the vertices into the model's GPU layout. Every mesh of a model
+ * shares its vertex buffer, so the layout is picked per model and models
+ * without a skin leave the bones out.
+ */
+static void pack_vertices(model& model)
+{
+  model.VertexLayout =
+    model.BoneCount > 0 ? VERTEX_LAYOUT_SKINNED : VERTEX_LAYOUT_STATIC;
+  model.VertexStride = model.VertexLayout == VERTEX_LAYOUT_SKINNED
+                         ? VERTEX_STRIDE_SKINNED
+                         : VERTEX_STRIDE_STATIC;
+  model.PackedVertices =
+    (uint8_t*)allocate_t(model.VertexStride * model.VertexCount);
+
+  for (size_t v = 0; v < model.VertexCount; v++) {
+    const primitive_data& vertex = model.Vertices[v];
+    packed_vertex packed = {};
+    packed.Position = vertex.Position;
+    packed.TextureCoord[0] = pack_half(vertex.TextureCoord.X);
+    packed.TextureCoord[1] = pack_half(vertex.TextureCoord.Y);
+    packed.Normal = pack_snorm_10_10_10_2(vertex.Normal);
+    packed.Tangent = pack_snorm_10_10_10_2(vertex.Tangent);
+
+    if (model.VertexLayout == VERTEX_LAYOUT_SKINNED) {
+      // Rounding error goes to the heaviest bone so the weights sum to one
+      int32_t weightSum = 0;
+      uint32_t heaviest = 0;
+      for (uint32_t b = 0; b < MAX_BONES_PER_VERTEX; b++) {
+        HOKI_ASSERT(vertex.BoneIds[b] <= UINT8_MAX);
+        packed.BoneIds[b] = (uint8_t)vertex.BoneIds[b];
+        packed.BoneWeights[b] = (uint8_t)roundf(
+          clamp(vertex.BoneWeights[b], 0.0f, 1.0f) * (float)UINT8_MAX);
+        weightSum += packed.BoneWeights[b];
+        if (vertex.BoneWeights[b] > vertex.BoneWeights[heaviest]) {
+          heaviest = b;
+        }
+      }
+      const int32_t adjusted =
+        packed.BoneWeights[heaviest] + UINT8_MAX - weightSum;
+      if (weightSum > 0 && adjusted >= 0 && adjusted <= UINT8_MAX) {
+        packed.BoneWeights[heaviest] = (uint8_t)adjusted;
+      }
+    }
+
+    memcpy(model.PackedVertices + v * model.VertexStride,
+           &packed,
+           model.VertexStride);
+  }
+}
+
 animation* load_animations(tinygltf::Model& loadedModel,
                            model& resultModel,
                            size_t animationCount)
@@ -856,6 +1319,10 @@ model loadModel(const char* path, game_memory& gameMemory)
   result.AnimationCount = model.animations.size();
   result.Animations = load_animations(model, result, result.AnimationCount);
 
+  optimize_vertex_cache(result);
+  load_bounds(result);
+  pack_vertices(result);
+
   return result;
 }
 }
\ No newline at end of file
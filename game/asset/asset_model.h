@@ -4,6 +4,8 @@
 #include "asset_texture.h"
 #include "asset_material.h"
 
+#include <stddef.h>
+
 namespace Asset {
 static const uint32_t MAX_BONES_PER_VERTEX = 4;
 static const uint32_t MAX_INTERPOLATED_FRAMES = 4;
@@ -20,6 +22,31 @@ struct primitive_data
   float BoneWeights[MAX_BONES_PER_VERTEX];
 };
 
+/**
+ * Vertices as the GPU reads them, normals and tangents are signed normalized
+ * 10:10:10:2 and texture coordinates half floats. Only skinned models keep the
+ * bone ids and weights, static ones stop at VERTEX_STRIDE_STATIC.
+ */
+enum vertex_layout
+{
+  VERTEX_LAYOUT_STATIC,
+  VERTEX_LAYOUT_SKINNED
+};
+
+struct packed_vertex
+{
+  v3 Position;
+  uint16_t TextureCoord[2];
+  uint32_t Normal;
+  uint32_t Tangent;
+  uint8_t BoneIds[MAX_BONES_PER_VERTEX];
+  // Normalized, sum to 255
+  uint8_t BoneWeights[MAX_BONES_PER_VERTEX];
+};
+
+static const size_t VERTEX_STRIDE_STATIC = offsetof(packed_vertex, BoneIds);
+static const size_t VERTEX_STRIDE_SKINNED = sizeof(packed_vertex);
+
 struct model_primitive
 {
   texture* Texture;
@@ -38,8 +65,10 @@ struct model_bone
   v3 Scale;
 
   mat4x4 InverseBind;
+  mat4x4 Bind;
   mat4x4 Transform;
   uint32_t NodeId;
+  uint32_t Depth; // Number of parent bones
 };
 
 struct model_mesh
@@ -70,6 +99,10 @@ struct model
 
   primitive_data* Vertices;
   size_t VertexCount;
+  // What the renderer uploads, VertexStride bytes per vertex
+  vertex_layout VertexLayout;
+  size_t VertexStride;
+  uint8_t* PackedVertices;
 
   uint16_t* Indices;
   size_t IndexCount;
@@ -93,6 +126,17 @@ struct model
   size_t BoneCount;
 
   mat4x4 GlobalInverseTransform;
+
+  // Bounding sphere of the rest pose in model space
+  v3 BoundsCenter;
+  float BoundsRadius;
+
+  // Misses of a simulated post-transform vertex cache, in the exported
+  // triangle order and after the load time reordering
+  uint32_t ExportedCacheMisses;
+  uint32_t OptimizedCacheMisses;
+
+  uint32_t RenderHandle;
 };
 
 }
@@ -16,6 +16,20 @@ enum ogl_shader_type
   SHADER_TYPE_PBR,
   SHADER_TYPE_PBR_INSTANCED
 };
+/**
+ * Features a PBR program is specialized for, the build generates a shader for
+ * each combination and the game only compiles the ones its models use.
+ */
+enum pbr_variant_flags
+{
+  PBR_VARIANT_SKINNED = 0x1,
+  PBR_VARIANT_ALBEDO_MAP = 0x2,
+  PBR_VARIANT_METALLIC_MAP = 0x4,
+  PBR_VARIANT_ROUGHNESS_MAP = 0x8
+};
+
+static const uint32_t PBR_VARIANT_COUNT = 16;
+
 struct ogl_shader
 {
   const char* Name;
@@ -28,6 +42,8 @@ struct ogl_shader_program
   ogl_shader* VertexShader;
   ogl_shader* FragmentShader;
   ogl_shader_type Type;
+  // pbr_variant_flags of the PBR programs
+  uint32_t Variant;
 };
 }
 
@@ -183,6 +183,7 @@ glyph* createCharacter(const uint8_t* character,
                                                      &yOffset);
 
   glyph* newCharacter = (glyph*)allocate_t(sizeof(glyph));
+  *newCharacter = {};
   newCharacter->ByteCount = byteCount;
   newCharacter->PixelSize = _v2((float)width, (float)height);
   newCharacter->PixelBearing = _v2((float)xOffset, (float)yOffset);
@@ -23,6 +23,8 @@ struct glyph
   v2 PixelBearing;
   float PixelAdvance;
   void* Memory;
+
+  uint32_t RenderHandle;
 };
 
 struct glyph_table
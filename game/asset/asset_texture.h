@@ -40,6 +40,8 @@ struct texture
     DDS_Image* DDSImage;
   };
   texture_wrap_type WrapType;
+
+  uint32_t RenderHandle;
 };
 }
 
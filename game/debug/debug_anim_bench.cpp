@@ -0,0 +1,205 @@
+#include <chrono>
+
+#include "../anim_system.h"
+
+/**
+ * Runs the animation pipeline on a fixed timestep without rendering and
+ * measures the cost of each stage along with a checksum of the final
+ * BoneTransforms. The checksum is bit exact, the sum can be compared with a
+ * tolerance. The dev build runs it on the loaded models, the headless target
+ * with -bench-anim on models it loads itself.
+ */
+static const size_t ANIMATION_BENCHMARK_PLAYERS = 8;
+static const size_t ANIMATION_BENCHMARK_GOALIES = 4;
+static const size_t ANIMATION_BENCHMARK_ENTITIES =
+  ANIMATION_BENCHMARK_PLAYERS + ANIMATION_BENCHMARK_GOALIES;
+static const float ANIMATION_BENCHMARK_SECONDS = 10.0f;
+static const float ANIMATION_BENCHMARK_DELTA = 1.0f / 60.0f;
+
+struct animation_benchmark_result
+{
+  uint32_t Frames;
+  double SampleNsPerChannel;
+  double BlendNsPerBone;
+  double BoneTransformsNsPerEntity;
+  uint32_t Checksum;
+  double Sum;
+};
+
+static uint64_t debug_benchmark_now()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+// The animator and ANIMATION_BENCHMARK_ENTITIES entities, in transient storage
+void create_animation_benchmark(const Asset::model* playerModel,
+                                const Asset::model* goalieModel,
+                                AnimationSystem::animator*& outAnimator,
+                                game_entity*& outEntities)
+{
+  using namespace AnimationSystem;
+
+  outAnimator = (animator*)allocate_t(sizeof(animator));
+  *outAnimator = {};
+  size_t maxChannelCount = get_max_channel_count(*playerModel);
+  if (get_max_channel_count(*goalieModel) > maxChannelCount) {
+    maxChannelCount = get_max_channel_count(*goalieModel);
+  }
+  init_animator(*outAnimator, maxChannelCount);
+
+  outEntities = (game_entity*)allocate_t(sizeof(game_entity) *
+                                         ANIMATION_BENCHMARK_ENTITIES);
+  for (size_t i = 0; i < ANIMATION_BENCHMARK_ENTITIES; i++) {
+    outEntities[i] = {};
+  }
+}
+
+animation_benchmark_result run_animation_benchmark(
+  const Asset::model* playerModel,
+  const Asset::model* goalieModel,
+  AnimationSystem::animator* benchAnimator,
+  game_entity* entities,
+  const float seconds)
+{
+  using namespace AnimationSystem;
+
+  const size_t entityCount = ANIMATION_BENCHMARK_ENTITIES;
+  reset_animator(*benchAnimator);
+
+  // create_entity reuses the bone buffers of the previous run
+  for (size_t i = 0; i < ANIMATION_BENCHMARK_PLAYERS; i++) {
+    game_entity& player = entities[i];
+    create_entity("BenchPlayer", playerModel, player);
+    player.ActiveAnimationCount = 0;
+    run_id skateId = setup_animation("Skate",
+                                     playerModel->Animations,
+                                     playerModel->AnimationCount,
+                                     *benchAnimator);
+    set_animation_for_entity(player, skateId, *benchAnimator);
+  }
+  for (size_t i = ANIMATION_BENCHMARK_PLAYERS; i < entityCount; i++) {
+    game_entity& goalie = entities[i];
+    create_entity("BenchGoalie", goalieModel, goalie);
+    goalie.ActiveAnimationCount = 0;
+
+    animation_group group = {};
+    group.LoopStyle = animation_loop_style::WRAP;
+    push_animation_to_group(group,
+                            "Idle",
+                            goalieModel->Animations,
+                            goalieModel->AnimationCount,
+                            0.6f);
+    push_animation_to_group(group,
+                            "Left Shuffle",
+                            goalieModel->Animations,
+                            goalieModel->AnimationCount,
+                            0.4f);
+    set_animation_group_for_entity(goalie, group, *benchAnimator);
+  }
+
+  uint64_t sampleNs = 0;
+  uint64_t blendNs = 0;
+  uint64_t boneTransformsNs = 0;
+  uint64_t channelsSampled = 0;
+  uint64_t bonesBlended = 0;
+  uint64_t entitiesUpdated = 0;
+
+  animation_benchmark_result result = {};
+  result.Frames = (uint32_t)(seconds / ANIMATION_BENCHMARK_DELTA);
+  for (uint32_t f = 0; f < result.Frames; f++) {
+    // Runs are sampled inline so only the sampling is timed, not the work
+    // queue update_animator hands them to
+    for (size_t a = 1; a < ANIMATOR_MAX_ANIMATIONS; a++) {
+      animation_run* run = benchAnimator->RunningAnimations + a;
+      if (!run_active(run)) {
+        continue;
+      }
+
+      const uint64_t start = debug_benchmark_now();
+      update_animation_run(*run, ANIMATION_BENCHMARK_DELTA, true);
+      sampleNs += debug_benchmark_now() - start;
+      channelsSampled += run->ChannelCount;
+    }
+    release_finished_runs(*benchAnimator);
+
+    for (size_t i = 0; i < entityCount; i++) {
+      game_entity& entity = entities[i];
+
+      uint64_t start = debug_benchmark_now();
+      reset_frame_animation_data(&entity, 1);
+      blend_animation_runs(entity, *benchAnimator, UINT32_MAX);
+      blendNs += debug_benchmark_now() - start;
+
+      start = debug_benchmark_now();
+      update_bone_transforms(entity);
+      boneTransformsNs += debug_benchmark_now() - start;
+
+      bonesBlended += entity.BoneCount;
+      entitiesUpdated++;
+    }
+  }
+
+  // FNV-1a over the raw matrices
+  result.Checksum = 2166136261u;
+  for (size_t i = 0; i < entityCount; i++) {
+    const game_entity& entity = entities[i];
+    const uint8_t* bytes = (const uint8_t*)entity.BoneTransforms;
+    for (size_t b = 0; b < sizeof(mat4x4) * entity.BoneCount; b++) {
+      result.Checksum = (result.Checksum ^ bytes[b]) * 16777619u;
+    }
+    for (size_t b = 0; b < entity.BoneCount; b++) {
+      for (int s = 0; s < 16; s++) {
+        result.Sum += entity.BoneTransforms[b].S[s];
+      }
+    }
+  }
+
+  result.SampleNsPerChannel =
+    channelsSampled > 0 ? (double)sampleNs / (double)channelsSampled : 0.0;
+  result.BlendNsPerBone =
+    bonesBlended > 0 ? (double)blendNs / (double)bonesBlended : 0.0;
+  result.BoneTransformsNsPerEntity =
+    entitiesUpdated > 0 ? (double)boneTransformsNs / (double)entitiesUpdated
+                        : 0.0;
+
+  return result;
+}
+
+void log_animation_benchmark(const animation_benchmark_result& result)
+{
+  DEBUG_LOG("Animation benchmark: %u frames, %zu entities\n"
+            "  sampling %.1f ns/channel\n"
+            "  blend %.1f ns/bone\n"
+            "  update_bone_transforms %.1f ns/entity\n"
+            "  checksum %08X sum %.6f\n",
+            result.Frames,
+            ANIMATION_BENCHMARK_ENTITIES,
+            result.SampleNsPerChannel,
+            result.BlendNsPerBone,
+            result.BoneTransformsNsPerEntity,
+            result.Checksum,
+            result.Sum);
+}
+
+#if HOKI_DEV
+// Reuses the animator and entities of the previous run
+void run_state_animation_benchmark(game_state& state)
+{
+  const Asset::model* playerModel = &state.Assets->OffenseModel;
+  const Asset::model* goalieModel = &state.Assets->GoalieModel;
+  if (state.BenchmarkAnimator == nullptr) {
+    create_animation_benchmark(playerModel,
+                               goalieModel,
+                               state.BenchmarkAnimator,
+                               state.BenchmarkEntities);
+  }
+
+  log_animation_benchmark(run_animation_benchmark(playerModel,
+                                                  goalieModel,
+                                                  state.BenchmarkAnimator,
+                                                  state.BenchmarkEntities,
+                                                  ANIMATION_BENCHMARK_SECONDS));
+}
+#endif
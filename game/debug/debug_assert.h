@@ -5,7 +5,7 @@
 #ifdef _WIN32
 #include <intrin.h>
 #define DBG_BREAK __debugbreak()
-#elif __ANDROID__
+#elif __ANDROID__ || __linux__
 #define DBG_BREAK raise(SIGTRAP);
 #endif
 #include <cstdarg>
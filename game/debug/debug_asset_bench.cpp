@@ -0,0 +1,44 @@
+/**
+ * Logs the average cache miss ratio, post-transform vertex cache misses per
+ * triangle, of the loaded models in their exported triangle order and in the
+ * one loadModel reorders them to. Reads the counts loadModel kept, loading
+ * the models again would not fit next to their textures.
+ */
+static double debug_get_acmr(const uint32_t cacheMisses,
+                             const size_t indexCount)
+{
+  return indexCount >= 3 ? (double)cacheMisses / (double)(indexCount / 3)
+                         : 0.0;
+}
+
+void run_asset_benchmark(const Asset::game_assets& assets)
+{
+  const Asset::model* const models[] = {
+    &assets.OffenseModel, &assets.GoalieModel, &assets.FieldModel,
+    &assets.StandsModel,  &assets.PostsModel,  &assets.SeatModel,
+    &assets.CrowdModel,   &assets.ArrowModel,  &assets.PuckModel
+  };
+  const size_t modelCount = sizeof(models) / sizeof(models[0]);
+
+  uint32_t exportedMisses = 0;
+  uint32_t optimizedMisses = 0;
+  size_t indexCount = 0;
+  DEBUG_LOG("Asset benchmark: %zu models\n", modelCount);
+  for (size_t i = 0; i < modelCount; i++) {
+    const Asset::model& model = *models[i];
+    DEBUG_LOG("  %s %zu vertices %zu triangles, ACMR %.3f -> %.3f\n",
+              model.Name,
+              model.VertexCount,
+              model.IndexCount / 3,
+              debug_get_acmr(model.ExportedCacheMisses, model.IndexCount),
+              debug_get_acmr(model.OptimizedCacheMisses, model.IndexCount));
+
+    exportedMisses += model.ExportedCacheMisses;
+    optimizedMisses += model.OptimizedCacheMisses;
+    indexCount += model.IndexCount;
+  }
+
+  DEBUG_LOG("  total ACMR %.3f -> %.3f\n",
+            debug_get_acmr(exportedMisses, indexCount),
+            debug_get_acmr(optimizedMisses, indexCount));
+}
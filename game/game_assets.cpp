@@ -50,17 +50,44 @@ static game_assets load_assets(game_memory& memory)
   assets.ShaderProgram = create_shader_program(
     VertexShader, FragmentShader, Asset::SHADER_TYPE_ANIMATED_MESH);
 
-  ogl_shader* PbrFragmentShader =
-    Asset::loadShader("/res/shaders/preprocessed/gl/pbr.frag", memory);
-  assets.PbrShaderProgram = create_shader_program(
-    VertexShader, PbrFragmentShader, Asset::SHADER_TYPE_PBR);
-
-  ogl_shader* PbrInstancedVertexShader = Asset::loadShader(
-    "/res/shaders/preprocessed/gl/vertex_shader_inst.vert", memory);
-  assets.PbrInstancedShaderProgram =
-    create_shader_program(PbrInstancedVertexShader,
-                          PbrFragmentShader,
-                          Asset::SHADER_TYPE_PBR_INSTANCED);
+  // Build generated specializations of vertexshader.vert and pbr.frag
+  char shaderPath[64];
+  ogl_shader* PbrVertexShaders[2];
+  ogl_shader* PbrInstancedVertexShaders[2];
+  for (uint32_t skinned = 0; skinned < 2; skinned++) {
+    snprintf(shaderPath,
+             sizeof(shaderPath),
+             "/res/shaders/preprocessed/gl/pbr_skinned%u.vert",
+             skinned);
+    PbrVertexShaders[skinned] = Asset::loadShader(shaderPath, memory);
+    snprintf(shaderPath,
+             sizeof(shaderPath),
+             "/res/shaders/preprocessed/gl/pbr_inst_skinned%u.vert",
+             skinned);
+    PbrInstancedVertexShaders[skinned] = Asset::loadShader(shaderPath, memory);
+  }
+  for (uint32_t variant = 0; variant < PBR_VARIANT_COUNT; variant++) {
+    const uint32_t skinned = variant & PBR_VARIANT_SKINNED;
+    ogl_shader* PbrFragmentShader = nullptr;
+    if (skinned == 0) {
+      snprintf(shaderPath,
+               sizeof(shaderPath),
+               "/res/shaders/preprocessed/gl/pbr_maps%u.frag",
+               variant >> 1);
+      PbrFragmentShader = Asset::loadShader(shaderPath, memory);
+    } else {
+      PbrFragmentShader = assets.PbrShaderPrograms[variant - 1].FragmentShader;
+    }
+
+    assets.PbrShaderPrograms[variant] = create_shader_program(
+      PbrVertexShaders[skinned], PbrFragmentShader, Asset::SHADER_TYPE_PBR);
+    assets.PbrShaderPrograms[variant].Variant = variant;
+    assets.PbrInstancedShaderPrograms[variant] =
+      create_shader_program(PbrInstancedVertexShaders[skinned],
+                            PbrFragmentShader,
+                            Asset::SHADER_TYPE_PBR_INSTANCED);
+    assets.PbrInstancedShaderPrograms[variant].Variant = variant;
+  }
 
   ogl_shader* TextVertexShader =
     Asset::loadShader("/res/shaders/gl/text.vert", memory);
@@ -162,6 +189,43 @@ static game_assets load_assets(game_memory& memory)
   return assets;
 }
 
+static void register_assets(render_residency& residency, game_assets& assets)
+{
+  register_render_model(residency, assets.OffenseModel);
+  register_render_model(residency, assets.GoalieModel);
+  register_render_model(residency, assets.FieldModel);
+  register_render_model(residency, assets.StandsModel);
+  register_render_model(residency, assets.PostsModel);
+  register_render_model(residency, assets.SeatModel);
+  register_render_model(residency, assets.CrowdModel);
+  register_render_model(residency, assets.ArrowModel);
+  register_render_model(residency, assets.PuckModel);
+
+  register_render_ui_texture(residency, assets.CursorTexture);
+  register_render_ui_texture(residency, assets.DebugDirectionTexture);
+  register_render_ui_texture(residency, assets.LogoTexture);
+  register_render_ui_texture(residency, assets.ButtonTexture);
+  register_render_ui_texture(residency, assets.ToggleTexture);
+  register_render_ui_texture(residency, assets.SoundToggleTexture);
+  register_render_ui_texture(residency, assets.JoystickHandleTexture);
+  register_render_ui_texture(residency, assets.JoystickBgTexture);
+  register_render_ui_texture(residency, assets.SliderHandleTexture);
+  register_render_ui_texture(residency, assets.SliderBgTexture);
+  register_render_ui_texture(residency, assets.TutorialTexture);
+  register_render_ui_texture(residency, assets.GoalTextTexture);
+  register_render_ui_texture(residency, assets.GoalFlash1Texture);
+  register_render_ui_texture(residency, assets.PuckFlashTexture);
+  register_render_ui_texture(residency, assets.GoalBackboardTexture);
+  register_render_ui_texture(residency, assets.GoalCounterZeroGoal);
+  register_render_ui_texture(residency, assets.GoalCounterOneGoal);
+  register_render_ui_texture(residency, assets.GoalCounterTwoGoal);
+  register_render_ui_texture(residency, assets.GoalCounterThreeGoal);
+  register_render_ui_texture(residency, assets.GoalCounterResetButtonTexture);
+  register_render_ui_texture(residency, assets.WinEndTexture);
+  register_render_ui_texture(residency, assets.NoWinEndTexture);
+  register_render_ui_texture(residency, assets.EndResetTexture);
+}
+
 static void compile_shaders(render_context& context, game_assets& assets)
 {
 #if HOKI_DEV
@@ -174,7 +238,11 @@ static void compile_shaders(render_context& context, game_assets& assets)
   add_rendercommand(context, assets.ShadowShaderProgram);
   add_rendercommand(context, assets.FillRevealShader);
   add_rendercommand(context, assets.UIShaderProgram);
-  add_rendercommand(context, assets.PbrShaderProgram);
-  add_rendercommand(context, assets.PbrInstancedShaderProgram);
+
+  // Every variant, models loaded or spawned later may draw with any of them
+  for (uint32_t variant = 0; variant < PBR_VARIANT_COUNT; variant++) {
+    add_rendercommand(context, assets.PbrShaderPrograms[variant]);
+    add_rendercommand(context, assets.PbrInstancedShaderPrograms[variant]);
+  }
 }
 }
\ No newline at end of file
@@ -19,8 +19,9 @@ struct game_assets
   ogl_shader_program TextShaderProgram;
   ogl_shader_program ShadowShaderProgram;
   ogl_shader_program FillRevealShader;
-  ogl_shader_program PbrShaderProgram;
-  ogl_shader_program PbrInstancedShaderProgram;
+  // Indexed by pbr_variant_flags
+  ogl_shader_program PbrShaderPrograms[PBR_VARIANT_COUNT];
+  ogl_shader_program PbrInstancedShaderPrograms[PBR_VARIANT_COUNT];
 
   font TestFont;
 
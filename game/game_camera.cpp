@@ -208,4 +208,12 @@ void camera_update_entity(game_camera& camera)
     v3 b = camera.TargetEntity->Position;
     camera.Target = a * (0.9f) + b * 0.1f;
   }
-}
\ No newline at end of file
+}
+frustum get_view_frustum(const game_camera& camera, const float aspectRatio)
+{
+  const mat4x4 projection = perspective_matrix(
+    CAMERA_FOV, aspectRatio, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+
+  return get_frustum_planes(projection *
+                            look_at(camera.Position, camera.Target));
+}
@@ -5,6 +5,11 @@
 
 #include "game_math.h"
 
+// Projection the renderer uses, the game culls against the same frustum
+static const float CAMERA_FOV = 90.0f;
+static const float CAMERA_NEAR_PLANE = 0.1f;
+static const float CAMERA_FAR_PLANE = 160.0f;
+
 struct game_camera
 {
   v2 Angle;
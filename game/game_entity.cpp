@@ -23,9 +23,51 @@ void create_entity(const char* name,
     outEntity.BoneTransforms, sizeof(mat4x4) * outEntity.BoneCount);
   outEntity.BoneWorldPositions = (mat4x4*)reallocate_t(
     outEntity.BoneWorldPositions, sizeof(mat4x4) * outEntity.BoneCount);
+  outEntity.PreviousBoneTransforms = (mat4x4*)reallocate_t(
+    outEntity.PreviousBoneTransforms, sizeof(mat4x4) * outEntity.BoneCount);
+  outEntity.SampledBoneTransforms = (mat4x4*)reallocate_t(
+    outEntity.SampledBoneTransforms, sizeof(mat4x4) * outEntity.BoneCount);
+
+  outEntity.NodeTransforms = (mat4x4*)reallocate_t(
+    outEntity.NodeTransforms, sizeof(mat4x4) * model->NodeCount);
+  for (size_t i = 0; i < model->NodeCount; i++) {
+    outEntity.NodeTransforms[i] = IDENTITY_MATRIX;
+  }
 
   for (size_t i = 0; i < outEntity.BoneCount; i++) {
     outEntity.BoneTransforms[i] = IDENTITY_MATRIX;
     outEntity.BoneWorldPositions[i] = IDENTITY_MATRIX;
+    outEntity.PreviousBoneTransforms[i] = IDENTITY_MATRIX;
+    outEntity.SampledBoneTransforms[i] = IDENTITY_MATRIX;
+  }
+  outEntity.AnimationLod = {};
+}
+
+// Rigid nodes follow their parents and the bones they are attached to,
+// skinned nodes are placed by the skinning matrices instead
+void update_node_transforms(game_entity& entity)
+{
+  const mat4x4 entityTransform = get_entity_transform(entity);
+
+  for (size_t n = 0; n < entity.Model->NodeCount; n++) {
+    const Asset::model_node* node = entity.Model->Nodes + n;
+    if (node->Mesh == nullptr) {
+      continue;
+    }
+
+    mat4x4 nodeTransform = node->Transform;
+    const Asset::model_node* parentNode = node->Parent;
+    while (!node->Skinned && parentNode) {
+      if (parentNode->BoneId > -1) {
+        nodeTransform =
+          entity.Bones[parentNode->BoneId].Transform * nodeTransform;
+      } else {
+        nodeTransform = parentNode->Transform * nodeTransform;
+      }
+
+      parentNode = parentNode->Parent;
+    }
+
+    entity.NodeTransforms[n] = entityTransform * nodeTransform;
   }
 }
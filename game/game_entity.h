@@ -28,10 +28,22 @@ struct game_entity
 
   mat4x4* BoneTransforms;
   mat4x4* BoneWorldPositions;
+  // World transform of each model node, updated when the entity is pushed
+  // for rendering
+  mat4x4* NodeTransforms;
+
+  // Last two sampled poses, BoneTransforms is interpolated between them when
+  // the LOD skips frames
+  AnimationSystem::animation_lod AnimationLod;
+  mat4x4* PreviousBoneTransforms;
+  mat4x4* SampledBoneTransforms;
 
   PhysicsSystem::body* Body;
   v3 BodyOffset;
 
+  // Set for scenery that never moves after the map is built
+  bool Static;
+
   AnimationSystem::run_id ActiveAnimations[10];
   size_t ActiveAnimationCount;
 };
@@ -40,6 +52,13 @@ struct instanced_entity : game_entity
 {
   int InstanceCount;
   v3 InstanceSpacing;
+
+  // When set, instances sample the baked palette by phase offset instead of
+  // using BoneTransforms
+  const AnimationSystem::baked_animation_run* BakedRun;
+
+  // Thinned out by the quality tier's crowd density
+  bool Crowd;
 };
 
 #endif // GAME_ENTITY_H
\ No newline at end of file
@@ -64,6 +64,23 @@ void handle_input(game_input_buffer& inputBuffer,
 #endif
         break;
 
+      case INPUT_CODE_NUM_6:
+#if HOKI_DEV
+        if (inputState == (INPUT_STATE_IS_UP | INPUT_STATE_CHANGED)) {
+          push_state_command(commandBuffer,
+                             DEBUG_COMMAND_RUN_ANIMATION_BENCHMARK);
+        }
+#endif
+        break;
+
+      case INPUT_CODE_NUM_7:
+#if HOKI_DEV
+        if (inputState == (INPUT_STATE_IS_UP | INPUT_STATE_CHANGED)) {
+          push_state_command(commandBuffer, DEBUG_COMMAND_RUN_ASSET_BENCHMARK);
+        }
+#endif
+        break;
+
       case INPUT_CODE_NO_OP:
         break;
 
@@ -18,6 +18,8 @@ enum game_input_code
   INPUT_CODE_NUM_3,
   INPUT_CODE_NUM_4,
   INPUT_CODE_NUM_5,
+  INPUT_CODE_NUM_6,
+  INPUT_CODE_NUM_7,
 
   INPUT_CODE_R // Record
 };
@@ -18,6 +18,7 @@
 #include "game_camera.cpp"
 #include "game_entity.cpp"
 #include "game_light.cpp"
+#include "game_quality.cpp"
 
 #include "imui_easing.cpp"
 #include "imui_system.cpp"
@@ -33,6 +34,11 @@
 #include "game_input.cpp"
 #include "game_light.h"
 
+#if HOKI_DEV
+#include "debug/debug_anim_bench.cpp"
+#include "debug/debug_asset_bench.cpp"
+#endif
+
 extern "C" GAME_MAIN(GameMain)
 {
   game_state& state = *((game_state*)gameMemory.PermanentStorage);
@@ -44,22 +50,38 @@ extern "C" GAME_MAIN(GameMain)
 #endif
     DEBUG_LOG("Initialized.\n");
     allocate(sizeof(game_state));
+    state.Residency = (render_residency*)allocate(sizeof(render_residency));
+    *state.Residency = {};
+    state.ShaderCache = (shader_cache*)allocate(sizeof(shader_cache));
+    load_shader_cache(gameMemory, *state.ShaderCache);
     Asset::game_assets* assets =
       (Asset::game_assets*)allocate_t(sizeof(Asset::game_assets));
     *assets = Asset::load_assets(gameMemory);
+    Asset::register_assets(*state.Residency, *assets);
     initialize_state(gameMemory, state, renderContext, assets);
   }
 
+  reset_render_commands(renderContext.Commands);
   if (!renderContext.Initialized) {
+    if (renderContext.Commands.FirstBlock == nullptr) {
+      init_render_commands(renderContext.Commands);
+    }
     renderContext.RenderableStore = (hash_table*)allocate(sizeof(hash_table));
     *renderContext.RenderableStore = create_hash_table(512);
+    clear_resident_ids(*state.Residency);
+    renderContext.Residency = state.Residency;
+    renderContext.ShaderCache = state.ShaderCache;
     Asset::compile_shaders(renderContext, *state.Assets);
 
-    renderContext.HighQuality = true;
+    renderContext.Quality = state.QualityController.Tier;
     UISystem::reset_context(&state.UIContext, renderContext);
     renderContext.Initialized = true;
     push_render_initialize(renderContext);
   }
+  // The renderer linked programs from source last frame
+  if (state.ShaderCache->Dirty) {
+    save_shader_cache(gameMemory, *state.ShaderCache);
+  }
 
 #if HOKI_DEV
   if (!memory_pools_loaded()) {
@@ -72,6 +94,10 @@ extern "C" GAME_MAIN(GameMain)
   state.RealTime += deltaTime;
   state.SimDelta = deltaTime * state.TimeScale;
   state.SimTime += deltaTime * state.TimeScale;
+  if (state.Phase != game_phase::PERF_TEST) {
+    renderContext.Quality =
+      update_quality_controller(state.QualityController, deltaTime);
+  }
 
   handle_input(inputBuffer, state.StateCommands);
 
@@ -101,83 +127,83 @@ extern "C" GAME_MAIN(GameMain)
     }
   }
 
-  AnimationSystem::reset_frame_animation_data(state.Map.EntitiesList,
-                                              MapSystem::ENTITY_COUNT);
-  AnimationSystem::reset_frame_animation_data(
-    state.Map.InstancedEntitiesList, MapSystem::INSTANCED_ENTITY_COUNT);
+#if HOKI_DEV
+  if (state.RunAnimationBenchmark) {
+    state.RunAnimationBenchmark = false;
+    run_state_animation_benchmark(state);
+  }
+  if (state.RunAssetBenchmark) {
+    state.RunAssetBenchmark = false;
+    run_asset_benchmark(*state.Assets);
+  }
+#endif
+
+  game_entity*
+    posedEntities[MapSystem::ENTITY_COUNT + MapSystem::INSTANCED_ENTITY_COUNT];
+  size_t posedEntityCount = 0;
+  for (size_t i = 0; i < MapSystem::ENTITY_COUNT; i++) {
+    posedEntities[posedEntityCount++] = &state.Map.EntitiesList[i];
+  }
+  for (size_t i = 0; i < MapSystem::INSTANCED_ENTITY_COUNT; i++) {
+    instanced_entity& entity = state.Map.InstancedEntitiesList[i];
+    if (entity.BakedRun == nullptr) {
+      posedEntities[posedEntityCount++] = &entity;
+    }
+  }
+
+  // LOD decides which runs need sampling, so it goes before the animator
+  const v3 viewPosition = get_view_camera(state).Position;
+  for (size_t i = 0; i < posedEntityCount; i++) {
+    AnimationSystem::update_animation_lod(
+      *posedEntities[i], viewPosition, state.Animator);
+  }
 
   state.Animator.DeltaTime = state.SimDelta;
   AnimationSystem::update_animator(&gameMemory, state.Animator);
+  AnimationSystem::update_baked_run(state.Cheer, state.SimDelta);
 
-  for (size_t i = 0; i < MapSystem::ENTITY_COUNT; i++) {
-    game_entity& entity = state.Map.EntitiesList[i];
-    AnimationSystem::validate_weights(
-      entity.ActiveAnimations, entity.ActiveAnimationCount, state.Animator);
-    for (uint32_t j = 0; j < entity.ActiveAnimationCount; j++) {
-      AnimationSystem::run_id runId = entity.ActiveAnimations[j];
-      animation_run* run = AnimationSystem::get_run(runId, state.Animator);
-      if (!AnimationSystem::run_active(run) || run->Weight == 0.0f) {
-        continue;
-      }
+  for (size_t i = 0; i < posedEntityCount; i++) {
+    AnimationSystem::push_entity_pose(
+      &gameMemory, state.Animator, *posedEntities[i]);
+  }
+  AnimationSystem::complete_entity_poses(&gameMemory, state.Animator);
 
-      for (uint32_t c = 0; c < run->ChannelCount; c++) {
-        AnimationSystem::animation_update_transform* transform =
-          run->ChannelTransforms + c;
-        Asset::model_bone* targetBone = entity.Bones + transform->BoneIndex;
-        switch (transform->PathType) {
-          case Asset::TRANSFORMATION:
-            targetBone->Translation += transform->NewTranslation * run->Weight;
-            targetBone->Rotation += transform->NewRotation * run->Weight;
-            targetBone->Scale += transform->NewScale * run->Weight;
-            break;
-          case Asset::TRANSLATION:
-            targetBone->Translation += transform->NewTranslation * run->Weight;
-            break;
-          case Asset::ROTATION:
-            targetBone->Rotation =
-              slerp(targetBone->Rotation, transform->NewRotation, run->Weight);
-            break;
-          case Asset::SCALE:
-            targetBone->Scale += transform->NewScale * run->Weight;
-            break;
-        }
-      }
-    }
-    AnimationSystem::update_bone_transforms(entity);
+  // Rigid nodes follow the pose, so they go after it and before submission
+  for (size_t i = 0; i < MapSystem::ENTITY_COUNT; i++) {
+    update_node_transforms(state.Map.EntitiesList[i]);
   }
   for (size_t i = 0; i < MapSystem::INSTANCED_ENTITY_COUNT; i++) {
-    instanced_entity& entity = state.Map.InstancedEntitiesList[i];
-    AnimationSystem::validate_weights(
-      entity.ActiveAnimations, entity.ActiveAnimationCount, state.Animator);
-    for (uint32_t j = 0; j < entity.ActiveAnimationCount; j++) {
-      AnimationSystem::run_id runId = entity.ActiveAnimations[j];
-      animation_run* run = AnimationSystem::get_run(runId, state.Animator);
-      for (uint32_t c = 0; c < run->ChannelCount; c++) {
-        AnimationSystem::animation_update_transform* transform =
-          run->ChannelTransforms + c;
-        Asset::model_bone* targetBone = entity.Bones + transform->BoneIndex;
-        switch (transform->PathType) {
-          case Asset::TRANSFORMATION:
-            targetBone->Translation += transform->NewTranslation;
-            targetBone->Rotation += transform->NewRotation;
-            targetBone->Scale += transform->NewScale;
-            break;
-          case Asset::TRANSLATION:
-            targetBone->Translation += transform->NewTranslation;
-            break;
-          case Asset::ROTATION:
-            targetBone->Rotation += transform->NewRotation;
-            break;
-          case Asset::SCALE:
-            targetBone->Scale += transform->NewScale;
-            break;
-        }
+    update_node_transforms(state.Map.InstancedEntitiesList[i]);
+  }
+
+#if HOKI_DEV
+  if (state.DebugCameraActive) {
+    push_render_update_camera(renderContext, &state.DebugCamera);
+  } else {
+    if (state.Phase == game_phase::REPLAYING) {
+      if (state.GoalTime < state.SimTime - state.ReadyTime) {
+        camera_update_entity(state.Map.ReplayCamera);
       }
+      push_render_update_camera(renderContext, &state.Map.ReplayCamera);
+    } else {
+      push_render_update_camera(renderContext, &state.Map.GameCamera);
     }
-    AnimationSystem::update_bone_transforms(entity);
   }
+#else
+  if (state.Phase == game_phase::REPLAYING) {
+    camera_update_entity(state.Map.ReplayCamera);
+    push_render_update_camera(renderContext, &state.Map.ReplayCamera);
+  } else {
+    push_render_update_camera(renderContext, &state.Map.GameCamera);
+  }
+#endif
 
-  push_render_map(renderContext, &state.Map);
+  // Culled against the camera pushed above, before any entity is submitted
+  const float aspectRatio =
+    (float)windowInfo.Width / (float)std::max(windowInfo.Height, 1);
+  const frustum viewFrustum =
+    get_view_frustum(get_view_camera(state), aspectRatio);
+  push_render_map(renderContext, &state.Map, viewFrustum);
 #if 0 // Animation debug
     static game_entity snnnnnnnek = create_entity(&state.Assets->SneikModel);
     static animation_run run =
@@ -207,28 +233,8 @@ add_debug_rendercommand(renderContext, snnnnnnnek);
   // finish UI
   UISystem::reset_context(&state.UIContext, renderContext);
 
-#if HOKI_DEV
-  if (state.DebugCameraActive) {
-    push_render_update_camera(renderContext, &state.DebugCamera);
-  } else {
-    if (state.Phase == game_phase::REPLAYING) {
-      if (state.GoalTime < state.SimTime - state.ReadyTime) {
-        camera_update_entity(state.Map.ReplayCamera);
-      }
-      push_render_update_camera(renderContext, &state.Map.ReplayCamera);
-    } else {
-      push_render_update_camera(renderContext, &state.Map.GameCamera);
-    }
-  }
-#else
-  if (state.Phase == game_phase::REPLAYING) {
-    camera_update_entity(state.Map.ReplayCamera);
-    push_render_update_camera(renderContext, &state.Map.ReplayCamera);
-  } else {
-    push_render_update_camera(renderContext, &state.Map.GameCamera);
-  }
-#endif
   push_setup_ui_context(renderContext, &state.UIContext);
+  end_render_commands(renderContext);
 }
 
 extern "C" GAME_GET_SOUND_SAMPLES(GameGetSoundSamples)
@@ -823,6 +823,18 @@ static mat4x4& operator*=(mat4x4& lhs, const float& rhs)
   return lhs = lhs * rhs;
 }
 
+static inline mat4x4 lerp(const mat4x4& lhs, const mat4x4& rhs, const float& t)
+{
+  mat4x4 result = {};
+
+  result.A = lerp(lhs.A, rhs.A, t);
+  result.B = lerp(lhs.B, rhs.B, t);
+  result.C = lerp(lhs.C, rhs.C, t);
+  result.D = lerp(lhs.D, rhs.D, t);
+
+  return result;
+}
+
 static inline mat4x4 operator*(const mat4x4& lhs, const mat4x4& rhs)
 {
   mat4x4 result = {};
@@ -1139,4 +1151,44 @@ static v3 get_midpoint_for_frustum(const mat4x4 projectionMatrix)
   return _v3((nearCenter + farCenter) * 0.5f);
 }
 
+// Planes point inwards, XYZ is the normal and W the distance from the origin
+struct frustum
+{
+  v4 Planes[6];
+};
+
+// Gribb-Hartmann, the planes are sums of the fourth row and the other rows
+static frustum get_frustum_planes(const mat4x4& viewProjection)
+{
+  frustum result = {};
+  for (int row = 0; row < 3; row++) {
+    v4& lower = result.Planes[row * 2];
+    v4& upper = result.Planes[row * 2 + 1];
+    for (int col = 0; col < 4; col++) {
+      lower.E[col] = viewProjection.M[col][3] + viewProjection.M[col][row];
+      upper.E[col] = viewProjection.M[col][3] - viewProjection.M[col][row];
+    }
+  }
+
+  for (int i = 0; i < 6; i++) {
+    result.Planes[i] = result.Planes[i] / length(result.Planes[i].XYZ);
+  }
+
+  return result;
+}
+
+static bool sphere_in_frustum(const frustum& frustum,
+                              const v3& center,
+                              const float radius)
+{
+  for (int i = 0; i < 6; i++) {
+    const v4& plane = frustum.Planes[i];
+    if (dot(plane.XYZ, center) + plane.W < -radius) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 #endif // GAME_MATH_H
\ No newline at end of file
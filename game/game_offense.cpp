@@ -14,6 +14,13 @@ STATE_ACTION(offense_setup_begin_skating_animation)
   animation* animations = offense.Model->Animations;
   AnimationSystem::run_id idleToSkateId = setup_animation(
     "Idle to Skate", animations, animationCount, state.Animator);
+  if (idleToSkateId == AnimationSystem::ANIMATION_NO_ID) {
+    // No run to wait for, start skating right away
+    push_state_command(state.StateCommands,
+                       COMMAND_OFFENSE_START_SKATING,
+                       state.SimTime - state.ReadyTime);
+    return;
+  }
   animation_run* idleToSkate = get_run(idleToSkateId, state.Animator);
   idleToSkate->LoopStyle = AnimationSystem::animation_loop_style::NO_LOOP;
 
@@ -29,8 +36,16 @@ void offense_setup_skating_animations(game_state& state)
   game_entity& offense = state.Map.Entities.Offense;
   size_t animationCount = state.Map.Entities.Offense.Model->AnimationCount;
   animation* animations = state.Map.Entities.Offense.Model->Animations;
+  // Runs that fail to start stay null, the charge update checks for them
+  state.Skate = nullptr;
+  state.SkateHard = nullptr;
+  state.ChargeUp = nullptr;
+
   AnimationSystem::run_id skateId =
     setup_animation("Slide", animations, animationCount, state.Animator);
+  if (skateId == AnimationSystem::ANIMATION_NO_ID) {
+    return;
+  }
 
   set_animation_for_entity(offense, skateId, state.Animator);
   state.Skate = AnimationSystem::get_run(skateId, state.Animator);
@@ -38,12 +53,18 @@ void offense_setup_skating_animations(game_state& state)
 
   AnimationSystem::run_id skateHardId =
     setup_animation("Skate", animations, animationCount, state.Animator);
+  if (skateHardId == AnimationSystem::ANIMATION_NO_ID) {
+    return;
+  }
 
   add_animation_for_entity(offense, skateHardId, state.Animator);
   state.SkateHard = AnimationSystem::get_run(skateHardId, state.Animator);
 
   AnimationSystem::run_id chargeUpId =
     setup_animation("ChargeUp", animations, animationCount, state.Animator);
+  if (chargeUpId == AnimationSystem::ANIMATION_NO_ID) {
+    return;
+  }
   add_animation_for_entity(offense, chargeUpId, state.Animator);
   state.ChargeUp = AnimationSystem::get_run(chargeUpId, state.Animator);
 #if 0 // launcher2
@@ -61,6 +82,9 @@ float offense_shoot_animation(game_state& state, float aimPower)
 
   AnimationSystem::run_id shootId = AnimationSystem::setup_animation(
     "Shoot", animations, animationCount, state.Animator);
+  if (shootId == AnimationSystem::ANIMATION_NO_ID) {
+    return 0.0f;
+  }
   AnimationSystem::set_animation_for_entity(offense, shootId, state.Animator);
   animation_run* shootAnim = AnimationSystem::get_run(shootId, state.Animator);
   shootAnim->LoopStyle = AnimationSystem::animation_loop_style::NO_LOOP;
@@ -68,30 +92,38 @@ float offense_shoot_animation(game_state& state, float aimPower)
     shootAnim->Animation->Duration * clamp(0.9f - aimPower, 0.0f, 0.9f);
   shootAnim->Loops = 1;
 
+  const float shootTimeLeft =
+    shootAnim->Animation->Duration - shootAnim->CurrentTime;
+
   AnimationSystem::run_id shootToSlideId = setup_animation(
     "Shoot to Slide", animations, animationCount, state.Animator);
+  if (shootToSlideId == AnimationSystem::ANIMATION_NO_ID) {
+    return shootTimeLeft - 0.2f;
+  }
   add_animation_for_entity(offense, shootToSlideId, state.Animator);
   animation_run* shootToSlide =
     AnimationSystem::get_run(shootToSlideId, state.Animator);
   shootToSlide->Loops = 1;
-  shootToSlide->StartDelay =
-    shootAnim->Animation->Duration - shootAnim->CurrentTime;
+  shootToSlide->StartDelay = shootTimeLeft;
   shootToSlide->LoopStyle = AnimationSystem::animation_loop_style::NO_LOOP;
 
   AnimationSystem::run_id slideId =
     setup_animation("Slide", animations, animationCount, state.Animator);
+  if (slideId == AnimationSystem::ANIMATION_NO_ID) {
+    return shootTimeLeft - 0.2f;
+  }
   add_animation_for_entity(offense, slideId, state.Animator);
 
   animation_run* slide = AnimationSystem::get_run(slideId, state.Animator);
   slide->StartDelay =
     shootToSlide->StartDelay + shootToSlide->Animation->Duration;
 
-  return shootAnim->Animation->Duration - shootAnim->CurrentTime - 0.2f;
+  return shootTimeLeft - 0.2f;
 }
 
 void offense_update_charge_animation(game_state& state)
 {
-  if (!(state.Skate && state.SkateHard)) {
+  if (!(state.Skate && state.SkateHard && state.ChargeUp)) {
     return;
   }
 
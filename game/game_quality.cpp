@@ -0,0 +1,70 @@
+#include "game_quality.h"
+
+static void reset_quality_window(quality_controller& controller)
+{
+  controller.FrameCount = 0;
+  controller.TimeSinceChange = 0.0f;
+}
+
+void init_quality_controller(quality_controller& controller,
+                             const render_quality tier)
+{
+  controller.Tier = tier;
+  controller.Automatic = true;
+  controller.UpgradeDelay = QUALITY_UPGRADE_DELAY_MIN;
+  controller.LastChangeWasUpgrade = false;
+  reset_quality_window(controller);
+}
+
+static void change_quality_tier(quality_controller& controller,
+                                const render_quality tier)
+{
+  const bool upgrade = tier > controller.Tier;
+  if (upgrade) {
+    controller.LastChangeWasUpgrade = true;
+  } else {
+    // The upgrade did not hold, wait longer before trying it again
+    if (controller.LastChangeWasUpgrade) {
+      controller.UpgradeDelay = std::min(controller.UpgradeDelay * 2.0f,
+                                         QUALITY_UPGRADE_DELAY_MAX);
+    }
+    controller.LastChangeWasUpgrade = false;
+  }
+
+  controller.Tier = tier;
+  reset_quality_window(controller);
+}
+
+render_quality update_quality_controller(quality_controller& controller,
+                                         const float frameDelta)
+{
+  controller.TimeSinceChange += frameDelta;
+  const uint32_t slot = controller.FrameCount++ % QUALITY_WINDOW_FRAMES;
+  controller.FrameTimes[slot] = std::min(frameDelta, QUALITY_MAX_FRAME_TIME);
+
+  if (!controller.Automatic ||
+      controller.FrameCount < QUALITY_WINDOW_FRAMES ||
+      controller.TimeSinceChange < QUALITY_CHANGE_COOLDOWN) {
+    return controller.Tier;
+  }
+
+  float average = 0.0f;
+  for (uint32_t i = 0; i < QUALITY_WINDOW_FRAMES; i++) {
+    average += controller.FrameTimes[i];
+  }
+  average /= (float)QUALITY_WINDOW_FRAMES;
+
+  if (average > QUALITY_TARGET_FRAME_TIME * QUALITY_DOWNGRADE_RATIO &&
+      controller.Tier > RENDER_QUALITY_LOW) {
+    change_quality_tier(controller, (render_quality)(controller.Tier - 1));
+  } else if (average < QUALITY_TARGET_FRAME_TIME * QUALITY_UPGRADE_RATIO &&
+             controller.Tier < RENDER_QUALITY_HIGH &&
+             controller.TimeSinceChange >= controller.UpgradeDelay) {
+    change_quality_tier(controller, (render_quality)(controller.Tier + 1));
+  } else if (controller.TimeSinceChange >= QUALITY_UPGRADE_DELAY_MAX) {
+    // Held for a good while, the tier is settled
+    controller.LastChangeWasUpgrade = false;
+  }
+
+  return controller.Tier;
+}
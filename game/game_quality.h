@@ -0,0 +1,36 @@
+#ifndef GAME_QUALITY_H
+#define GAME_QUALITY_H
+
+#include "game_render.h"
+
+// Frame time the tiers are chosen against, 30 FPS
+static const float QUALITY_TARGET_FRAME_TIME = 1.0f / 30.0f;
+static const uint32_t QUALITY_WINDOW_FRAMES = 60;
+// Above the target by this much drops a tier, below by this much raises one
+static const float QUALITY_DOWNGRADE_RATIO = 1.2f;
+static const float QUALITY_UPGRADE_RATIO = 0.7f;
+// Seconds to settle after a change before the next one is considered
+static const float QUALITY_CHANGE_COOLDOWN = 2.0f;
+static const float QUALITY_UPGRADE_DELAY_MIN = 5.0f;
+static const float QUALITY_UPGRADE_DELAY_MAX = 60.0f;
+// Hitches like loading or the app resuming must not drop the tier alone
+static const float QUALITY_MAX_FRAME_TIME = 0.25f;
+
+/**
+ * Averages the frame time over a window and moves a tier at a time. An upgrade
+ * that was dropped right away doubles the wait before the next one so a device
+ * on the edge of a tier does not flip back and forth.
+ */
+struct quality_controller
+{
+  render_quality Tier;
+  bool Automatic;
+
+  float FrameTimes[QUALITY_WINDOW_FRAMES];
+  uint32_t FrameCount;
+  float TimeSinceChange;
+  float UpgradeDelay;
+  bool LastChangeWasUpgrade;
+};
+
+#endif // GAME_QUALITY_H
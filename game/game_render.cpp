@@ -24,23 +24,408 @@ void add_ui_renderable(const hash_table& renderableCache,
   }
 }
 
-render_command& create_render_command(render_context& context)
+void register_render_handle(render_residency& residency,
+                            uint32_t& handle,
+                            const render_resource_type type,
+                            const void* data)
 {
-  return context.Commands.Commands[context.Commands.Count++];
+  if (residency.HandleCount + 1 >= RENDER_HANDLE_MAX_COUNT) {
+    if (residency.DroppedCount++ == 0) {
+      DEBUG_LOG("Render handles full (%u), resources past them are not drawn\n",
+                RENDER_HANDLE_MAX_COUNT);
+    }
+    handle = RENDER_NO_HANDLE;
+    return;
+  }
+  handle = ++residency.HandleCount;
+  residency.Ids[handle] = 0;
+  residency.Resources[handle].Type = type;
+  residency.Resources[handle].Data = data;
+}
+
+void register_render_texture(render_residency& residency, texture& texture)
+{
+  register_render_handle(
+    residency, texture.RenderHandle, RENDER_RESOURCE_TEXTURE, &texture);
+}
+
+// UI images are sampled unfiltered, so they upload differently
+void register_render_ui_texture(render_residency& residency, texture& texture)
+{
+  register_render_handle(
+    residency, texture.RenderHandle, RENDER_RESOURCE_UI_TEXTURE, &texture);
+}
+
+void register_render_model(render_residency& residency, Asset::model& model)
+{
+  register_render_handle(
+    residency, model.RenderHandle, RENDER_RESOURCE_MODEL, &model);
+  for (size_t i = 0; i < model.TextureCount; i++) {
+    register_render_texture(residency, model.Textures[i]);
+  }
+  // Material slots are cheap to fill, they stay on the first draw
+  for (size_t i = 0; i < model.MaterialCount; i++) {
+    register_render_handle(residency,
+                           model.Materials[i].RenderHandle,
+                           RENDER_RESOURCE_NONE,
+                           model.Materials + i);
+  }
+}
+
+// GL objects die with their context, the handles stay valid
+void clear_resident_ids(render_residency& residency)
+{
+  for (uint32_t i = 0; i < RENDER_HANDLE_MAX_COUNT; i++) {
+    residency.Ids[i] = 0;
+  }
+  residency.UploadCursor = 0;
+}
+
+static void reset_shader_cache(shader_cache& cache)
+{
+  cache.Version = SHADER_CACHE_VERSION;
+  cache.DriverHash = 0;
+  cache.EntryCount = 0;
+  cache.DataSize = 0;
+  cache.Dirty = false;
+}
+
+// A missing, stale or damaged file leaves the cache empty
+void load_shader_cache(game_memory& memory, shader_cache& cache)
+{
+  reset_shader_cache(cache);
+
+  const size_t headerBytes = offsetof(shader_cache, Data);
+  const size_t size = memory.GetFileSize(SHADER_CACHE_PATH);
+  if (size < headerBytes || size > sizeof(shader_cache)) {
+    return;
+  }
+
+  memory.ReadFile(SHADER_CACHE_PATH, (uint8_t*)&cache);
+  if (cache.Version != SHADER_CACHE_VERSION ||
+      cache.EntryCount > SHADER_CACHE_MAX_PROGRAMS ||
+      headerBytes + cache.DataSize != size) {
+    reset_shader_cache(cache);
+    return;
+  }
+  for (uint32_t i = 0; i < cache.EntryCount; i++) {
+    const shader_cache_entry& entry = cache.Entries[i];
+    if ((size_t)entry.Offset + entry.Size > cache.DataSize) {
+      reset_shader_cache(cache);
+      return;
+    }
+  }
+  cache.Dirty = false;
+}
+
+void save_shader_cache(game_memory& memory, shader_cache& cache)
+{
+  cache.Dirty = false;
+  memory.WriteFile(
+    SHADER_CACHE_PATH, &cache, offsetof(shader_cache, Data) + cache.DataSize);
+}
+
+static size_t align_render_command_size(const size_t size)
+{
+  return (size + RENDER_COMMAND_ALIGNMENT - 1) & ~(RENDER_COMMAND_ALIGNMENT - 1);
+}
+
+static render_command_block* create_render_command_block(const size_t capacity)
+{
+  uint8_t* memory = (uint8_t*)allocate_t(sizeof(render_command_block) +
+                                         capacity + RENDER_COMMAND_ALIGNMENT);
+  render_command_block* block = (render_command_block*)memory;
+  *block = {};
+  block->Data = (uint8_t*)align_render_command_size((size_t)(block + 1));
+  block->Capacity = capacity;
+
+  return block;
+}
+
+void init_render_commands(render_command_buffer& buffer)
+{
+  buffer = {};
+  buffer.FirstBlock = create_render_command_block(RENDER_COMMAND_BLOCK_SIZE);
+  buffer.CurrentBlock = buffer.FirstBlock;
+}
+
+void reset_render_commands(render_command_buffer& buffer)
+{
+  for (render_command_block* block = buffer.FirstBlock; block != nullptr;
+       block = block->Next) {
+    block->Size = 0;
+  }
+  buffer.CurrentBlock = buffer.FirstBlock;
+  buffer.FirstCommand = nullptr;
+  buffer.LastCommand = nullptr;
+  buffer.Count = 0;
+  buffer.DroppedCount = 0;
+}
+
+/**
+ * Takes size bytes from the current block, or from the next one when it is
+ * full. Blocks past the current one are unused this frame, one is chained in
+ * after it when the next is missing or too small.
+ */
+static void* push_render_command_memory(render_command_buffer& buffer,
+                                        const size_t size)
+{
+  render_command_block* block = buffer.CurrentBlock;
+  if (block->Size + size > block->Capacity) {
+    if (block->Next == nullptr || block->Next->Capacity < size) {
+      render_command_block* newBlock = create_render_command_block(
+        size > RENDER_COMMAND_BLOCK_SIZE ? size : RENDER_COMMAND_BLOCK_SIZE);
+      newBlock->Next = block->Next;
+      block->Next = newBlock;
+    }
+    block = block->Next;
+    buffer.CurrentBlock = block;
+  }
+
+  void* result = block->Data + block->Size;
+  block->Size += size;
+  return result;
+}
+
+/**
+ * Reserves the renderer's tables for the frame's commands in the blocks
+ * after them, once the game is done recording.
+ */
+void end_render_commands(render_context& context)
+{
+  render_command_buffer& buffer = context.Commands;
+  context.SortedCommandCapacity = buffer.Count * RENDER_SORT_ENTRIES_PER_COMMAND;
+  context.SortedCommands = (render_sort_entry*)push_render_command_memory(
+    buffer,
+    align_render_command_size(sizeof(render_sort_entry) *
+                              context.SortedCommandCapacity));
+  context.BonePaletteOffsets = (uint32_t*)push_render_command_memory(
+    buffer, align_render_command_size(sizeof(uint32_t) * buffer.Count));
+}
+
+/**
+ * Appends a command followed by payloadSize bytes, zeroed. Returns nullptr
+ * past RENDER_COMMAND_MAX_COUNT, the command is then dropped for this frame.
+ */
+render_command* create_render_command(render_context& context,
+                                      const render_command_type type,
+                                      const size_t payloadSize = 0)
+{
+  render_command_buffer& buffer = context.Commands;
+  if (buffer.Count >= RENDER_COMMAND_MAX_COUNT) {
+    HOKI_WARN_MESSAGE(buffer.DroppedCount > 0,
+                      "Render command stream full, dropping commands (%u)",
+                      buffer.Count);
+    buffer.DroppedCount++;
+    return nullptr;
+  }
+
+  const size_t commandSize =
+    align_render_command_size(sizeof(render_command) + payloadSize);
+  render_command* command =
+    (render_command*)push_render_command_memory(buffer, commandSize);
+  memset(command, 0, commandSize);
+  command->Type = type;
+  command->Size = (uint32_t)commandSize;
+
+  if (buffer.LastCommand != nullptr) {
+    buffer.LastCommand->Next = command;
+  } else {
+    buffer.FirstCommand = command;
+  }
+  buffer.LastCommand = command;
+  buffer.Count++;
+
+  return command;
+}
+
+static bool has_translucent_material(const Asset::model& model)
+{
+  for (size_t i = 0; i < model.MaterialCount; i++) {
+    if (model.Materials[i].Translucent) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static mat4x4 get_entity_transform(const game_entity& entity)
+{
+  return mat4x4_translate(entity.Position) * quat_to_mat4x4(entity.Rotation) *
+         mat4x4_scale(entity.Scale);
+}
+
+/** Culling */
+// Skinned models pose outside their rest bounds, they get some slack
+static const float CULL_SKINNED_BOUNDS_SCALE = 1.5f;
+// Instances are culled in groups along a row, then merged into ranges
+static const int INSTANCE_CULL_GROUP_SIZE = 8;
+static const uint32_t INSTANCE_RANGE_MAX_COUNT = 32;
+
+static float get_bounds_radius(const game_entity& entity)
+{
+  const float scale =
+    max_f(entity.Scale.X, max_f(entity.Scale.Y, entity.Scale.Z));
+  float radius = entity.Model->BoundsRadius * scale;
+  if (entity.Model->BoneCount > 0) {
+    radius *= CULL_SKINNED_BOUNDS_SCALE;
+  }
+
+  return radius;
+}
+
+static v3 get_bounds_center(const game_entity& entity)
+{
+  const v4 center =
+    get_entity_transform(entity) * _v4(entity.Model->BoundsCenter, 1.0f);
+
+  return center.XYZ;
+}
+
+// Models without bounds are always drawn
+static bool entity_in_frustum(const game_entity& entity,
+                              const frustum& frustum)
+{
+  if (entity.Model->BoundsRadius <= 0.0f) {
+    return true;
+  }
+
+  return sphere_in_frustum(
+    frustum, get_bounds_center(entity), get_bounds_radius(entity));
+}
+
+// Same layout as the instanced vertex shader, in model space
+static v3 get_instance_offset(const instanced_entity& entity,
+                              const int instance)
+{
+  const int cols = (entity.InstanceCount / 4) + 1;
+  const int row = (instance / cols) + 1;
+  const v3& spacing = entity.InstanceSpacing;
+  float x = (float)(instance % cols) * spacing.X;
+  if (row % 2 != 0) {
+    x += spacing.X * 0.5f;
+  }
+
+  return _v3(x, (float)row * spacing.Y, (float)row * spacing.Z);
+}
+
+/**
+ * Fills outRanges with the visible instances, neighbouring groups share a
+ * range so the renderer issues as few draws as possible. Returns the range
+ * count, zero when the whole entity is outside the frustum.
+ */
+// Instances before firstInstance are never drawn
+static uint32_t cull_instances(const instanced_entity& entity,
+                               const frustum& frustum,
+                               const int firstInstance,
+                               render_instance_range* outRanges)
+{
+  const int instanceCount = entity.InstanceCount;
+  if (entity.Model->BoundsRadius <= 0.0f) {
+    outRanges[0].First = (uint32_t)firstInstance;
+    outRanges[0].Count = (uint32_t)(instanceCount - firstInstance);
+    return instanceCount > firstInstance ? 1 : 0;
+  }
+
+  const mat4x4 transform = get_entity_transform(entity);
+  const float scale =
+    max_f(entity.Scale.X, max_f(entity.Scale.Y, entity.Scale.Z));
+  const float radius = get_bounds_radius(entity);
+  const int cols = (instanceCount / 4) + 1;
+
+  uint32_t rangeCount = 0;
+  int first = firstInstance;
+  while (first < instanceCount) {
+    const int rowEnd = ((first / cols) + 1) * cols;
+    const int end = std::min(first + INSTANCE_CULL_GROUP_SIZE,
+                             std::min(rowEnd, instanceCount));
+
+    const v3 firstOffset = get_instance_offset(entity, first);
+    const v3 lastOffset = get_instance_offset(entity, end - 1);
+    const v3 groupCenter =
+      entity.Model->BoundsCenter + (firstOffset + lastOffset) * 0.5f;
+    const float groupRadius =
+      radius + length(lastOffset - firstOffset) * 0.5f * scale;
+    const v4 center = transform * _v4(groupCenter, 1.0f);
+
+    if (sphere_in_frustum(frustum, center.XYZ, groupRadius)) {
+      render_instance_range* last =
+        rangeCount > 0 ? outRanges + rangeCount - 1 : nullptr;
+      if (last != nullptr && (last->First + last->Count == (uint32_t)first ||
+                              rangeCount == INSTANCE_RANGE_MAX_COUNT)) {
+        last->Count = (uint32_t)end - last->First;
+      } else {
+        outRanges[rangeCount].First = (uint32_t)first;
+        outRanges[rangeCount].Count = (uint32_t)(end - first);
+        rangeCount++;
+      }
+    }
+
+    first = end;
+  }
+
+  return rangeCount;
+}
+
+// Copies the transform and current pose, the renderer never reads them from
+// the entity
+static render_command* create_entity_command(
+  render_context& context,
+  const render_command_type type,
+  const game_entity& entity,
+  const uint32_t instanceRangeCount = 0)
+{
+  if (entity.Model->RenderHandle == RENDER_NO_HANDLE) {
+    return nullptr;
+  }
+
+  const size_t nodeCount = entity.Model->NodeCount;
+  render_command* command = create_render_command(
+    context,
+    type,
+    sizeof(render_entity_state) +
+      sizeof(mat4x4) * (entity.BoneCount + nodeCount) +
+      sizeof(render_instance_range) * instanceRangeCount);
+  if (command == nullptr) {
+    return nullptr;
+  }
+
+  render_entity_state* state =
+    (render_entity_state*)get_render_command_data(command);
+  state->Position = entity.Position;
+  state->Rotation = entity.Rotation;
+  state->Scale = entity.Scale;
+  state->BoundsCenter = get_bounds_center(entity);
+  state->BoundsRadius = get_bounds_radius(entity);
+  state->BoneCount = (uint32_t)entity.BoneCount;
+  state->NodeCount = (uint32_t)nodeCount;
+  state->InstanceRangeCount = instanceRangeCount;
+  mat4x4* matrices = (mat4x4*)(state + 1);
+  if (entity.BoneCount > 0) {
+    memcpy(matrices, entity.BoneTransforms, sizeof(mat4x4) * entity.BoneCount);
+  }
+  memcpy(matrices + entity.BoneCount,
+         entity.NodeTransforms,
+         sizeof(mat4x4) * nodeCount);
+
+  return command;
 }
 
 void push_render_initialize(render_context& context)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_INITIALIZE;
+  create_render_command(context, RENDER_COMMAND_TYPE_INITIALIZE);
 }
 
 #if HOKI_DEV
 void add_debug_rendercommand(render_context& context, const game_entity* entity)
 {
-  render_command& command = create_render_command(context);
-  command.Type = DEBUG_RENDER_COMMAND_TYPE_BONES;
-  command.Entity = entity;
+  render_command* command =
+    create_render_command(context, DEBUG_RENDER_COMMAND_TYPE_BONES);
+  if (command == nullptr) {
+    return;
+  }
+  command->Entity = entity;
   for (size_t i = 0; i < entity->Model->BoneCount; i++) {
     add_renderable(*context.RenderableStore, entity->Model->Bones + i);
   }
@@ -49,17 +434,21 @@ void add_debug_rendercommand(render_context& context, const game_entity* entity)
 void add_debug_rendercommand(render_context& context,
                              const debug_render_line* line)
 {
-  render_command& command = create_render_command(context);
-  command.Type = DEBUG_RENDER_COMMAND_TYPE_LINE;
-  command.Line = line;
+  render_command* command = create_render_command(
+    context, DEBUG_RENDER_COMMAND_TYPE_LINE, sizeof(debug_render_line));
+  if (command != nullptr) {
+    *(debug_render_line*)get_render_command_data(command) = *line;
+  }
 }
 
 void add_debug_rendercommand(render_context& context,
                              const PhysicsSystem::body* body)
 {
-  render_command& command = create_render_command(context);
-  command.Type = DEBUG_RENDER_COMMAND_TYPE_PHYSICS_BODY;
-  command.Body = body;
+  render_command* command =
+    create_render_command(context, DEBUG_RENDER_COMMAND_TYPE_PHYSICS_BODY);
+  if (command != nullptr) {
+    command->Body = body;
+  }
 }
 
 void add_debug_rendercommand(render_context& context,
@@ -72,16 +461,20 @@ void add_debug_rendercommand(render_context& context,
 
 void debug_push_render_light(render_context& context, const game_light* light)
 {
-  render_command& command = create_render_command(context);
-  command.Type = DEBUG_RENDER_COMMAND_TYPE_LIGHT;
-  command.Light = light;
+  render_command* command = create_render_command(
+    context, DEBUG_RENDER_COMMAND_TYPE_LIGHT, sizeof(game_light));
+  if (command != nullptr) {
+    *(game_light*)get_render_command_data(command) = *light;
+  }
 }
 
 void debug_push_render_cube(render_context& context, const v3* position)
 {
-  render_command& command = create_render_command(context);
-  command.Type = DEBUG_RENDER_COMMAND_TYPE_CUBE;
-  command.CubePos = position;
+  render_command* command = create_render_command(
+    context, DEBUG_RENDER_COMMAND_TYPE_CUBE, sizeof(v3));
+  if (command != nullptr) {
+    *(v3*)get_render_command_data(command) = *position;
+  }
 }
 #else
 void add_debug_rendercommand(render_context& context, const game_entity& entity)
@@ -101,77 +494,120 @@ void debug_push_render_light(render_context& context, const game_light* light)
 void debug_push_render_cuber(render_context& context, const v3 position) {}
 #endif
 
-void push_render_entity(render_context& context, const game_entity* entity)
+// Entities outside the view are still pushed, they cast shadows into it
+void push_render_entity(render_context& context,
+                        const game_entity* entity,
+                        const frustum& viewFrustum)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_ENTITY;
-  command.Entity = entity;
-
-  add_renderable(*context.RenderableStore, entity->Model);
-  for (size_t i = 0; i < entity->Model->TextureCount; i++) {
-    add_renderable(*context.RenderableStore, entity->Model->Textures + i);
+  render_command* command =
+    create_entity_command(context, RENDER_COMMAND_TYPE_ENTITY, *entity);
+  if (command == nullptr) {
+    return;
   }
-  for (size_t i = 0; i < entity->Model->MaterialCount; i++) {
-    if (entity->Model->Materials[i].Translucent) {
-      render_command& translucentCommand = create_render_command(context);
-      translucentCommand.Entity = entity;
-      translucentCommand.Type = RENDER_COMMAND_TYPE_TRANSLUCENT;
-      break;
-    }
+  command->Entity = entity;
+  if (has_translucent_material(*entity->Model)) {
+    command->Flags |= RENDER_TRANSLUCENT;
+  }
+  if (!entity_in_frustum(*entity, viewFrustum)) {
+    command->Flags |= RENDER_OUTSIDE_VIEW;
+  }
+  if (entity->Static) {
+    command->Flags |= RENDER_STATIC;
   }
 }
 
 void push_render_instanced(render_context& context,
-                           const instanced_entity* entity)
-{
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_INSTANCED;
-  command.InstancedEntity = entity;
-
-  add_renderable(*context.RenderableStore, entity->Model);
-  for (size_t i = 0; i < entity->Model->TextureCount; i++) {
-    add_renderable(*context.RenderableStore, entity->Model->Textures + i);
-  }
-  for (size_t i = 0; i < entity->Model->MaterialCount; i++) {
-    if (entity->Model->Materials[i].Translucent) {
-      render_command& translucentCommand = create_render_command(context);
-      translucentCommand.Entity = entity;
-      translucentCommand.Type = RENDER_COMMAND_TYPE_TRANSLUCENT;
-      break;
-    }
+                           const instanced_entity* entity,
+                           const frustum& viewFrustum)
+{
+  // The first rows are the back of the stands, a thinner crowd drops them
+  int firstInstance = 0;
+  if (entity->Crowd) {
+    const float density = RENDER_QUALITY_TIERS[context.Quality].CrowdDensity;
+    firstInstance =
+      entity->InstanceCount -
+      (int)std::ceil((float)entity->InstanceCount * density);
+  }
+
+  render_instance_range ranges[INSTANCE_RANGE_MAX_COUNT];
+  const uint32_t rangeCount =
+    cull_instances(*entity, viewFrustum, firstInstance, ranges);
+  if (rangeCount == 0) {
+    return;
+  }
+
+  render_command* command = create_entity_command(
+    context, RENDER_COMMAND_TYPE_INSTANCED, *entity, rangeCount);
+  if (command == nullptr) {
+    return;
+  }
+  command->InstancedEntity = entity;
+  if (has_translucent_material(*entity->Model)) {
+    command->Flags |= RENDER_TRANSLUCENT;
+  }
+
+  render_entity_state* state =
+    (render_entity_state*)get_render_command_data(command);
+  memcpy(get_instance_ranges(state),
+         ranges,
+         sizeof(render_instance_range) * rangeCount);
+  if (entity->BakedRun != nullptr && entity->BakedRun->Baked != nullptr) {
+    state->BakedTime = entity->BakedRun->CurrentTime;
   }
 }
 
 void push_render_update_camera(render_context& context,
                                const game_camera* camera)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_CAMERA;
-  command.Camera = camera;
+  render_command* command = create_render_command(
+    context, RENDER_COMMAND_TYPE_CAMERA, sizeof(game_camera));
+  if (command != nullptr) {
+    *(game_camera*)get_render_command_data(command) = *camera;
+  }
 }
 
 void add_rendercommand(render_context& context,
                        const ogl_shader_program& shaderProgram)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_CREATE_SHADER;
-  command.ShaderProgram = &shaderProgram;
+  render_command* command =
+    create_render_command(context, RENDER_COMMAND_TYPE_CREATE_SHADER);
+  if (command == nullptr) {
+    return;
+  }
+  command->ShaderProgram = &shaderProgram;
   add_renderable(*context.RenderableStore, shaderProgram.VertexShader);
   add_renderable(*context.RenderableStore, shaderProgram.FragmentShader);
 }
 
 void push_render_light(render_context& context, const game_light* light)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_LIGHT;
-  command.Light = light;
+  render_command* command = create_render_command(
+    context, RENDER_COMMAND_TYPE_LIGHT, sizeof(game_light));
+  if (command != nullptr) {
+    *(game_light*)get_render_command_data(command) = *light;
+  }
 }
 
 void rendercommand_text(render_context& context, const UISystem::ui_text* text)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_TEXT;
-  command.Text = text;
+  // RenderText walks the codepoints up to their terminator
+  const size_t codepointsSize =
+    sizeof(uint32_t) * (text->CodepointData.CodepointCount + 1);
+  render_command* command =
+    create_render_command(context,
+                          RENDER_COMMAND_TYPE_TEXT,
+                          sizeof(UISystem::ui_text) + codepointsSize);
+  if (command == nullptr) {
+    return;
+  }
+  // The codepoints follow the text, the caller's buffer may not outlive it
+  UISystem::ui_text* textCopy =
+    (UISystem::ui_text*)get_render_command_data(command);
+  *textCopy = *text;
+  textCopy->CodepointData.Codepoints = (uint32_t*)(textCopy + 1);
+  memcpy(textCopy->CodepointData.Codepoints,
+         text->CodepointData.Codepoints,
+         codepointsSize);
   for (uint32_t i = 0; i < text->CodepointData.CodepointCount; i++) {
     uint32_t codepoint = text->CodepointData.Codepoints[i];
     uint32_t key = codepoint;
@@ -180,15 +616,25 @@ void rendercommand_text(render_context& context, const UISystem::ui_text* text)
 #if HOKI_DEV
     HOKI_ASSERT(characterInfo->DEBUGCodepoint == codepoint);
 #endif
-    add_renderable(*context.RenderableStore, characterInfo);
+    // Glyphs are rasterized on demand, so they get their handle on first use
+    if (characterInfo->RenderHandle == RENDER_NO_HANDLE) {
+      register_render_handle(*context.Residency,
+                             characterInfo->RenderHandle,
+                             RENDER_RESOURCE_NONE,
+                             characterInfo);
+    }
   }
 }
 
-void push_render_map(render_context& context, const MapSystem::map* map)
+void push_render_map(render_context& context,
+                     const MapSystem::map* map,
+                     const frustum& viewFrustum)
 {
-  render_command& shadowCommand = create_render_command(context);
-  shadowCommand.Map = map;
-  shadowCommand.Type = RENDER_COMMAND_TYPE_SHADOW;
+  render_command* shadowCommand =
+    create_render_command(context, RENDER_COMMAND_TYPE_SHADOW);
+  if (shadowCommand != nullptr) {
+    shadowCommand->Map = map;
+  }
 
   for (size_t i = 0; i < ARRAY_SIZE(map->Lights); i++) {
     push_render_light(context, map->Lights + i);
@@ -198,60 +644,75 @@ void push_render_map(render_context& context, const MapSystem::map* map)
   }
 
   for (size_t i = 0; i < ARRAY_SIZE(map->EntitiesList); i++) {
-    push_render_entity(context, &map->EntitiesList[i]);
+    push_render_entity(context, &map->EntitiesList[i], viewFrustum);
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(map->InstancedEntitiesList); i++) {
+    push_render_instanced(
+      context, &map->InstancedEntitiesList[i], viewFrustum);
   }
 }
 
 void push_setup_ui_context(render_context& renderContext,
                            UISystem::ui_context* uiContext)
 {
-  render_command& command = create_render_command(renderContext);
-  command.Type = RENDER_COMMAND_TYPE_UI_CONTEXT;
-  command.UIContext = uiContext;
+  render_command* command =
+    create_render_command(renderContext, RENDER_COMMAND_TYPE_UI_CONTEXT);
+  if (command != nullptr) {
+    command->UIContext = uiContext;
+  }
 }
 
 void push_render_icon(render_context& context, const UISystem::ui_icon* icon)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_UI_ICON;
-  command.Icon = icon;
-  add_renderable(*context.RenderableStore, icon->Image);
+  render_command* command =
+    create_render_command(
+      context, RENDER_COMMAND_TYPE_UI_ICON, sizeof(UISystem::ui_icon));
+  if (command != nullptr) {
+    *(UISystem::ui_icon*)get_render_command_data(command) = *icon;
+  }
 }
 
 void add_rendercommand(render_context& context,
                        const UISystem::ui_button* button)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_UI_BUTTON;
-  command.Button = button;
-  add_renderable(*context.RenderableStore, button->Image);
+  render_command* command =
+    create_render_command(
+      context, RENDER_COMMAND_TYPE_UI_BUTTON, sizeof(UISystem::ui_button));
+  if (command != nullptr) {
+    *(UISystem::ui_button*)get_render_command_data(command) = *button;
+  }
 }
 
 void add_rendercommand(render_context& context,
                        const UISystem::ui_toggle* toggle)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_UI_TOGGLE;
-  command.Toggle = toggle;
-  add_renderable(*context.RenderableStore, toggle->Image);
+  render_command* command =
+    create_render_command(
+      context, RENDER_COMMAND_TYPE_UI_TOGGLE, sizeof(UISystem::ui_toggle));
+  if (command != nullptr) {
+    *(UISystem::ui_toggle*)get_render_command_data(command) = *toggle;
+  }
 }
 
 void add_rendercommand(render_context& context,
                        const UISystem::ui_joystick* joystick)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_UI_JOYSTICK;
-  command.Joystick = joystick;
-  add_renderable(*context.RenderableStore, joystick->Handle);
-  add_renderable(*context.RenderableStore, joystick->Background);
+  render_command* command =
+    create_render_command(
+      context, RENDER_COMMAND_TYPE_UI_JOYSTICK, sizeof(UISystem::ui_joystick));
+  if (command != nullptr) {
+    *(UISystem::ui_joystick*)get_render_command_data(command) = *joystick;
+  }
 }
 
 void add_rendercommand(render_context& context,
                        const UISystem::ui_slider* slider)
 {
-  render_command& command = create_render_command(context);
-  command.Type = RENDER_COMMAND_TYPE_UI_SLIDER;
-  command.Slider = slider;
-  add_renderable(*context.RenderableStore, slider->Handle);
-  add_renderable(*context.RenderableStore, slider->Background);
+  render_command* command =
+    create_render_command(
+      context, RENDER_COMMAND_TYPE_UI_SLIDER, sizeof(UISystem::ui_slider));
+  if (command != nullptr) {
+    *(UISystem::ui_slider*)get_render_command_data(command) = *slider;
+  }
 }
@@ -77,43 +77,236 @@ struct renderable
   uint32_t RenderId;
 };
 
+static const uint32_t RENDER_NO_HANDLE = 0;
+static const uint32_t RENDER_HANDLE_MAX_COUNT = 4096;
+
+// Resources the renderer uploads ahead of the first draw that needs them
+enum render_resource_type
+{
+  RENDER_RESOURCE_NONE,
+  RENDER_RESOURCE_TEXTURE,
+  RENDER_RESOURCE_UI_TEXTURE,
+  RENDER_RESOURCE_MODEL,
+  RENDER_RESOURCE_BAKED_POSE
+};
+
+struct render_resource
+{
+  render_resource_type Type;
+  const void* Data;
+};
+
+/**
+ * Textures, models, materials, baked poses and glyphs get a dense handle when
+ * they are loaded, the renderer keeps their GL objects in Ids indexed by it.
+ * Lives in game memory so the handles outlive a lost GL context, only the Ids
+ * are cleared then.
+ */
+struct render_residency
+{
+  uint32_t HandleCount;
+  // Registrations past RENDER_HANDLE_MAX_COUNT, they keep RENDER_NO_HANDLE
+  uint32_t DroppedCount;
+  uint32_t Ids[RENDER_HANDLE_MAX_COUNT];
+  render_resource Resources[RENDER_HANDLE_MAX_COUNT];
+  // Last handle the renderer's upload queue has checked
+  uint32_t UploadCursor;
+};
+
+static const char* const SHADER_CACHE_PATH = "/shader_cache.bin";
+static const uint32_t SHADER_CACHE_VERSION = 1;
+static const uint32_t SHADER_CACHE_MAX_PROGRAMS = 32;
+static const size_t SHADER_CACHE_MAX_BYTES = 2 * 1024 * 1024;
+
+struct shader_cache_entry
+{
+  // FNV-1a of the program's vertex and fragment source
+  uint32_t SourceHash;
+  uint32_t Format;
+  uint32_t Offset;
+  uint32_t Size;
+};
+
+/**
+ * Linked program binaries, only valid on the driver that produced them. The
+ * renderer adds programs it had to link from source and marks the cache
+ * dirty, the game writes it out. The file is the struct cut at DataSize.
+ */
+struct shader_cache
+{
+  uint32_t Version;
+  // FNV-1a of the GL vendor, renderer and version strings
+  uint32_t DriverHash;
+  uint32_t EntryCount;
+  uint32_t DataSize;
+  shader_cache_entry Entries[SHADER_CACHE_MAX_PROGRAMS];
+  bool Dirty;
+  uint8_t Data[SHADER_CACHE_MAX_BYTES];
+};
+
+/**
+ * What the renderer spends its time on, the quality controller moves between
+ * the tiers by frame time.
+ */
+enum render_quality
+{
+  RENDER_QUALITY_LOW,
+  RENDER_QUALITY_MEDIUM,
+  RENDER_QUALITY_HIGH,
+  RENDER_QUALITY_COUNT
+};
+
+struct render_quality_tier
+{
+  uint32_t ShadowCascadeCount;
+  uint32_t ShadowCascadeSize;
+  // Bilinear shadow map taps per axis
+  uint32_t ShadowFilterTaps;
+  // PBR shading and instanced crowds, the animated mesh shader otherwise
+  bool Pbr;
+  // Share of each crowd's instances that is drawn, the back rows go first
+  float CrowdDensity;
+  // Scene resolution as a fraction of the window, the UI stays native
+  float RenderScale;
+};
+
+static const render_quality_tier RENDER_QUALITY_TIERS[RENDER_QUALITY_COUNT] = {
+  { 1, 512, 1, false, 0.0f, 0.6f },
+  { 2, 512, 1, true, 0.5f, 0.75f },
+  { 3, 1024, 2, true, 1.0f, 1.0f }
+};
+
+// PBR program variant a primitive draws with
+static inline uint32_t get_pbr_variant(const Asset::model_primitive& primitive,
+                                       const bool skinned)
+{
+  const Asset::material* material = primitive.Material;
+  uint32_t variant = skinned ? Asset::PBR_VARIANT_SKINNED : 0;
+  // Without a material the entity's or the primitive's texture is the albedo
+  if (material == nullptr || material->AlbedoMap != nullptr) {
+    variant |= Asset::PBR_VARIANT_ALBEDO_MAP;
+  }
+  if (material != nullptr && material->MetallicMap != nullptr) {
+    variant |= Asset::PBR_VARIANT_METALLIC_MAP;
+  }
+  if (material != nullptr && material->RoughnessMap != nullptr) {
+    variant |= Asset::PBR_VARIANT_ROUGHNESS_MAP;
+  }
+
+  return variant;
+}
+
 enum render_data_flags
 {
   NO_FLAGS = 0x0,
   RENDER_TO_SHADOWMAP = 0x1,
-  RENDER_TO_STENCIL_BUFFER = 0x2
+  RENDER_TO_STENCIL_BUFFER = 0x2,
+  RENDER_TRANSLUCENT = 0x4,
+  // Outside the view frustum, only the shadow pass draws it
+  RENDER_OUTSIDE_VIEW = 0x8,
+  // Never moves, its shadow is kept in the renderer's static caster layer
+  RENDER_STATIC = 0x10
+};
+
+// Consecutive instances of an INSTANCED command that passed culling
+struct render_instance_range
+{
+  uint32_t First;
+  uint32_t Count;
 };
 
+// Per frame entity state copied into ENTITY and INSTANCED commands, followed
+// by BoneCount skinning matrices, NodeCount node world matrices and
+// InstanceRangeCount instance ranges
+struct render_entity_state
+{
+  v3 Position;
+  quat Rotation;
+  v3 Scale;
+  // World space bounding sphere, what the game culled with
+  v3 BoundsCenter;
+  float BoundsRadius;
+  float BakedTime;
+  uint32_t BoneCount;
+  uint32_t NodeCount;
+  uint32_t InstanceRangeCount;
+};
+
+/**
+ * Header of a command in the stream, Size covers the header and the payload
+ * that follows it. Camera, light, debug primitive and entity state, UI items
+ * and text travel in the payload, the pointers only reference assets,
+ * shaders, the map layout and the UI context.
+ */
 struct render_command
 {
   render_command_type Type;
 
   uint32_t Flags;
+  uint32_t Size;
+  // The next command in the stream, it may start in another block
+  render_command* Next;
   union
   {
     const ogl_shader_program* ShaderProgram;
     const game_entity* Entity;
     const instanced_entity* InstancedEntity;
-    const game_camera* Camera;
-    const game_light* Light;
-    const debug_render_line* Line;
-    const v3* CubePos;
     const body* Body;
     const map* Map;
-    const UISystem::ui_icon* Icon;
-    const UISystem::ui_text* Text;
-    const UISystem::ui_button* Button;
-    const UISystem::ui_toggle* Toggle;
-    const UISystem::ui_joystick* Joystick;
-    const UISystem::ui_slider* Slider;
+    // Shared by the frame's UI commands, which carry their item in the payload
     UISystem::ui_context* UIContext;
   };
 };
 
+static const size_t RENDER_COMMAND_ALIGNMENT = 16;
+// A frame of the hockey map records up to about 70 commands in 20 KB, the
+// largest a skinned entity of 7 KB
+static const size_t RENDER_COMMAND_BLOCK_SIZE = 32 * 1024;
+// The renderer sorts commands by their index in 17 bits
+static const uint32_t RENDER_COMMAND_MAX_COUNT = 1 << 17;
+
+// Transient memory the stream is recorded into, Data follows the block
+struct render_command_block
+{
+  render_command_block* Next;
+  uint8_t* Data;
+  size_t Size;
+  size_t Capacity;
+};
+
+/**
+ * The blocks stay chained to the buffer and are rewound every frame. A frame
+ * that outgrows them chains another block, so the chain only grows to the
+ * busiest frame so far and nothing is copied.
+ */
 struct render_command_buffer
 {
-  render_command Commands[100];
+  render_command_block* FirstBlock;
+  render_command_block* CurrentBlock;
+  render_command* FirstCommand;
+  render_command* LastCommand;
   uint32_t Count;
+  uint32_t DroppedCount;
 };
 
+static inline void* get_render_command_data(const render_command* command)
+{
+  return (uint8_t*)command + sizeof(render_command);
+}
+
+static inline render_instance_range* get_instance_ranges(
+  const render_entity_state* state)
+{
+  return (render_instance_range*)((mat4x4*)(state + 1) + state->BoneCount +
+                                  state->NodeCount);
+}
+
+// Pass nullptr to get the first command, returns nullptr at the end
+static inline const render_command* get_next_render_command(
+  const render_command_buffer& buffer,
+  const render_command* command)
+{
+  return command != nullptr ? command->Next : buffer.FirstCommand;
+}
+
 #endif
@@ -120,6 +120,7 @@ static void initialize_state(game_memory& memory,
   state.TSine = 0;
 
   state.TimeScale = 1.0f;
+  init_quality_controller(state.QualityController, RENDER_QUALITY_HIGH);
 
   memory.Initialized = true;
 
@@ -149,6 +150,34 @@ static void initialize_state(game_memory& memory,
     "CrowdEnd", &assets->CrowdModel, state.Map.InstancedEntities.CrowdEnd);
   create_entity("Arrow", &assets->ArrowModel, state.Map.Entities.Arrow);
 
+  // Only the offense and the goalie are animated on the CPU, the crowd only
+  // borrows a run to bake its clip
+  size_t maxChannelCount =
+    AnimationSystem::get_max_channel_count(assets->OffenseModel);
+  const size_t goalieChannelCount =
+    AnimationSystem::get_max_channel_count(assets->GoalieModel);
+  if (goalieChannelCount > maxChannelCount) {
+    maxChannelCount = goalieChannelCount;
+  }
+  const size_t crowdChannelCount =
+    AnimationSystem::get_max_channel_count(assets->CrowdModel);
+  if (crowdChannelCount > maxChannelCount) {
+    maxChannelCount = crowdChannelCount;
+  }
+  AnimationSystem::init_animator(state.Animator, maxChannelCount);
+
+  // Crowd plays a single looping clip, so sample it once here and let the
+  // instances pick their frame on the GPU
+  state.CheerPose =
+    AnimationSystem::bake_animation("cheer",
+                                    state.Map.InstancedEntities.CrowdLSide,
+                                    state.Animator,
+                                    AnimationSystem::ANIMATION_BAKE_FRAME_RATE);
+  register_render_handle(*state.Residency,
+                         state.CheerPose.RenderHandle,
+                         RENDER_RESOURCE_BAKED_POSE,
+                         &state.CheerPose);
+
   state.UIContext = UISystem::create_context(100, state.Assets);
 
   state.PhysicsSpace = PhysicsSystem::create_space();
@@ -201,16 +230,31 @@ static void phase_switched(game_state& state,
   }
 }
 
+static const game_camera& get_view_camera(const game_state& state)
+{
+#if HOKI_DEV
+  if (state.DebugCameraActive) {
+    return state.DebugCamera;
+  }
+#endif
+  if (state.Phase == game_phase::REPLAYING) {
+    return state.Map.ReplayCamera;
+  }
+
+  return state.Map.GameCamera;
+}
+
 static void tick_state(game_state& state,
                        game_memory& gameMemory,
                        render_context& renderContext)
 {
 #if HOKI_DEV
   if (state.Picked != nullptr) {
-    render_command& outlineRenderCommand =
-      renderContext.Commands.Commands[renderContext.Commands.Count++];
-    outlineRenderCommand.Type = RENDER_COMMAND_TYPE_OUTLINE;
-    outlineRenderCommand.Entity = state.Picked;
+    render_command* outlineRenderCommand =
+      create_render_command(renderContext, RENDER_COMMAND_TYPE_OUTLINE);
+    if (outlineRenderCommand != nullptr) {
+      outlineRenderCommand->Entity = state.Picked;
+    }
   }
 #endif
 
@@ -296,11 +340,4 @@ static void tick_state(game_state& state,
     iList.CrowdEnd.Position.Z = -36.0f;
     iList.CrowdEnd.Rotation = iList.SeatEnd.Rotation;
   }
-
-  push_render_instanced(renderContext, &iList.SeatEnd);
-  push_render_instanced(renderContext, &iList.SeatLSide);
-  push_render_instanced(renderContext, &iList.SeatRSide);
-  push_render_instanced(renderContext, &iList.CrowdEnd);
-  push_render_instanced(renderContext, &iList.CrowdLSide);
-  push_render_instanced(renderContext, &iList.CrowdRSide);
 }
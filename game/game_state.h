@@ -8,6 +8,10 @@
 #include "ui_system.h"
 #include "physics_system.h"
 #include "ai_system.h"
+#include "game_quality.h"
+
+struct render_residency;
+struct shader_cache;
 
 using AnimationSystem::animation_run;
 using AnimationSystem::animator;
@@ -70,7 +74,9 @@ enum game_state_command_type
 #if HOKI_DEV
   DEBUG_COMMAND_TOGGLE_DEBUG_CAMERA,
   DEBUG_COMMAND_TOGGLE_MOUSEPICKER,
-  DEBUG_COMMAND_TOGGLE_DEBUG_UI
+  DEBUG_COMMAND_TOGGLE_DEBUG_UI,
+  DEBUG_COMMAND_RUN_ANIMATION_BENCHMARK,
+  DEBUG_COMMAND_RUN_ASSET_BENCHMARK
 #endif
 };
 
@@ -116,6 +122,8 @@ struct game_state_command_buffer
 struct game_state
 {
   Asset::game_assets* Assets;
+  render_residency* Residency;
+  shader_cache* ShaderCache;
 
   int ToneVolume;
   int Hz;
@@ -162,7 +170,8 @@ struct game_state
   animation_run* Skate;
   animation_run* SkateHard;
   animation_run* ChargeUp;
-  animation_run* Cheer;
+  AnimationSystem::baked_animation CheerPose;
+  AnimationSystem::baked_animation_run Cheer;
 
   AISystem::ai_goalie AIGoalie;
 
@@ -178,14 +187,21 @@ struct game_state
   int Goals;
   bool Won;
 
-  float perfTestFpsLowQuality[5 * 60];
-  int perfTestIndex;
+  // Frame time summed over each tier's phase of the perf test
+  float perfTestFrameTime[RENDER_QUALITY_COUNT];
+  int perfTestFrameCount[RENDER_QUALITY_COUNT];
   int perfTestPhase;
-  float perfTestFpsHighQuality[5 * 60];
+
+  quality_controller QualityController;
 
   bool SoundEnabled;
 #if HOKI_DEV
   bool ShowDebugUI;
+  bool RunAnimationBenchmark;
+  // Allocated by the first benchmark run and reused by the next ones
+  AnimationSystem::animator* BenchmarkAnimator;
+  game_entity* BenchmarkEntities;
+  bool RunAssetBenchmark;
   bool MousePickerActive;
   game_entity* Picked;
   debug_render_line DebugAimLine;
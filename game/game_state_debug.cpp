@@ -14,8 +14,7 @@ STATE_ACTION(debug_move_camera)
 STATE_ACTION(set_wireframe)
 {
 #if 0
-    render_command &wireframeRenderCommand = renderContext.Commands.Commands[renderContext.Commands.Count++];
-    wireframeRenderCommand.Type = DEBUG_RENDER_COMMAND_TYPE_SET_WIREFRAME;
+    create_render_command(renderContext, DEBUG_RENDER_COMMAND_TYPE_SET_WIREFRAME);
 #endif
 }
 
@@ -47,3 +46,19 @@ STATE_ACTION(debug_toggle_debug_ui)
   state.ShowDebugUI = !state.ShowDebugUI;
 #endif
 }
+
+STATE_ACTION(debug_run_animation_benchmark)
+{
+#if HOKI_DEV
+  // Runs from GameMain once the frame's commands are handled
+  state.RunAnimationBenchmark = true;
+#endif
+}
+
+STATE_ACTION(debug_run_asset_benchmark)
+{
+#if HOKI_DEV
+  // Logs from GameMain with the other benchmark
+  state.RunAssetBenchmark = true;
+#endif
+}
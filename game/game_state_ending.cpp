@@ -112,7 +112,7 @@ static void tick_ending_phase(game_state& state,
   if (shouldEnd) {
     state.GamesPlayed++;
     state.Goals += goalMade ? 1 : 0;
-    state.Cheer->Speed = goalMade ? 5.0f : 1.0f;
+    state.Cheer.Speed = goalMade ? 5.0f : 1.0f;
     state.PhaseDelay = goalMade ? 0.0f : 0.5f;
     state.NextPhase = game_phase::ENDED;
     state.GoalTime =
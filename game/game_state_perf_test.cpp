@@ -2,9 +2,39 @@
 
 using namespace UISystem;
 
+// Seconds of warmup, then each tier is measured in turn from the lowest
+static const float PERF_TEST_WARMUP_TIME = 1.0f;
+static const float PERF_TEST_TIER_TIME = 5.0f;
+static const int PERF_TEST_PHASE_DONE = RENDER_QUALITY_COUNT + 1;
+
+static float get_perf_test_frame_time(const game_state& state,
+                                      const render_quality tier)
+{
+  const int frames = state.perfTestFrameCount[tier];
+  return frames > 0 ? state.perfTestFrameTime[tier] / (float)frames : 0.0f;
+}
+
+// Highest tier that held the target frame time, the lowest if none did
+static render_quality choose_perf_test_tier(const game_state& state)
+{
+  render_quality chosen = RENDER_QUALITY_LOW;
+  for (int i = RENDER_QUALITY_LOW; i < RENDER_QUALITY_COUNT; i++) {
+    const float frameTime = get_perf_test_frame_time(state, (render_quality)i);
+    if (frameTime > 0.0f && frameTime <= QUALITY_TARGET_FRAME_TIME) {
+      chosen = (render_quality)i;
+    }
+  }
+
+  return chosen;
+}
+
 static void setup_perftest_phase(game_state& state)
 {
   state.perfTestPhase = 0;
+  for (int i = 0; i < RENDER_QUALITY_COUNT; i++) {
+    state.perfTestFrameTime[i] = 0.0f;
+    state.perfTestFrameCount[i] = 0;
+  }
   game_phase phase = game_phase::PERF_TEST;
   hook_action(
     state.ReplayHooks, phase, COMMAND_OFFENSE_SHOOT, offense_replayed_shoot);
@@ -37,35 +67,30 @@ void do_perftest_ui(game_state& state,
 {
   do_sprite(context, &state.Assets->LogoTexture, _v2(0.01f), _v2(0.45f));
 
-  if (state.perfTestPhase < 3) {
+  if (state.perfTestPhase < PERF_TEST_PHASE_DONE) {
     do_text(_v2(0.25f, 0.25f),
             22.0f,
             context,
             state.Assets->TestFont,
             "Testataan suorituskykyä...");
   } else {
-    float lowQualityFps = 0.0f;
-    float highQualityFps = 0.0f;
-    const float dividend = 1.0f / ARRAY_SIZE(state.perfTestFpsLowQuality);
-    for (int i = 0; i < ARRAY_SIZE(state.perfTestFpsLowQuality); i++) {
-      lowQualityFps += state.perfTestFpsLowQuality[i] * dividend;
-      highQualityFps += state.perfTestFpsHighQuality[i] * dividend;
+    float fps[RENDER_QUALITY_COUNT];
+    for (int i = 0; i < RENDER_QUALITY_COUNT; i++) {
+      const float frameTime =
+        get_perf_test_frame_time(state, (render_quality)i);
+      fps[i] = frameTime > 0.0f ? 1.0f / frameTime : 0.0f;
     }
 
     do_text(_v2(0.45f, 0.27f),
             22.0f,
             context,
             state.Assets->TestFont,
-            "Low quality FPS %.2f\nHigh quality FPS %.2f",
-            lowQualityFps,
-            highQualityFps);
-
-    do_text(_v2(0.25f, 0.40f),
-            26.0f,
-            context,
-            state.Assets->TestFont,
-            "Voitko ottaa ruutukaappauksen tästä ja\nlähettää sen Markukselle\n"
-            "Kiitos!");
+            "Low quality FPS %.2f\nMedium quality FPS %.2f\n"
+            "High quality FPS %.2f\nChosen tier %d",
+            fps[RENDER_QUALITY_LOW],
+            fps[RENDER_QUALITY_MEDIUM],
+            fps[RENDER_QUALITY_HIGH],
+            (int)state.QualityController.Tier);
   }
 
   do_sprite(
@@ -76,28 +101,30 @@ static void tick_perf_test_phase(game_state& state,
                                  game_memory& gameMemory,
                                  render_context& renderContext)
 {
-
-  if (state.RealTime < 1.0f) {
+  // Phase 0 warms up, phase 1 + tier measures the tier
+  const int lastPhase = state.perfTestPhase;
+  if (state.RealTime < PERF_TEST_WARMUP_TIME) {
     state.perfTestPhase = 0;
-  } else if (state.RealTime < 6.0f) {
-    state.perfTestPhase = 1;
-  } else if (state.RealTime < 11.0f) {
-    state.perfTestPhase = 2;
   } else {
-    state.perfTestPhase = 3;
-  }
-
-  if (state.perfTestPhase == 2) {
-    renderContext.HighQuality = true;
+    const int tierPhase =
+      (int)((state.RealTime - PERF_TEST_WARMUP_TIME) / PERF_TEST_TIER_TIME);
+    state.perfTestPhase = std::min(tierPhase + 1, PERF_TEST_PHASE_DONE);
   }
 
-  float fps = 1.0f / state.FrameDelta;
-  if (state.perfTestPhase == 1) {
-    int i = state.perfTestIndex++ % ARRAY_SIZE(state.perfTestFpsLowQuality);
-    state.perfTestFpsLowQuality[i] = fps;
-  } else if (state.perfTestPhase == 2) {
-    int i = state.perfTestIndex++ % ARRAY_SIZE(state.perfTestFpsLowQuality);
-    state.perfTestFpsHighQuality[i] = fps;
+  if (state.perfTestPhase > 0 && state.perfTestPhase < PERF_TEST_PHASE_DONE) {
+    const render_quality tier = (render_quality)(state.perfTestPhase - 1);
+    // The frame that switched tiers was rendered with the previous one
+    if (renderContext.Quality == tier) {
+      state.perfTestFrameTime[tier] += state.FrameDelta;
+      state.perfTestFrameCount[tier]++;
+    }
+    renderContext.Quality = tier;
+  } else if (state.perfTestPhase == PERF_TEST_PHASE_DONE &&
+             lastPhase != PERF_TEST_PHASE_DONE) {
+    // Seeds the tier the game starts from, the controller adjusts from there
+    init_quality_controller(state.QualityController,
+                            choose_perf_test_tier(state));
+    renderContext.Quality = state.QualityController.Tier;
   }
   camera_spin_around(state.Map.GameCamera, state.RealTime);
 
@@ -91,6 +91,9 @@ STATE_ACTION(offense_setup_begin_skating_animation_replayd)
   animation* animations = offense.Model->Animations;
   AnimationSystem::run_id idleToSkateId = setup_animation(
     "Idle to Skate", animations, animationCount, state.Animator);
+  if (idleToSkateId == AnimationSystem::ANIMATION_NO_ID) {
+    return;
+  }
   animation_run* idleToSkate = get_run(idleToSkateId, state.Animator);
   idleToSkate->LoopStyle = AnimationSystem::animation_loop_style::NO_LOOP;
 
@@ -31,18 +31,12 @@ STATE_ACTION(restart_map)
                     state.Animator);
   set_animation_for_entity(offense, idleId, state.Animator);
 
-  game_entity& crowdEnd = state.Map.InstancedEntities.CrowdEnd;
-  game_entity& crowLSide = state.Map.InstancedEntities.CrowdLSide;
-  game_entity& crowRSide = state.Map.InstancedEntities.CrowdRSide;
-  AnimationSystem::run_id cheerId =
-    setup_animation("cheer",
-                    crowdEnd.Model->Animations,
-                    crowdEnd.Model->AnimationCount,
-                    state.Animator);
-  AnimationSystem::set_animation_for_entity(crowdEnd, cheerId, state.Animator);
-  AnimationSystem::set_animation_for_entity(crowLSide, cheerId, state.Animator);
-  AnimationSystem::set_animation_for_entity(crowRSide, cheerId, state.Animator);
-  state.Cheer = AnimationSystem::get_run(cheerId, state.Animator);
+  state.Cheer = {};
+  state.Cheer.Baked = &state.CheerPose;
+  state.Cheer.Speed = AnimationSystem::ANIMATION_DEFAULT_SPEED;
+  state.Map.InstancedEntities.CrowdEnd.BakedRun = &state.Cheer;
+  state.Map.InstancedEntities.CrowdLSide.BakedRun = &state.Cheer;
+  state.Map.InstancedEntities.CrowdRSide.BakedRun = &state.Cheer;
 
   // Reset aimpositionbuffer to something reasonable
   for (size_t i = 0; i < ARRAY_SIZE(state.AimPositionBuffer); i++) {
@@ -117,6 +111,14 @@ STATE_ACTION(reset_game)
               game_phase::NONE,
               DEBUG_COMMAND_TOGGLE_DEBUG_UI,
               debug_toggle_debug_ui);
+  hook_action(state.DebugHooks,
+              game_phase::NONE,
+              DEBUG_COMMAND_RUN_ANIMATION_BENCHMARK,
+              debug_run_animation_benchmark);
+  hook_action(state.DebugHooks,
+              game_phase::NONE,
+              DEBUG_COMMAND_RUN_ASSET_BENCHMARK,
+              debug_run_asset_benchmark);
 
   state.ShowDebugUI = true;
 #endif
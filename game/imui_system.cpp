@@ -423,6 +423,7 @@ bool do_draggable(ui_context* context,
 void do_debug_ui(game_state& state, ui_context* context)
 {
   v2 mPos = state.AimPosition;
+  const float* gpuMs = context->RenderContext->GpuTimers.PassMilliseconds;
   do_text(
     _v2(0.0f, -context->TopMargin),
     22.0f,
@@ -433,6 +434,8 @@ void do_debug_ui(game_state& state, ui_context* context)
     "goalie state:%s\t nextstate:%s\t slide: %f\n"
     "aimpower: %f \n"
     "game phase:%s\n"
+    "quality tier:%d (auto %i)\n"
+    "gpu ms shadow:%.2f inst:%.2f entity:%.2f transl:%.2f ui:%.2f\n"
 #if HOKI_DEV
     "debug camera(%i) pos:%f %f %f\n"
 #endif
@@ -450,6 +453,13 @@ void do_debug_ui(game_state& state, ui_context* context)
     state.AIGoalie.MovementAmount,
     get_aim_power(state),
     debug_to_string(state.Phase),
+    (int)state.QualityController.Tier,
+    state.QualityController.Automatic,
+    gpuMs[RENDER_PASS_SHADOW],
+    gpuMs[RENDER_PASS_INSTANCED],
+    gpuMs[RENDER_PASS_ENTITY],
+    gpuMs[RENDER_PASS_TRANSLUCENT],
+    gpuMs[RENDER_PASS_UI] + gpuMs[RENDER_PASS_TEXT],
 #if HOKI_DEV
     state.DebugCameraActive,
     state.DebugCamera.Position.X,
@@ -486,7 +496,7 @@ void do_debug_ui(game_state& state, ui_context* context)
   if (do_toggle(context,
                 _v2(0.85f, 0.45f),
                 _v2(0.1f),
-                context->RenderContext->HighQuality)) {
+                state.QualityController.Automatic)) {
   }
 }
 
@@ -59,6 +59,7 @@ void load_map(game_state& state, map* outMap)
   posts->Position = _v3(0.0f, 0.0f, -17.5f);
   posts->Rotation = quat_from_euler(_v3(0.0f, 0.0f, 00.0f));
   posts->Scale = _v3(1.2f);
+  posts->Static = true;
   v3 netSize = _v3(5.2f, 3.0f, 0.25f);
   v3 netOffset = _v3(0.0f, netSize.Y * 0.5f, -2.0f);
   body& net = add_body_to_space(state.PhysicsSpace,
@@ -193,18 +194,21 @@ void load_map(game_state& state, map* outMap)
   crowdEnd->Rotation = quat_from_euler(_v3(0.0f, 180.0f, 0.0f));
   crowdEnd->InstanceSpacing = _v3(3.0f * 4.0f, -2.0f, 2.0f);
   crowdEnd->InstanceCount = 8;
+  crowdEnd->Crowd = true;
   instanced_entity* crowdLSide = &outMap->InstancedEntities.CrowdLSide;
   crowdLSide->Position = _v3(-29.0f, 10.0f, 48.0f);
   crowdLSide->Scale = _v3(1.0f);
   crowdLSide->Rotation = quat_from_euler(_v3(0.0f, 90.0f, 0.0f));
   crowdLSide->InstanceSpacing = _v3(3.0f * 4.0f, -2.0f, 2.0f);
   crowdLSide->InstanceCount = 30;
+  crowdLSide->Crowd = true;
   instanced_entity* crowdRSide = &outMap->InstancedEntities.CrowdRSide;
   crowdRSide->Position = _v3(29.0f, 10.0f, -33.0f);
   crowdRSide->Scale = _v3(1.0f);
   crowdRSide->Rotation = quat_from_euler(_v3(0.0f, 270.0f, 0.0f));
   crowdRSide->InstanceSpacing = _v3(3.0f * 4.0f, -2.0f, 2.0f);
   crowdRSide->InstanceCount = 30;
+  crowdRSide->Crowd = true;
 
   /**
    * LIGHTS
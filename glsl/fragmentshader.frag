@@ -9,28 +9,17 @@ GLSL_PREPROCESS(version 330 core)
 const float kPi = 3.14159265;
 const float kShininess = 16.0;
 
-#include "light_inc.glsl"
+#include "frame_block.glsl"
+#include "material.glsl"
 
-GLSL_PREPROCESS(define NR_POINT_LIGHTS 4)
-uniform PointLight uPointLights[NR_POINT_LIGHTS];
 const float totalLightCount = 5.0;
 
-struct Material
-{
-  float Shine;
-  bool UseAlbedoMap;
-  vec3 Albedo;
-  sampler2D AlbedoMap;
-};
-
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
-in vec4 FragPosLightSpace;
+in vec4 ShadowPos;
+in float ViewDepth;
 
-uniform vec3 uCameraPos;
-uniform DirLight uDirLight;
-uniform Material uMaterial;
 uniform sampler2D uShadowMap;
 
 out vec4 FragColor;
@@ -109,7 +98,7 @@ vec3 calculatePointLight(PointLight light,
 void main()
 {
   vec4 albedoA = uMaterial.UseAlbedoMap
-                   ? texture(uMaterial.AlbedoMap, TexCoords)
+                   ? texture(uAlbedoMap, TexCoords)
                    : vec4(uMaterial.Albedo, 1.0);
   vec3 albedo = pow(albedoA.rgb, vec3(2.2));
 
@@ -127,7 +116,7 @@ void main()
   lightContribution = lightContribution / totalLightCount;
 
   float shadowAmount =
-    shadowCalculation(FragPosLightSpace, N, uDirLight.Direction);
+    shadowCalculation(ShadowPos, ViewDepth, N, uDirLight.Direction);
   vec4 result = vec4(albedo * lightContribution, 1.0);
   // HDR tonemapping
   result = result / (result + vec4(1.0));
@@ -0,0 +1,17 @@
+#include "light_inc.glsl"
+
+#define NR_POINT_LIGHTS 4
+#define MAX_SHADOW_CASCADES 3
+
+// Shared by every program, uploaded once per frame
+layout(std140) uniform FrameBlock
+{
+  mat4 uViewProjection;
+  mat4 uLightSpaceMatrices[MAX_SHADOW_CASCADES];
+  // View depth where each cascade ends, w is the cascade count
+  vec4 uCascadeSplits;
+  vec3 uCameraPos;
+  float uShadowFilterTaps;
+  DirLight uDirLight;
+  PointLight uPointLights[NR_POINT_LIGHTS];
+};
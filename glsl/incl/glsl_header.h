@@ -1,3 +1,8 @@
 #define hash #
 #define f(x) x
+#ifdef __GNUC__
+// cpp rejects the paste below, it puts the tokens next to each other anyway
+#define GLSL_PREPROCESS(a) f(hash)a
+#else
 #define GLSL_PREPROCESS(a) f(hash)##a
+#endif
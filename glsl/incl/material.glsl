@@ -1,19 +1,16 @@
-
-struct Material
+// Each material has its own range of the buffer
+layout(std140) uniform MaterialBlock
 {
+  vec3 Albedo;
   float Shine;
-
+  float Metallic;
+  float Roughness;
   float AmbientOcclusion;
-
   bool UseAlbedoMap;
-  vec3 Albedo;
-  sampler2D AlbedoMap;
-
   bool UseMetallicMap;
-  float Metallic;
-  sampler2D MetallicMap;
-
   bool UseRoughnessMap;
-  float Roughness;
-  sampler2D RoughnessMap;
-};
\ No newline at end of file
+} uMaterial;
+
+uniform sampler2D uAlbedoMap;
+uniform sampler2D uMetallicMap;
+uniform sampler2D uRoughnessMap;
@@ -22,8 +22,22 @@ float sampleShadowLinear(vec2 coordinates, vec2 texelSize, float depth)
   return mix(mixLeft, mixRight, pixelFract.x);
 }
 
-float shadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
+// Cascades are tiles of uShadowMap, two per row
+float shadowCalculation(vec4 shadowPos,
+                        float viewDepth,
+                        vec3 normal,
+                        vec3 lightDir)
 {
+  int cascadeCount = int(uCascadeSplits.w);
+  int cascade = 0;
+  while (cascade < cascadeCount && viewDepth > uCascadeSplits[cascade]) {
+    cascade++;
+  }
+  if (cascade == cascadeCount) {
+    return 0.0;
+  }
+
+  vec4 fragPosLightSpace = uLightSpaceMatrices[cascade] * shadowPos;
   vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
   projCoords = projCoords * 0.5 + 0.5;
 
@@ -33,36 +47,29 @@ float shadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
   }
 
   float normalToLightDot = 1.0 - dot(normal, lightDir);
-  const float shadowBiasConstant = 0.001;
   float bias = max(0.01 * normalToLightDot, 0.005);
-
-  float closestDepth = texture(uShadowMap, projCoords.xy).r;
   float currentDepth = projCoords.z - bias;
 
-  vec2 poissonDisk[4] = vec2[](vec2(-0.94201624, -0.39906216),
-                               vec2(0.94558609, -0.76890725),
-                               vec2(-0.094184101, -0.92938870),
-                               vec2(0.34495938, 0.29387760));
+  vec2 tiles = vec2(float(min(cascadeCount, 2)), float((cascadeCount + 1) / 2));
+  vec2 tile = vec2(float(cascade % 2), float(cascade / 2));
+  vec2 texelSize = 1.0 / vec2(textureSize(uShadowMap, 0));
+  // Keeps the filter taps inside the tile
+  vec2 tileTexelSize = texelSize * tiles;
+  vec2 coordinates =
+    (clamp(projCoords.xy, 2.0 * tileTexelSize, 1.0 - 2.0 * tileTexelSize) +
+     tile) /
+    tiles;
 
-  float samples = 3.0;
-  float samplesStart = (samples - 1.0) / 2.0;
+  // Taps are a texel apart around the center
+  float tapStart = (1.0 - uShadowFilterTaps) * 0.5;
   float shadow = 0.0;
-  vec2 texelSize = 1.0 / vec2(textureSize(uShadowMap, 0));
-  for (float y = -samplesStart; y < samplesStart; y++) {
-    for (float x = -samplesStart; x < samplesStart; x++) {
-      // float pcfDepth = texture(uShadowMap, projCoords.xy + vec2(x,y) *
-      // texelSize).r; shadow += currentDepth > pcfDepth ? 1.0 : 0.0; shadow +=
-      // testShadowMap(projCoords.xy + vec2(x,y) * texelSize, currentDepth) *
-      // normalToLightDot; shadow += sampleShadowLinear(projCoords.xy +
-      // vec2(x,y), texelSize, currentDepth);
-      shadow += sampleShadowLinear(projCoords.xy +
-                                     (vec2(x, y) + poissonDisk[int(y)] / 700.0),
-                                   texelSize,
-                                   currentDepth);
+  for (float y = tapStart; y < -tapStart + 0.5; y++) {
+    for (float x = tapStart; x < -tapStart + 0.5; x++) {
+      shadow += sampleShadowLinear(
+        coordinates + vec2(x, y) * texelSize, texelSize, currentDepth);
     }
   }
-
-  shadow /= (samples * samples);
+  shadow /= uShadowFilterTaps * uShadowFilterTaps;
 
   return clamp(shadow * abs(dot(normal, lightDir)), 0.0, 1.0);
 }
@@ -9,21 +9,24 @@ GLSL_PREPROCESS(version 330 core)
 const float kPi = 3.14159265359;
 const float kShininess = 16.0;
 
-#include "light_inc.glsl"
-
-#define NR_POINT_LIGHTS 4
-uniform PointLight uPointLights[NR_POINT_LIGHTS];
+// Material maps the variant samples, the generated pbr_maps<N>.frag set it.
+// Bits follow PBR_VARIANT_*_MAP in asset_shader.h, shifted past skinning
+#ifndef PBR_MAPS
+#define PBR_MAPS 0
+#endif
+#define USE_ALBEDO_MAP ((PBR_MAPS & 1) != 0)
+#define USE_METALLIC_MAP ((PBR_MAPS & 2) != 0)
+#define USE_ROUGHNESS_MAP ((PBR_MAPS & 4) != 0)
 
+#include "frame_block.glsl"
 #include "material.glsl"
 
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
-in vec4 FragPosLightSpace;
+in vec4 ShadowPos;
+in float ViewDepth;
 
-uniform vec3 uCameraPos;
-uniform DirLight uDirLight;
-uniform Material uMaterial;
 uniform sampler2D uTexture_normal1;
 uniform sampler2D uShadowMap;
 
@@ -81,17 +84,23 @@ void main()
                    // TexCoords).xyz : Normal;
   vec3 V = normalize(-FragPos);
 
-  vec4 albedoA = uMaterial.UseAlbedoMap
-                   ? texture(uMaterial.AlbedoMap, TexCoords)
-                   : vec4(uMaterial.Albedo, 1.0);
+#if USE_ALBEDO_MAP
+  vec4 albedoA = texture(uAlbedoMap, TexCoords);
+#else
+  vec4 albedoA = vec4(uMaterial.Albedo, 1.0);
+#endif
 
   vec3 albedo = pow(albedoA.rgb, vec3(2.2));
-  float metallic = uMaterial.UseMetallicMap
-                     ? texture(uMaterial.MetallicMap, TexCoords).r
-                     : uMaterial.Metallic;
-  float roughness = uMaterial.UseRoughnessMap
-                      ? texture(uMaterial.RoughnessMap, TexCoords).g
-                      : uMaterial.Roughness;
+#if USE_METALLIC_MAP
+  float metallic = texture(uMetallicMap, TexCoords).r;
+#else
+  float metallic = uMaterial.Metallic;
+#endif
+#if USE_ROUGHNESS_MAP
+  float roughness = texture(uRoughnessMap, TexCoords).g;
+#else
+  float roughness = uMaterial.Roughness;
+#endif
 
   // calculate reflectance at normal incidence; if dia-electric (like plastic)
   // use F0 of 0.04 and if it's a metal, use the albedo color as F0 (metallic
@@ -156,7 +165,7 @@ void main()
   color = color / (color + vec3(1.0));
   // gamma correct
   float shadowAmount =
-    shadowCalculation(FragPosLightSpace, N, uDirLight.Direction);
+    shadowCalculation(ShadowPos, ViewDepth, N, uDirLight.Direction);
 
   color = pow(color, vec3(1.0 / 2.2)) - shadowAmount;
 
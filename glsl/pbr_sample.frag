@@ -15,7 +15,6 @@ in vec3 Normal;
 #include "material.glsl"
 
 uniform vec3 uCameraPos;
-uniform Material uMaterial;
 uniform sampler2D uTexture_normal1;
 uniform sampler2D uShadowMap;
 
@@ -88,15 +87,15 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 void main()
 {
   vec4 albedoA = uMaterial.UseAlbedoMap
-                   ? texture(uMaterial.AlbedoMap, TexCoords)
+                   ? texture(uAlbedoMap, TexCoords)
                    : vec4(uMaterial.Albedo, 1.0);
 
   vec3 albedo = pow(albedoA.rgb, vec3(2.2));
   float metallic = uMaterial.UseMetallicMap
-                     ? texture(uMaterial.MetallicMap, TexCoords).r
+                     ? texture(uMetallicMap, TexCoords).r
                      : uMaterial.Metallic;
   float roughness = uMaterial.UseRoughnessMap
-                      ? texture(uMaterial.RoughnessMap, TexCoords).g
+                      ? texture(uRoughnessMap, TexCoords).g
                       : uMaterial.Roughness;
 
   vec3 N = Normal;
@@ -23,7 +23,6 @@ in vec4 FragPosLightSpace;
 
 uniform vec3 uCameraPos;
 uniform DirLight uDirLight;
-uniform Material uMaterial;
 uniform sampler2D uTexture_normal1;
 uniform sampler2D uShadowMap;
 
@@ -82,15 +81,15 @@ void main()
   vec3 V = normalize(-FragPos);
 
   vec4 albedoA = uMaterial.UseAlbedoMap
-                   ? texture(uMaterial.AlbedoMap, TexCoords)
+                   ? texture(uAlbedoMap, TexCoords)
                    : vec4(uMaterial.Albedo, 1.0);
 
   vec3 albedo = pow(albedoA.rgb, vec3(2.2));
   float metallic = uMaterial.UseMetallicMap
-                     ? texture(uMaterial.MetallicMap, TexCoords).r
+                     ? texture(uMetallicMap, TexCoords).r
                      : uMaterial.Metallic;
   float roughness = uMaterial.UseRoughnessMap
-                      ? texture(uMaterial.RoughnessMap, TexCoords).g
+                      ? texture(uRoughnessMap, TexCoords).g
                       : uMaterial.Roughness;
 
   // calculate reflectance at normal incidence; if dia-electric (like plastic)
@@ -19,40 +19,59 @@ layout(location = 5) in vec4 aBoneWeights;
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
-out vec4 FragPosLightSpace;
+// Normal offset world position and view depth, pick and sample the cascade
+out vec4 ShadowPos;
+out float ViewDepth;
 
+// Variants set SHADER_SKINNED when they are built, others branch on it
+#ifndef SHADER_SKINNED
 uniform bool uHasBones;
-uniform mat4 uModelMatrix;
-uniform mat4 uViewProjection;
-#ifdef GLES
-/**
- * uBones will break with mat4 arrays, so we use vec4 instead
- * https://stackoverflow.com/questions/20388086/opengl-es-3-0-matrix-array-only-using-first-matrix
- */
-uniform vec4 uBones[MAX_BONES * 4];
-#else
-uniform mat4 uBones[MAX_BONES];
 #endif
-uniform mat4 uLightSpaceMatrix;
+uniform mat4 uModelMatrix;
+
+// Palette of the entity being drawn, a range of the frame's bone buffer
+layout(std140) uniform BoneBlock
+{
+  mat4 uBones[MAX_BONES];
+};
 #ifdef SHADER_INSTANCED
 uniform int uInstanceCount;
 uniform vec3 uInstanceSpacing;
+// First instance of the range being drawn, the rest were culled
+uniform int uInstanceOffset;
+
+// Baked pose palette, one row per frame and four texels per bone
+uniform bool uHasBakedPose;
+uniform highp sampler2D uBakedPose;
+uniform int uBakedFrameCount;
+uniform float uBakedFrame;
 #endif
 
-#include "light_inc.glsl"
-uniform DirLight uDirLight;
+#include "frame_block.glsl"
+
+#ifdef SHADER_INSTANCED
+mat4 bakedBoneTransform(int frame, int boneId)
+{
+  int column = boneId * 4;
+  return mat4(texelFetch(uBakedPose, ivec2(column + 0, frame), 0),
+              texelFetch(uBakedPose, ivec2(column + 1, frame), 0),
+              texelFetch(uBakedPose, ivec2(column + 2, frame), 0),
+              texelFetch(uBakedPose, ivec2(column + 3, frame), 0));
+}
+#endif
 
 void main()
 {
 #ifdef SHADER_INSTANCED
-  float instancePlusOne = float(gl_InstanceID + 1);
+  int instanceId = gl_InstanceID + uInstanceOffset;
+  float instancePlusOne = float(instanceId + 1);
   float zScale = uInstanceSpacing.z;
   float xyScale = uInstanceSpacing.x;
   int cols = (uInstanceCount / 4) + 1;
   float offset = ceil(instancePlusOne / float(cols));
   float Z = offset * zScale;
   float XOFF = int(offset) % 2 == 0 ? 0.0 : (xyScale * 0.5);
-  float X = (float(gl_InstanceID % cols) * xyScale) + XOFF;
+  float X = (float(instanceId % cols) * xyScale) + XOFF;
   float Y = offset * uInstanceSpacing.y;
 
   vec4 totalLocalPos = vec4(aPos + vec3(X, Y, Z), 1.0);
@@ -62,27 +81,38 @@ void main()
 
   mat4 totalBoneTransform = mat4(0.0);
   vec4 totalLocalNormal = vec4(aNormal, 1.0);
-  if (uHasBones) {
-#ifdef GLES
-    for (int i = 0; i < MAX_WEIGHTS; i++) {
-      int boneId = int(aBoneIds[i]) * 4;
-      mat4 boneTransform = mat4(uBones[boneId + 0],
-                                uBones[boneId + 1],
-                                uBones[boneId + 2],
-                                uBones[boneId + 3]) *
-                           aBoneWeights[i];
-
-      totalBoneTransform += boneTransform;
-    }
-#else
-    for (int i = 0; i < MAX_WEIGHTS; i++) {
-      mat4 boneTransform = uBones[aBoneIds[i]] * aBoneWeights[i];
-      totalBoneTransform += boneTransform;
-    }
+#ifndef SHADER_SKINNED
+  if (uHasBones)
 #endif
+#if !defined(SHADER_SKINNED) || SHADER_SKINNED
+  {
+#ifdef SHADER_INSTANCED
+    if (uHasBakedPose) {
+      // Offset each instance by a pseudo random phase to break up the loop
+      float phase = fract(sin(instancePlusOne * 12.9898) * 43758.5453);
+      float frame = uBakedFrame + phase * float(uBakedFrameCount);
+      int frame0 = int(floor(frame)) % uBakedFrameCount;
+      int frame1 = (frame0 + 1) % uBakedFrameCount;
+      float frameDelta = fract(frame);
+      for (int i = 0; i < MAX_WEIGHTS; i++) {
+        int boneId = int(aBoneIds[i]);
+        mat4 boneTransform =
+          bakedBoneTransform(frame0, boneId) * (1.0 - frameDelta) +
+          bakedBoneTransform(frame1, boneId) * frameDelta;
+        totalBoneTransform += boneTransform * aBoneWeights[i];
+      }
+    } else
+#endif
+    {
+      for (int i = 0; i < MAX_WEIGHTS; i++) {
+        mat4 boneTransform = uBones[int(aBoneIds[i])] * aBoneWeights[i];
+        totalBoneTransform += boneTransform;
+      }
+    }
     totalLocalPos = totalBoneTransform * totalLocalPos;
     totalLocalNormal = totalBoneTransform * totalLocalNormal;
   }
+#endif
 
   TexCoords = aTexCoords;
   vec4 fragPosW = uModelMatrix * totalLocalPos;
@@ -94,6 +124,6 @@ void main()
   vec3 toLight = normalize(uDirLight.Direction - FragPos);
   float cosLightAngle = 1.0 - dot(toLight, Normal);
   float normalOffsetScale = 0.005 * clamp(cosLightAngle, 0.0, 1.0);
-  FragPosLightSpace =
-    uLightSpaceMatrix * (fragPosW + (totalLocalNormal * normalOffsetScale));
+  ShadowPos = fragPosW + (totalLocalNormal * normalOffsetScale);
+  ViewDepth = gl_Position.w;
 }
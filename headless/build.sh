@@ -0,0 +1,34 @@
+#!/bin/sh
+# Builds the headless regression renderer into build/headless, needs Mesa's
+# EGL and GLES 3 headers. Run from the repository root.
+#   build/headless/headless_main . build/headless/shaders -golden <dir>
+#   build/headless/headless_main . build/headless/shaders -bench-anim 10
+set -e
+
+# Goldens are captured with HOKI_DEV=0, a HOKI_DEV=1 build hides the debug UI
+# before its first capture
+HOKI_DEV=${HOKI_DEV:-0}
+OUT=build/headless
+
+# Same as the cl /EP step in build.bat
+mkdir -p $OUT/shaders
+for shader in glsl/*.vert glsl/*.frag; do
+  cpp -P -DGLES=1 -Iglsl/incl "$shader" > $OUT/shaders/$(basename "$shader")
+done
+# PBR variants, the :SHADER_VARIANT step in build.bat
+for skinned in 0 1; do
+  cpp -P -DGLES=1 -DSHADER_SKINNED=$skinned -Iglsl/incl glsl/vertexshader.vert \
+    > $OUT/shaders/pbr_skinned$skinned.vert
+  cpp -P -DGLES=1 -DSHADER_SKINNED=$skinned -Iglsl/incl \
+    glsl/vertex_shader_inst.vert > $OUT/shaders/pbr_inst_skinned$skinned.vert
+done
+for maps in 0 1 2 3 4 5 6 7; do
+  cpp -P -DGLES=1 -DPBR_MAPS=$maps -Iglsl/incl glsl/pbr.frag \
+    > $OUT/shaders/pbr_maps$maps.frag
+done
+
+# Without the warnings build.bat turns off, /wd4505 and /wd4189
+c++ -std=c++17 -O2 -Wall -Wno-unused-function -Wno-unused-variable \
+  -Wno-unused-but-set-variable -DHOKI_DEV=$HOKI_DEV -DHOKI_SLOW=0 -DHOKI_SOUND=0 \
+  -I. -I3rdparty headless/headless_main.cpp -o $OUT/headless_main \
+  -lEGL -lGLESv2 -lpthread
@@ -0,0 +1,603 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cfloat>
+#include <signal.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include <ogl/ogl_main.h>
+#include <ogl/ogl_main.cpp>
+#include <game/game_main.cpp>
+// Dev builds of the game already include it
+#if !HOKI_DEV
+#include <game/debug/debug_anim_bench.cpp>
+#endif
+
+// The game only defines the implementation macros, tinygltf is built without
+// the writer. The Windows and no-stdio settings are not wanted here.
+#undef STBI_MSC_SECURE_CRT
+#undef STBI_NO_STDIO
+#include "../3rdparty/stb_image_write.h"
+
+/**
+ * Headless platform layer for visual regression checks. Creates a
+ * surfaceless EGL context, which Mesa backs with llvmpipe when there is no
+ * GPU, plays a fixed input script on a fixed timestep and writes the
+ * captured frames as PNGs, to build/headless unless -out names another
+ * directory. With a golden directory the captures are compared against the
+ * images there and the run fails when they differ.
+ *
+ * With -bench-anim it renders nothing and runs the animation benchmark for
+ * the given number of seconds instead, on models it loads into its own
+ * memory. The run fails when the BoneTransforms checksum differs from
+ * -checksum, or from the one recorded for ANIMATION_BENCHMARK_SECONDS.
+ *
+ * usage: headless_main <repository root> <preprocessed shader dir>
+ *          [-out <dir>] [-golden <dir>] [-update] [-tolerance <0-255>]
+ *          [-maxdiff <fraction>] [-size <width> <height>]
+ *          [-bench-anim <seconds> [-checksum <hex>]]
+ */
+static const float HEADLESS_FRAME_DELTA = 1.0f / 60.0f;
+static const int HEADLESS_DEFAULT_WIDTH = 640;
+static const int HEADLESS_DEFAULT_HEIGHT = 360;
+static const int HEADLESS_DEFAULT_TOLERANCE = 8;
+static const double HEADLESS_DEFAULT_MAX_DIFF = 0.001;
+static const size_t HEADLESS_PATH_LENGTH = 1024;
+static const size_t HEADLESS_INPUT_BUFFER_SIZE = 64;
+// BoneTransforms checksum of an ANIMATION_BENCHMARK_SECONDS run
+static const uint32_t HEADLESS_BENCH_ANIM_CHECKSUM = 0x4A9313B5;
+
+enum headless_step_type
+{
+  HEADLESS_STEP_CAPTURE,
+  HEADLESS_STEP_TOUCH_DOWN,
+  HEADLESS_STEP_TOUCH_MOVE,
+  HEADLESS_STEP_TOUCH_UP,
+  // The debug UI prints timings that change between runs
+  HEADLESS_STEP_HIDE_DEBUG_UI
+};
+
+struct headless_step
+{
+  uint32_t Frame;
+  headless_step_type Type;
+  // Touch position in 0..1 window space, moves are relative like on Android
+  v2 Position;
+};
+
+// Sorted by frame with captures last within a frame, the run ends after the
+// last step
+static const headless_step HEADLESS_SCRIPT[] = {
+#if HOKI_DEV
+  { 2, HEADLESS_STEP_HIDE_DEBUG_UI, {} },
+#endif
+  { 2, HEADLESS_STEP_CAPTURE, {} },
+  { 60, HEADLESS_STEP_CAPTURE, {} },
+  { 90, HEADLESS_STEP_TOUCH_DOWN, { 0.5f, 0.8f } },
+  { 92, HEADLESS_STEP_TOUCH_MOVE, { 0.0f, -0.15f } },
+  { 94, HEADLESS_STEP_TOUCH_MOVE, { 0.0f, -0.15f } },
+  { 96, HEADLESS_STEP_TOUCH_UP, {} },
+  { 120, HEADLESS_STEP_CAPTURE, {} },
+  { 180, HEADLESS_STEP_CAPTURE, {} },
+};
+
+struct headless_options
+{
+  const char* RootPath;
+  const char* ShaderPath;
+  const char* OutPath;
+  const char* GoldenPath;
+  bool UpdateGolden;
+  int Tolerance;
+  double MaxDiff;
+  int Width;
+  int Height;
+  float BenchAnimSeconds;
+  uint32_t BenchAnimChecksum;
+  bool HasBenchAnimChecksum;
+};
+
+static headless_options Options;
+static game_input_buffer InputBuffer;
+static render_context RenderContext;
+
+// Preprocessed shaders come from the build, the rest from the repository
+static void HeadlessResolvePath(const char* path, char* outPath)
+{
+  const char* fileName = strrchr(path, '/');
+  fileName = fileName != nullptr ? fileName + 1 : path;
+
+  if (strstr(path, "/shaders/preprocessed/") != nullptr) {
+    snprintf(
+      outPath, HEADLESS_PATH_LENGTH, "%s/%s", Options.ShaderPath, fileName);
+  } else if (strstr(path, "/shaders/gl/") != nullptr) {
+    snprintf(outPath,
+             HEADLESS_PATH_LENGTH,
+             "%s/res/shaders/gles/%s",
+             Options.RootPath,
+             fileName);
+  } else {
+    snprintf(outPath, HEADLESS_PATH_LENGTH, "%s%s", Options.RootPath, path);
+  }
+}
+
+PLATFORM_READ_FILE(HeadlessReadFile)
+{
+  char fullPath[HEADLESS_PATH_LENGTH];
+  HeadlessResolvePath(path, fullPath);
+
+  FILE* file = fopen(fullPath, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Can't read %s\n", fullPath);
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  size_t read = fread(memory, 1, (size_t)size, file);
+  fclose(file);
+
+  HOKI_ASSERT(read == (size_t)size);
+}
+
+PLATFORM_GET_FILE_SIZE(HeadlessGetFileSize)
+{
+  char fullPath[HEADLESS_PATH_LENGTH];
+  HeadlessResolvePath(path, fullPath);
+
+  FILE* file = fopen(fullPath, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Can't find %s\n", fullPath);
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+
+  return (size_t)size;
+}
+
+// Work runs inline, it keeps the frames deterministic
+PLATFORM_ADD_WORK_QUEUE_ENTRY(HeadlessPushJob)
+{
+  callback(data);
+}
+
+PLATFORM_COMPLETE_ALL_QUEUE_WORK(HeadlessCompleteAllWork) {}
+
+PLATFORM_LOG(HeadlessLog)
+{
+  va_list argptr;
+  va_start(argptr, fmt);
+  vprintf(fmt, argptr);
+  va_end(argptr);
+}
+
+static bool HeadlessCreateContext(const int width, const int height)
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (getPlatformDisplay != nullptr) {
+    display = getPlatformDisplay(
+      EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    fprintf(stderr, "No EGL display\n");
+    return false;
+  }
+  eglBindAPI(EGL_OPENGL_ES_API);
+
+  const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE,
+                                      EGL_OPENGL_ES3_BIT,
+                                      EGL_SURFACE_TYPE,
+                                      EGL_PBUFFER_BIT,
+                                      EGL_RED_SIZE,
+                                      8,
+                                      EGL_GREEN_SIZE,
+                                      8,
+                                      EGL_BLUE_SIZE,
+                                      8,
+                                      EGL_DEPTH_SIZE,
+                                      24,
+                                      EGL_STENCIL_SIZE,
+                                      8,
+                                      EGL_NONE };
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+      configCount == 0) {
+    fprintf(stderr, "No EGL config for GLES 3\n");
+    return false;
+  }
+
+  const EGLint surfaceAttributes[] = {
+    EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE
+  };
+  EGLSurface surface =
+    eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+  const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE };
+  EGLContext context =
+    eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+  if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display, surface, surface, context)) {
+    fprintf(stderr, "Can't create the EGL context\n");
+    return false;
+  }
+
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  return true;
+}
+
+static void HeadlessPushInput(const headless_step& step)
+{
+  HOKI_ASSERT(InputBuffer.InputCount < HEADLESS_INPUT_BUFFER_SIZE);
+  game_input& input = InputBuffer.Inputs[InputBuffer.InputCount++];
+  input = {};
+  input.Position = step.Position;
+
+  switch (step.Type) {
+    case HEADLESS_STEP_TOUCH_DOWN:
+      input.State.Code = INPUT_CODE_CURSOR_CLICK;
+      input.State.Flags = INPUT_STATE_IS_DOWN | INPUT_STATE_CHANGED;
+      break;
+    case HEADLESS_STEP_TOUCH_MOVE:
+      input.State.Code = INPUT_CODE_CURSOR_MOVE;
+      break;
+    case HEADLESS_STEP_TOUCH_UP:
+      input.State.Code = INPUT_CODE_CURSOR_CLICK;
+      input.State.Flags = INPUT_STATE_IS_UP | INPUT_STATE_CHANGED;
+      break;
+    case HEADLESS_STEP_HIDE_DEBUG_UI:
+      input.State.Code = INPUT_CODE_NUM_5;
+      input.State.Flags = INPUT_STATE_IS_UP | INPUT_STATE_CHANGED;
+      break;
+    default:
+      break;
+  }
+}
+
+// Marks differing pixels red over a dimmed copy of the capture
+static void HeadlessWriteDiff(const char* path,
+                              const uint8_t* pixels,
+                              const uint8_t* golden,
+                              const int width,
+                              const int height)
+{
+  const size_t pixelCount = (size_t)width * height;
+  uint8_t* diff = (uint8_t*)malloc(pixelCount * 4);
+  for (size_t i = 0; i < pixelCount; i++) {
+    const uint8_t* a = pixels + i * 4;
+    const uint8_t* b = golden + i * 4;
+    uint8_t* out = diff + i * 4;
+    int delta = 0;
+    for (int c = 0; c < 3; c++) {
+      int channelDelta = abs((int)a[c] - (int)b[c]);
+      delta = channelDelta > delta ? channelDelta : delta;
+    }
+
+    if (delta > Options.Tolerance) {
+      out[0] = 255;
+      out[1] = 0;
+      out[2] = 0;
+    } else {
+      uint8_t gray = (uint8_t)((a[0] + a[1] + a[2]) / 12);
+      out[0] = gray;
+      out[1] = gray;
+      out[2] = gray;
+    }
+    out[3] = 255;
+  }
+
+  stbi_write_png(path, width, height, 4, diff, width * 4);
+  free(diff);
+}
+
+// Returns true when the capture matches the golden image
+static bool HeadlessCompare(const char* name,
+                            const uint8_t* pixels,
+                            const int width,
+                            const int height)
+{
+  char goldenPath[HEADLESS_PATH_LENGTH];
+  snprintf(
+    goldenPath, HEADLESS_PATH_LENGTH, "%s/%s.png", Options.GoldenPath, name);
+
+  if (Options.UpdateGolden) {
+    if (!stbi_write_png(goldenPath, width, height, 4, pixels, width * 4)) {
+      fprintf(stderr, "%s: could not write %s\n", name, goldenPath);
+      return false;
+    }
+    printf("%s: golden updated\n", name);
+    return true;
+  }
+
+  int goldenWidth = 0;
+  int goldenHeight = 0;
+  int goldenChannels = 0;
+  uint8_t* golden =
+    stbi_load(goldenPath, &goldenWidth, &goldenHeight, &goldenChannels, 4);
+  if (golden == nullptr) {
+    printf("%s: FAIL, no golden image at %s\n", name, goldenPath);
+    return false;
+  }
+  if (goldenWidth != width || goldenHeight != height) {
+    printf("%s: FAIL, golden is %dx%d, capture %dx%d\n",
+           name,
+           goldenWidth,
+           goldenHeight,
+           width,
+           height);
+    stbi_image_free(golden);
+    return false;
+  }
+
+  const size_t pixelCount = (size_t)width * height;
+  size_t differing = 0;
+  int maxDelta = 0;
+  for (size_t i = 0; i < pixelCount * 4; i += 4) {
+    int delta = 0;
+    for (int c = 0; c < 3; c++) {
+      int channelDelta = abs((int)pixels[i + c] - (int)golden[i + c]);
+      delta = channelDelta > delta ? channelDelta : delta;
+    }
+    maxDelta = delta > maxDelta ? delta : maxDelta;
+    if (delta > Options.Tolerance) {
+      differing++;
+    }
+  }
+
+  const double diffFraction = (double)differing / (double)pixelCount;
+  const bool passed = diffFraction <= Options.MaxDiff;
+  printf("%s: %s, %zu pixels over tolerance (%.4f%%), max delta %d\n",
+         name,
+         passed ? "ok" : "FAIL",
+         differing,
+         diffFraction * 100.0,
+         maxDelta);
+
+  if (!passed) {
+    char diffPath[HEADLESS_PATH_LENGTH];
+    snprintf(
+      diffPath, HEADLESS_PATH_LENGTH, "%s/%s_diff.png", Options.OutPath, name);
+    HeadlessWriteDiff(diffPath, pixels, golden, width, height);
+  }
+
+  stbi_image_free(golden);
+  return passed;
+}
+
+static bool HeadlessCapture(const uint32_t frame)
+{
+  const int width = Options.Width;
+  const int height = Options.Height;
+  uint8_t* pixels = (uint8_t*)malloc((size_t)width * height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+  // GL rows start from the bottom
+  const size_t rowSize = (size_t)width * 4;
+  uint8_t* row = (uint8_t*)malloc(rowSize);
+  for (int y = 0; y < height / 2; y++) {
+    uint8_t* top = pixels + rowSize * y;
+    uint8_t* bottom = pixels + rowSize * (height - 1 - y);
+    memcpy(row, top, rowSize);
+    memcpy(top, bottom, rowSize);
+    memcpy(bottom, row, rowSize);
+  }
+  free(row);
+
+  // The clear color is transparent in release builds
+  for (size_t i = 3; i < rowSize * height; i += 4) {
+    pixels[i] = 255;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "frame_%04u", frame);
+  char outPath[HEADLESS_PATH_LENGTH];
+  snprintf(outPath, HEADLESS_PATH_LENGTH, "%s/%s.png", Options.OutPath, name);
+  bool passed = true;
+  if (!stbi_write_png(outPath, width, height, 4, pixels, width * 4)) {
+    fprintf(stderr, "%s: could not write %s\n", name, outPath);
+    passed = false;
+  }
+
+  if (Options.GoldenPath != nullptr) {
+    passed = HeadlessCompare(name, pixels, width, height) && passed;
+  }
+
+  free(pixels);
+  return passed;
+}
+
+static bool HeadlessParseOptions(int argc, char** argv)
+{
+  if (argc < 3) {
+    return false;
+  }
+
+  Options.RootPath = argv[1];
+  Options.ShaderPath = argv[2];
+  Options.OutPath = "build/headless";
+  Options.Tolerance = HEADLESS_DEFAULT_TOLERANCE;
+  Options.MaxDiff = HEADLESS_DEFAULT_MAX_DIFF;
+  Options.Width = HEADLESS_DEFAULT_WIDTH;
+  Options.Height = HEADLESS_DEFAULT_HEIGHT;
+
+  for (int i = 3; i < argc; i++) {
+    const char* option = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(option, "-out") == 0 && hasValue) {
+      Options.OutPath = argv[++i];
+    } else if (strcmp(option, "-golden") == 0 && hasValue) {
+      Options.GoldenPath = argv[++i];
+    } else if (strcmp(option, "-update") == 0) {
+      Options.UpdateGolden = true;
+    } else if (strcmp(option, "-tolerance") == 0 && hasValue) {
+      Options.Tolerance = atoi(argv[++i]);
+    } else if (strcmp(option, "-maxdiff") == 0 && hasValue) {
+      Options.MaxDiff = atof(argv[++i]);
+    } else if (strcmp(option, "-size") == 0 && i + 2 < argc) {
+      Options.Width = atoi(argv[++i]);
+      Options.Height = atoi(argv[++i]);
+    } else if (strcmp(option, "-bench-anim") == 0 && hasValue) {
+      Options.BenchAnimSeconds = (float)atof(argv[++i]);
+    } else if (strcmp(option, "-checksum") == 0 && hasValue) {
+      Options.BenchAnimChecksum = (uint32_t)strtoul(argv[++i], nullptr, 16);
+      Options.HasBenchAnimChecksum = true;
+    } else {
+      return false;
+    }
+  }
+
+  // Only the default length has a recorded checksum
+  if (Options.BenchAnimSeconds > 0.0f && !Options.HasBenchAnimChecksum) {
+    if (Options.BenchAnimSeconds != ANIMATION_BENCHMARK_SECONDS) {
+      return false;
+    }
+    Options.BenchAnimChecksum = HEADLESS_BENCH_ANIM_CHECKSUM;
+  }
+
+  return !Options.UpdateGolden || Options.GoldenPath != nullptr;
+}
+
+/**
+ * Loads the player and goalie models the way the game does, into memory of
+ * its own since the game is not run, and checks the benchmark's checksum.
+ */
+static int HeadlessRunAnimationBenchmark()
+{
+  game_memory memory = {};
+  memory.PermanentStorageSize = SIZE_MB(16);
+  memory.PermanentStorage = calloc(1, memory.PermanentStorageSize);
+  memory.TransientStorageSize = SIZE_MB(128);
+  memory.TransientStorage = calloc(1, memory.TransientStorageSize);
+  memory.ReadFile = HeadlessReadFile;
+  memory.GetFileSize = HeadlessGetFileSize;
+  memory.AddWorkEntry = HeadlessPushJob;
+  memory.CompleteAllQueueWork = HeadlessCompleteAllWork;
+  memory.Log = HeadlessLog;
+  init_allocator(memory);
+  DEBUG_LOG = HeadlessLog;
+
+  const Asset::model playerModel =
+    Asset::loadModel("/res/models/hockeyplayer.glb", memory);
+  const Asset::model goalieModel =
+    Asset::loadModel("/res/models/goalie.glb", memory);
+
+  AnimationSystem::animator* benchAnimator = nullptr;
+  game_entity* entities = nullptr;
+  create_animation_benchmark(
+    &playerModel, &goalieModel, benchAnimator, entities);
+  const animation_benchmark_result result =
+    run_animation_benchmark(&playerModel,
+                            &goalieModel,
+                            benchAnimator,
+                            entities,
+                            Options.BenchAnimSeconds);
+  log_animation_benchmark(result);
+
+  if (result.Checksum != Options.BenchAnimChecksum) {
+    fprintf(stderr,
+            "Animation benchmark: checksum %08X, expected %08X\n",
+            result.Checksum,
+            Options.BenchAnimChecksum);
+    return 1;
+  }
+
+  return 0;
+}
+
+static bool HeadlessMakeDirectory(const char* path)
+{
+  if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Could not create directory %s\n", path);
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  if (!HeadlessParseOptions(argc, argv)) {
+    fprintf(stderr,
+            "usage: %s <repository root> <preprocessed shader dir> "
+            "[-out <dir>] [-golden <dir>] [-update] [-tolerance <0-255>] "
+            "[-maxdiff <fraction>] [-size <width> <height>] "
+            "[-bench-anim <seconds> [-checksum <hex>]]\n",
+            argv[0]);
+    return 2;
+  }
+
+  if (Options.BenchAnimSeconds > 0.0f) {
+    return HeadlessRunAnimationBenchmark();
+  }
+
+  if (!HeadlessMakeDirectory(Options.OutPath) ||
+      (Options.UpdateGolden && !HeadlessMakeDirectory(Options.GoldenPath))) {
+    return 2;
+  }
+
+  if (!HeadlessCreateContext(Options.Width, Options.Height)) {
+    return 2;
+  }
+
+  game_memory memory = {};
+  memory.PermanentStorageSize = SIZE_MB(64);
+  memory.PermanentStorage = calloc(1, memory.PermanentStorageSize);
+  memory.TransientStorageSize = SIZE_MB(128);
+  memory.TransientStorage = calloc(1, memory.TransientStorageSize);
+  memory.ReadFile = HeadlessReadFile;
+  memory.WriteFile = WriteFileStub;
+  memory.GetFileSize = HeadlessGetFileSize;
+  memory.AddWorkEntry = HeadlessPushJob;
+  memory.CompleteAllQueueWork = HeadlessCompleteAllWork;
+  memory.Log = HeadlessLog;
+
+  InputBuffer.Inputs =
+    (game_input*)calloc(HEADLESS_INPUT_BUFFER_SIZE, sizeof(game_input));
+
+  game_window_info windowInfo = {};
+  windowInfo.Width = Options.Width;
+  windowInfo.Height = Options.Height;
+
+  const size_t stepCount = ARRAY_SIZE(HEADLESS_SCRIPT);
+  const uint32_t lastFrame = HEADLESS_SCRIPT[stepCount - 1].Frame;
+  size_t nextStep = 0;
+  int failed = 0;
+  for (uint32_t frame = 1; frame <= lastFrame; frame++) {
+    while (nextStep < stepCount && HEADLESS_SCRIPT[nextStep].Frame == frame &&
+           HEADLESS_SCRIPT[nextStep].Type != HEADLESS_STEP_CAPTURE) {
+      HeadlessPushInput(HEADLESS_SCRIPT[nextStep++]);
+    }
+
+    GameMain(
+      memory, windowInfo, RenderContext, InputBuffer, HEADLESS_FRAME_DELTA);
+    RendererMain(windowInfo, RenderContext);
+    glFinish();
+
+    while (nextStep < stepCount && HEADLESS_SCRIPT[nextStep].Frame == frame) {
+      HOKI_ASSERT(HEADLESS_SCRIPT[nextStep].Type == HEADLESS_STEP_CAPTURE);
+      if (!HeadlessCapture(frame)) {
+        failed++;
+      }
+      nextStep++;
+    }
+  }
+
+  return failed > 0 ? 1 : 0;
+}
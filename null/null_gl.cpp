@@ -0,0 +1,912 @@
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Recording stand-in for the OpenGL ES 3.0 subset the renderer uses. Calls
+ * are appended to NullTrace, names are handed out from a counter and every
+ * query reports success.
+ */
+#define GL_ES_VERSION_3_0 1
+
+typedef unsigned int GLenum;
+typedef unsigned int GLbitfield;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLboolean;
+typedef unsigned char GLubyte;
+typedef float GLfloat;
+typedef char GLchar;
+typedef void GLvoid;
+typedef intptr_t GLintptr;
+typedef intptr_t GLsizeiptr;
+
+#define GL_NO_ERROR 0
+#define GL_FALSE 0
+#define GL_TRUE 1
+#define GL_NONE 0
+
+#define GL_LINES 0x0001
+#define GL_TRIANGLES 0x0004
+
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+
+#define GL_DEPTH_BUFFER_BIT 0x00000100
+#define GL_STENCIL_BUFFER_BIT 0x00000400
+#define GL_COLOR_BUFFER_BIT 0x00004000
+
+#define GL_LEQUAL 0x0203
+#define GL_SRC_ALPHA 0x0302
+#define GL_ONE_MINUS_SRC_ALPHA 0x0303
+#define GL_FRONT 0x0404
+#define GL_BACK 0x0405
+#define GL_FRONT_AND_BACK 0x0408
+
+#define GL_LINE_SMOOTH 0x0B20
+#define GL_POLYGON_MODE 0x0B40
+#define GL_CULL_FACE 0x0B44
+#define GL_DEPTH_TEST 0x0B71
+#define GL_BLEND 0x0BE2
+#define GL_SCISSOR_TEST 0x0C11
+#define GL_UNPACK_ALIGNMENT 0x0CF5
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_TEXTURE_BORDER_COLOR 0x1004
+
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_UNSIGNED_SHORT 0x1403
+#define GL_UNSIGNED_INT 0x1405
+#define GL_FLOAT 0x1406
+#define GL_HALF_FLOAT 0x140B
+
+#define GL_TEXTURE 0x1702
+#define GL_DEPTH_COMPONENT 0x1902
+#define GL_RED 0x1903
+#define GL_RGB 0x1907
+#define GL_RGBA 0x1908
+#define GL_LUMINANCE 0x1909
+#define GL_LINE 0x1B01
+#define GL_FILL 0x1B02
+#define GL_VENDOR 0x1F00
+#define GL_RENDERER 0x1F01
+#define GL_VERSION 0x1F02
+#define GL_EXTENSIONS 0x1F03
+
+#define GL_NEAREST 0x2600
+#define GL_LINEAR 0x2601
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_TEXTURE_WRAP_S 0x2802
+#define GL_TEXTURE_WRAP_T 0x2803
+#define GL_REPEAT 0x2901
+
+#define GL_RGBA8 0x8058
+#define GL_VERTEX_ARRAY 0x8074
+#define GL_BGR_EXT 0x80E0
+#define GL_BGRA_EXT 0x80E1
+#define GL_DEPTH_COMPONENT24 0x81A6
+#define GL_CLAMP_TO_BORDER 0x812D
+#define GL_CLAMP_TO_EDGE 0x812F
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#define GL_R8 0x8229
+#define GL_NUM_EXTENSIONS 0x821D
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_SHADER 0x82E1
+#define GL_PROGRAM 0x82E2
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_TEXTURE0 0x84C0
+#define GL_RGBA32F 0x8814
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STREAM_DRAW 0x88E0
+#define GL_STATIC_DRAW 0x88E4
+#define GL_DYNAMIC_DRAW 0x88E8
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#define GL_INFO_LOG_LENGTH 0x8B84
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#define GL_DEPTH_ATTACHMENT 0x8D00
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_FRAMEBUFFER_SRGB 0x8DB9
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+
+static null_renderer_trace NullTrace;
+
+// Pixel uploads from a bound unpack buffer were counted when it was mapped
+static GLuint NullUnpackBuffer;
+static void* NullMappedMemory;
+static size_t NullMappedBytes;
+
+static const char* NullCopyString(const char* string)
+{
+  const size_t length = strlen(string) + 1;
+  if (NullTrace.StringBytes + length > NULL_GL_MAX_STRING_BYTES) {
+    return "...";
+  }
+
+  char* copy = NullTrace.Strings + NullTrace.StringBytes;
+  memcpy(copy, string, length);
+  NullTrace.StringBytes += length;
+
+  return copy;
+}
+
+static void NullRecordCall(const char* function, const char* signature, ...)
+{
+  NullTrace.Frame.Calls++;
+  if (NullTrace.CallCount >= NULL_GL_MAX_CALLS) {
+    NullTrace.DroppedCalls++;
+    return;
+  }
+
+  null_gl_call& call = NullTrace.Calls[NullTrace.CallCount++];
+  call.Function = function;
+  call.Signature = signature;
+
+  va_list arguments;
+  va_start(arguments, signature);
+  for (size_t i = 0; signature[i] != '\0' && i < NULL_GL_MAX_ARGUMENTS; i++) {
+    null_gl_argument& argument = call.Arguments[i];
+    switch (signature[i]) {
+      case 'e':
+      case 'b':
+      case 'u':
+        argument.Int = va_arg(arguments, unsigned int);
+        break;
+      case 'i':
+        argument.Int = va_arg(arguments, int);
+        break;
+      case 'z':
+        argument.Int = va_arg(arguments, intptr_t);
+        break;
+      case 'f':
+        argument.Float = va_arg(arguments, double);
+        break;
+      case 's':
+        argument.Pointer = NullCopyString(va_arg(arguments, const char*));
+        break;
+      default:
+        argument.Pointer = va_arg(arguments, const void*);
+        break;
+    }
+  }
+  va_end(arguments);
+}
+
+static GLuint NullGenName()
+{
+  return ++NullTrace.NextName;
+}
+
+static void NullGenNames(GLsizei n, GLuint* names)
+{
+  for (GLsizei i = 0; i < n; i++) {
+    names[i] = NullGenName();
+  }
+}
+
+static void NullUniformUpload(const size_t bytes)
+{
+  NullTrace.Frame.UniformUploads++;
+  NullTrace.Frame.UniformBytes += bytes;
+}
+
+static size_t NullTexelBytes(const GLenum format, const GLenum type)
+{
+  size_t components = 4;
+  switch (format) {
+    case GL_RED:
+    case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT:
+      components = 1;
+      break;
+    case GL_RGB:
+    case GL_BGR_EXT:
+      components = 3;
+      break;
+  }
+
+  return components * (type == GL_FLOAT || type == GL_UNSIGNED_INT ? 4 : 1);
+}
+
+/** Objects */
+
+static void glGenBuffers(GLsizei n, GLuint* buffers)
+{
+  NullGenNames(n, buffers);
+  NullRecordCall("glGenBuffers", "ip", n, buffers);
+}
+
+static void glGenTextures(GLsizei n, GLuint* textures)
+{
+  NullGenNames(n, textures);
+  NullRecordCall("glGenTextures", "ip", n, textures);
+}
+
+static void glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+  NullGenNames(n, arrays);
+  NullRecordCall("glGenVertexArrays", "ip", n, arrays);
+}
+
+static void glGenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+  NullGenNames(n, framebuffers);
+  NullRecordCall("glGenFramebuffers", "ip", n, framebuffers);
+}
+
+static void glGenQueries(GLsizei n, GLuint* ids)
+{
+  NullGenNames(n, ids);
+  NullRecordCall("glGenQueries", "ip", n, ids);
+}
+
+static void glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+  NullRecordCall("glDeleteTextures", "ip", n, textures);
+}
+
+static void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+  NullRecordCall("glDeleteFramebuffers", "ip", n, framebuffers);
+}
+
+static GLuint glCreateShader(GLenum type)
+{
+  NullRecordCall("glCreateShader", "e", type);
+  return NullGenName();
+}
+
+static GLuint glCreateProgram()
+{
+  NullRecordCall("glCreateProgram", "");
+  return NullGenName();
+}
+
+static void glShaderSource(GLuint shader,
+                           GLsizei count,
+                           const GLchar* const* string,
+                           const GLint* length)
+{
+  NullRecordCall("glShaderSource", "uipp", shader, count, string, length);
+}
+
+static void glCompileShader(GLuint shader)
+{
+  NullRecordCall("glCompileShader", "u", shader);
+}
+
+static void glAttachShader(GLuint program, GLuint shader)
+{
+  NullRecordCall("glAttachShader", "uu", program, shader);
+}
+
+static void glLinkProgram(GLuint program)
+{
+  NullRecordCall("glLinkProgram", "u", program);
+}
+
+static void glDeleteShader(GLuint shader)
+{
+  NullRecordCall("glDeleteShader", "u", shader);
+}
+
+static void glDeleteProgram(GLuint program)
+{
+  NullRecordCall("glDeleteProgram", "u", program);
+}
+
+static void glProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+  NullRecordCall("glProgramParameteri", "uei", program, pname, value);
+}
+
+// No binary formats, the program cache stays empty
+static void glGetProgramBinary(GLuint program,
+                               GLsizei bufSize,
+                               GLsizei* length,
+                               GLenum* binaryFormat,
+                               void* binary)
+{
+  NullRecordCall("glGetProgramBinary",
+                 "uippp",
+                 program,
+                 bufSize,
+                 length,
+                 binaryFormat,
+                 binary);
+  if (length != nullptr) {
+    *length = 0;
+  }
+}
+
+static void glProgramBinary(GLuint program,
+                            GLenum binaryFormat,
+                            const void* binary,
+                            GLsizei length)
+{
+  NullRecordCall(
+    "glProgramBinary", "uepi", program, binaryFormat, binary, length);
+}
+
+static const GLubyte* glGetString(GLenum name)
+{
+  NullRecordCall("glGetString", "e", name);
+  return (const GLubyte*)"null";
+}
+
+// Reports timer queries so the renderer's GPU pass timers are traced
+static const GLubyte* glGetStringi(GLenum name, GLuint index)
+{
+  NullRecordCall("glGetStringi", "eu", name, index);
+  return (const GLubyte*)"GL_EXT_disjoint_timer_query";
+}
+
+static void glGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+  NullRecordCall("glGetShaderiv", "uep", shader, pname, params);
+  *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void glGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+  NullRecordCall("glGetProgramiv", "uep", program, pname, params);
+  *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+static void glGetShaderInfoLog(GLuint shader,
+                               GLsizei bufSize,
+                               GLsizei* length,
+                               GLchar* infoLog)
+{
+  NullRecordCall(
+    "glGetShaderInfoLog", "uipp", shader, bufSize, length, infoLog);
+  if (length != nullptr) {
+    *length = 0;
+  }
+  if (infoLog != nullptr && bufSize > 0) {
+    infoLog[0] = '\0';
+  }
+}
+
+static void glGetProgramInfoLog(GLuint program,
+                                GLsizei bufSize,
+                                GLsizei* length,
+                                GLchar* infoLog)
+{
+  NullRecordCall(
+    "glGetProgramInfoLog", "uipp", program, bufSize, length, infoLog);
+  if (length != nullptr) {
+    *length = 0;
+  }
+  if (infoLog != nullptr && bufSize > 0) {
+    infoLog[0] = '\0';
+  }
+}
+
+static GLint glGetUniformLocation(GLuint program, const GLchar* name)
+{
+  NullRecordCall("glGetUniformLocation", "us", program, name);
+  return NullTrace.NextUniformLocation++;
+}
+
+static GLuint glGetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+  NullRecordCall("glGetUniformBlockIndex", "us", program, name);
+  return 0;
+}
+
+static void glUniformBlockBinding(GLuint program,
+                                  GLuint blockIndex,
+                                  GLuint blockBinding)
+{
+  NullRecordCall(
+    "glUniformBlockBinding", "uuu", program, blockIndex, blockBinding);
+}
+
+static void glFramebufferTexture2D(GLenum target,
+                                   GLenum attachment,
+                                   GLenum textarget,
+                                   GLuint texture,
+                                   GLint level)
+{
+  NullRecordCall("glFramebufferTexture2D",
+                 "eeeui",
+                 target,
+                 attachment,
+                 textarget,
+                 texture,
+                 level);
+}
+
+static GLenum glCheckFramebufferStatus(GLenum target)
+{
+  NullRecordCall("glCheckFramebufferStatus", "e", target);
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLenum glGetError()
+{
+  NullRecordCall("glGetError", "");
+  return GL_NO_ERROR;
+}
+
+static void glGetIntegerv(GLenum pname, GLint* data)
+{
+  NullRecordCall("glGetIntegerv", "ep", pname, data);
+  switch (pname) {
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+      *data = 256;
+      break;
+    case GL_NUM_EXTENSIONS:
+      *data = 1;
+      break;
+    default:
+      *data = 0;
+      break;
+  }
+}
+
+// Results are always ready and 0
+static void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params)
+{
+  NullRecordCall("glGetQueryObjectuiv", "uep", id, pname, params);
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+/** Uploads */
+
+static void glBufferData(GLenum target,
+                         GLsizeiptr size,
+                         const void* data,
+                         GLenum usage)
+{
+  NullRecordCall("glBufferData", "ezpe", target, size, data, usage);
+  NullTrace.Frame.BytesUploaded += data != nullptr ? (uint64_t)size : 0;
+  if (target == GL_UNIFORM_BUFFER && data != nullptr) {
+    NullUniformUpload((size_t)size);
+  }
+}
+
+static void glBufferSubData(GLenum target,
+                            GLintptr offset,
+                            GLsizeiptr size,
+                            const void* data)
+{
+  NullRecordCall("glBufferSubData", "ezzp", target, offset, size, data);
+  NullTrace.Frame.BytesUploaded += (uint64_t)size;
+  if (target == GL_UNIFORM_BUFFER) {
+    NullUniformUpload((size_t)size);
+  }
+}
+
+static void* glMapBufferRange(GLenum target,
+                              GLintptr offset,
+                              GLsizeiptr length,
+                              GLbitfield access)
+{
+  NullRecordCall("glMapBufferRange", "ezzb", target, offset, length, access);
+  if ((size_t)length > NullMappedBytes) {
+    void* grown = realloc(NullMappedMemory, (size_t)length);
+    if (grown == nullptr) {
+      return nullptr;
+    }
+    NullMappedMemory = grown;
+    NullMappedBytes = (size_t)length;
+  }
+  NullTrace.Frame.BytesUploaded += (uint64_t)length;
+
+  return NullMappedMemory;
+}
+
+static GLboolean glUnmapBuffer(GLenum target)
+{
+  NullRecordCall("glUnmapBuffer", "e", target);
+  return GL_TRUE;
+}
+
+static void glTexImage2D(GLenum target,
+                         GLint level,
+                         GLint internalformat,
+                         GLsizei width,
+                         GLsizei height,
+                         GLint border,
+                         GLenum format,
+                         GLenum type,
+                         const void* pixels)
+{
+  NullRecordCall("glTexImage2D",
+                 "eieiiieep",
+                 target,
+                 level,
+                 internalformat,
+                 width,
+                 height,
+                 border,
+                 format,
+                 type,
+                 pixels);
+  if (pixels != nullptr && NullUnpackBuffer == 0) {
+    NullTrace.Frame.BytesUploaded +=
+      (uint64_t)width * height * NullTexelBytes(format, type);
+  }
+}
+
+static void glTexSubImage2D(GLenum target,
+                            GLint level,
+                            GLint xoffset,
+                            GLint yoffset,
+                            GLsizei width,
+                            GLsizei height,
+                            GLenum format,
+                            GLenum type,
+                            const void* pixels)
+{
+  NullRecordCall("glTexSubImage2D",
+                 "eiiiiieep",
+                 target,
+                 level,
+                 xoffset,
+                 yoffset,
+                 width,
+                 height,
+                 format,
+                 type,
+                 pixels);
+  if (pixels != nullptr && NullUnpackBuffer == 0) {
+    NullTrace.Frame.BytesUploaded +=
+      (uint64_t)width * height * NullTexelBytes(format, type);
+  }
+}
+
+static void glCompressedTexImage2D(GLenum target,
+                                   GLint level,
+                                   GLenum internalformat,
+                                   GLsizei width,
+                                   GLsizei height,
+                                   GLint border,
+                                   GLsizei imageSize,
+                                   const void* data)
+{
+  NullRecordCall("glCompressedTexImage2D",
+                 "eieiiiip",
+                 target,
+                 level,
+                 internalformat,
+                 width,
+                 height,
+                 border,
+                 imageSize,
+                 data);
+  if (NullUnpackBuffer == 0) {
+    NullTrace.Frame.BytesUploaded += (uint64_t)imageSize;
+  }
+}
+
+static void glGenerateMipmap(GLenum target)
+{
+  NullRecordCall("glGenerateMipmap", "e", target);
+}
+
+static void glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+  NullRecordCall("glTexParameteri", "eei", target, pname, param);
+}
+
+static void glTexParameterfv(GLenum target,
+                             GLenum pname,
+                             const GLfloat* params)
+{
+  NullRecordCall("glTexParameterfv", "eep", target, pname, params);
+}
+
+static void glVertexAttribPointer(GLuint index,
+                                  GLint size,
+                                  GLenum type,
+                                  GLboolean normalized,
+                                  GLsizei stride,
+                                  const void* pointer)
+{
+  NullRecordCall("glVertexAttribPointer",
+                 "uieuip",
+                 index,
+                 size,
+                 type,
+                 (unsigned int)normalized,
+                 stride,
+                 pointer);
+}
+
+static void glVertexAttribIPointer(GLuint index,
+                                   GLint size,
+                                   GLenum type,
+                                   GLsizei stride,
+                                   const void* pointer)
+{
+  NullRecordCall(
+    "glVertexAttribIPointer", "uieip", index, size, type, stride, pointer);
+}
+
+static void glEnableVertexAttribArray(GLuint index)
+{
+  NullRecordCall("glEnableVertexAttribArray", "u", index);
+}
+
+static void glDisableVertexAttribArray(GLuint index)
+{
+  NullRecordCall("glDisableVertexAttribArray", "u", index);
+}
+
+static void glVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z)
+{
+  NullRecordCall("glVertexAttrib3f", "ufff", index, x, y, z);
+}
+
+/** State */
+
+static void glEnable(GLenum cap)
+{
+  NullRecordCall("glEnable", "e", cap);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glDisable(GLenum cap)
+{
+  NullRecordCall("glDisable", "e", cap);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+  NullRecordCall("glBlendFunc", "ee", sfactor, dfactor);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glDepthFunc(GLenum func)
+{
+  NullRecordCall("glDepthFunc", "e", func);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glCullFace(GLenum mode)
+{
+  NullRecordCall("glCullFace", "e", mode);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glPixelStorei(GLenum pname, GLint param)
+{
+  NullRecordCall("glPixelStorei", "ei", pname, param);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  NullRecordCall("glViewport", "iiii", x, y, width, height);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  NullRecordCall("glScissor", "iiii", x, y, width, height);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glClearColor(GLfloat red,
+                         GLfloat green,
+                         GLfloat blue,
+                         GLfloat alpha)
+{
+  NullRecordCall("glClearColor", "ffff", red, green, blue, alpha);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glUseProgram(GLuint program)
+{
+  NullRecordCall("glUseProgram", "u", program);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBindVertexArray(GLuint array)
+{
+  NullRecordCall("glBindVertexArray", "u", array);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBindBuffer(GLenum target, GLuint buffer)
+{
+  NullRecordCall("glBindBuffer", "eu", target, buffer);
+  NullTrace.Frame.StateChanges++;
+  if (target == GL_PIXEL_UNPACK_BUFFER) {
+    NullUnpackBuffer = buffer;
+  }
+}
+
+static void glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+  NullRecordCall("glBindBufferBase", "euu", target, index, buffer);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBindBufferRange(GLenum target,
+                              GLuint index,
+                              GLuint buffer,
+                              GLintptr offset,
+                              GLsizeiptr size)
+{
+  NullRecordCall(
+    "glBindBufferRange", "euuzz", target, index, buffer, offset, size);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBindTexture(GLenum target, GLuint texture)
+{
+  NullRecordCall("glBindTexture", "eu", target, texture);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glActiveTexture(GLenum texture)
+{
+  NullRecordCall("glActiveTexture", "e", texture);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  NullRecordCall("glBindFramebuffer", "eu", target, framebuffer);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBlitFramebuffer(GLint srcX0,
+                              GLint srcY0,
+                              GLint srcX1,
+                              GLint srcY1,
+                              GLint dstX0,
+                              GLint dstY0,
+                              GLint dstX1,
+                              GLint dstY1,
+                              GLbitfield mask,
+                              GLenum filter)
+{
+  NullRecordCall("glBlitFramebuffer",
+                 "iiiiiiiibe",
+                 srcX0,
+                 srcY0,
+                 srcX1,
+                 srcY1,
+                 dstX0,
+                 dstY0,
+                 dstX1,
+                 dstY1,
+                 mask,
+                 filter);
+}
+
+static void glDrawBuffer(GLenum buf)
+{
+  NullRecordCall("glDrawBuffer", "e", buf);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glDrawBuffers(GLsizei n, const GLenum* bufs)
+{
+  NullRecordCall("glDrawBuffers", "ip", n, bufs);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glReadBuffer(GLenum src)
+{
+  NullRecordCall("glReadBuffer", "e", src);
+  NullTrace.Frame.StateChanges++;
+}
+
+static void glBeginQuery(GLenum target, GLuint id)
+{
+  NullRecordCall("glBeginQuery", "eu", target, id);
+}
+
+static void glEndQuery(GLenum target)
+{
+  NullRecordCall("glEndQuery", "e", target);
+}
+
+/** Uniforms */
+
+static void glUniform1f(GLint location, GLfloat v0)
+{
+  NullRecordCall("glUniform1f", "if", location, v0);
+  NullUniformUpload(sizeof(GLfloat));
+}
+
+static void glUniform1i(GLint location, GLint v0)
+{
+  NullRecordCall("glUniform1i", "ii", location, v0);
+  NullUniformUpload(sizeof(GLint));
+}
+
+static void glUniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+  NullRecordCall("glUniform2fv", "iip", location, count, value);
+  NullUniformUpload(sizeof(GLfloat) * 2 * count);
+}
+
+static void glUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+  NullRecordCall("glUniform3fv", "iip", location, count, value);
+  NullUniformUpload(sizeof(GLfloat) * 3 * count);
+}
+
+static void glUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+  NullRecordCall("glUniform4fv", "iip", location, count, value);
+  NullUniformUpload(sizeof(GLfloat) * 4 * count);
+}
+
+static void glUniformMatrix4fv(GLint location,
+                               GLsizei count,
+                               GLboolean transpose,
+                               const GLfloat* value)
+{
+  NullRecordCall("glUniformMatrix4fv",
+                 "iiup",
+                 location,
+                 count,
+                 (unsigned int)transpose,
+                 value);
+  NullUniformUpload(sizeof(GLfloat) * 16 * count);
+}
+
+/** Draws */
+
+static void glClear(GLbitfield mask)
+{
+  NullRecordCall("glClear", "b", mask);
+}
+
+static void glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+  NullRecordCall("glDrawArrays", "eii", mode, first, count);
+  NullTrace.Frame.DrawCalls++;
+}
+
+static void glDrawElements(GLenum mode,
+                           GLsizei count,
+                           GLenum type,
+                           const void* indices)
+{
+  NullRecordCall("glDrawElements", "eiep", mode, count, type, indices);
+  NullTrace.Frame.DrawCalls++;
+}
+
+static void glDrawElementsInstanced(GLenum mode,
+                                    GLsizei count,
+                                    GLenum type,
+                                    const void* indices,
+                                    GLsizei instancecount)
+{
+  NullRecordCall("glDrawElementsInstanced",
+                 "eiepi",
+                 mode,
+                 count,
+                 type,
+                 indices,
+                 instancecount);
+  NullTrace.Frame.DrawCalls++;
+}
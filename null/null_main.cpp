@@ -0,0 +1,112 @@
+#include "null_main.h"
+
+#include <chrono>
+#include <stdio.h>
+
+#include "null_gl.cpp"
+
+// The OpenGL renderer is compiled on top of the recording GL, renamed so the
+// exported RendererMain can wrap it with the frame bookkeeping
+#define RendererMain OglRendererMain
+#include "../ogl/ogl_main.cpp"
+#undef RendererMain
+
+static void NullAddStats(null_renderer_stats& target,
+                         const null_renderer_stats& source)
+{
+  target.Calls += source.Calls;
+  target.DrawCalls += source.DrawCalls;
+  target.StateChanges += source.StateChanges;
+  target.UniformUploads += source.UniformUploads;
+  target.UniformBytes += source.UniformBytes;
+  target.BytesUploaded += source.BytesUploaded;
+  target.CpuNanoseconds += source.CpuNanoseconds;
+}
+
+extern "C" RENDERER_LOAD_EXTENSIONS(RendererLoadExtensions)
+{
+  NullTrace.CallCount = 0;
+  NullTrace.DroppedCalls = 0;
+  NullTrace.StringBytes = 0;
+  NullTrace.Frames = 0;
+  NullTrace.Frame = {};
+  NullTrace.Total = {};
+
+  return HOKI_OGL_EXTENSIONS_OK;
+}
+
+extern "C" RENDERER_MAIN(RendererMain)
+{
+  NullTrace.CallCount = 0;
+  NullTrace.DroppedCalls = 0;
+  NullTrace.StringBytes = 0;
+  NullTrace.Frame = {};
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  OglRendererMain(windowInfo, context);
+  NullTrace.Frame.CpuNanoseconds =
+    (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start)
+      .count();
+
+  NullAddStats(NullTrace.Total, NullTrace.Frame);
+  NullTrace.Frames++;
+}
+
+extern "C" NULL_RENDERER_GET_TRACE(NullRendererGetTrace)
+{
+  return &NullTrace;
+}
+
+extern "C" NULL_RENDERER_FORMAT_CALL(NullRendererFormatCall)
+{
+  int length = snprintf(buffer, bufferSize, "%s(", call.Function);
+  for (size_t i = 0;
+       call.Signature[i] != '\0' && i < NULL_GL_MAX_ARGUMENTS && length >= 0;
+       i++) {
+    const null_gl_argument& argument = call.Arguments[i];
+    const char* separator = i > 0 ? ", " : "";
+    const size_t used =
+      (size_t)length < bufferSize ? (size_t)length : bufferSize;
+    char* cursor = buffer + used;
+    const size_t left = bufferSize - used;
+
+    int written = 0;
+    switch (call.Signature[i]) {
+      case 'e':
+      case 'b':
+        written = snprintf(
+          cursor, left, "%s0x%X", separator, (unsigned int)argument.Int);
+        break;
+      case 'f':
+        written = snprintf(cursor, left, "%s%g", separator, argument.Float);
+        break;
+      case 's':
+        written = snprintf(
+          cursor, left, "%s\"%s\"", separator, (const char*)argument.Pointer);
+        break;
+      case 'p':
+        written = snprintf(cursor,
+                           left,
+                           "%s0x%llX",
+                           separator,
+                           (unsigned long long)(uintptr_t)argument.Pointer);
+        break;
+      default:
+        written =
+          snprintf(cursor, left, "%s%lld", separator, (long long)argument.Int);
+        break;
+    }
+    length = written < 0 ? written : length + written;
+  }
+
+  if (length >= 0) {
+    const size_t used =
+      (size_t)length < bufferSize ? (size_t)length : bufferSize;
+    int written = snprintf(buffer + used, bufferSize - used, ")");
+    length = written < 0 ? written : length + written;
+  }
+
+  return length;
+}
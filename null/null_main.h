@@ -0,0 +1,69 @@
+#ifndef NULL_MAIN_H
+#define NULL_MAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Null renderer, runs the OpenGL renderer against a GL that only records
+ * what it is asked to do. Nothing is drawn, so it works without a display or
+ * a GPU and the trace and counters can be checked per frame.
+ */
+static const size_t NULL_GL_MAX_ARGUMENTS = 9;
+static const size_t NULL_GL_MAX_CALLS = 16384;
+static const size_t NULL_GL_MAX_STRING_BYTES = 64 * 1024;
+
+union null_gl_argument
+{
+  int64_t Int;
+  double Float;
+  const void* Pointer;
+};
+
+// Signature has a character per argument:
+// e enum, b bitfield, i int, u uint, z size, f float, p pointer, s string
+struct null_gl_call
+{
+  const char* Function;
+  const char* Signature;
+  null_gl_argument Arguments[NULL_GL_MAX_ARGUMENTS];
+};
+
+struct null_renderer_stats
+{
+  uint32_t Calls;
+  uint32_t DrawCalls;
+  uint32_t StateChanges;
+  uint32_t UniformUploads;
+  uint64_t UniformBytes;
+  uint64_t BytesUploaded;
+  uint64_t CpuNanoseconds;
+};
+
+struct null_renderer_trace
+{
+  // Calls of the last frame, the ones past NULL_GL_MAX_CALLS are only counted
+  null_gl_call Calls[NULL_GL_MAX_CALLS];
+  uint32_t CallCount;
+  uint32_t DroppedCalls;
+  // String arguments are copied, the caller's may be temporaries
+  char Strings[NULL_GL_MAX_STRING_BYTES];
+  size_t StringBytes;
+
+  uint32_t Frames;
+  null_renderer_stats Frame;
+  null_renderer_stats Total;
+
+  uint32_t NextName;
+  int32_t NextUniformLocation;
+};
+
+#define NULL_RENDERER_GET_TRACE(name) const null_renderer_trace* name()
+typedef NULL_RENDERER_GET_TRACE(null_renderer_get_trace);
+
+// Writes a call as text, returns the length like snprintf
+#define NULL_RENDERER_FORMAT_CALL(name)                                        \
+  int name(const null_gl_call& call, char* buffer, size_t bufferSize)
+typedef NULL_RENDERER_FORMAT_CALL(null_renderer_format_call);
+
+#endif // NULL_MAIN_H
@@ -20,11 +20,21 @@ static PFNGLLINKPROGRAMPROC glLinkProgram;
 static PFNGLGETPROGRAMIVPROC glGetProgramiv;
 static PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
 static PFNGLDELETESHADERPROC glDeleteShader;
+static PFNGLDELETEPROGRAMPROC glDeleteProgram;
+static PFNGLPROGRAMPARAMETERIPROC glProgramParameteri;
+static PFNGLGETPROGRAMBINARYPROC glGetProgramBinary;
+static PFNGLPROGRAMBINARYPROC glProgramBinary;
 static PFNGLGENVERTEXARRAYSPROC glGenVertexArrays;
 static PFNGLBINDVERTEXARRAYPROC glBindVertexArray;
 static PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
 static PFNGLBUFFERSUBDATAPROC glBufferSubData;
 static PFNGLDRAWELEMENTSINSTANCEDPROC glDrawElementsInstanced;
+static PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndex;
+static PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBinding;
+static PFNGLBINDBUFFERBASEPROC glBindBufferBase;
+static PFNGLBINDBUFFERRANGEPROC glBindBufferRange;
+static PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+static PFNGLUNMAPBUFFERPROC glUnmapBuffer;
 
 static PFNGLUNIFORM1FPROC glUniform1f;
 static PFNGLUNIFORM2FPROC glUniform2f;
@@ -45,11 +55,19 @@ static PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
 static PFNGLACTIVETEXTUREPROC glActiveTexture;
 static PFNGLGENERATEMIPMAPPROC glGenerateMipmap;
 static PFNGLGENFRAMEBUFFERSPROC glGenFramebuffers;
+static PFNGLDELETEFRAMEBUFFERSPROC glDeleteFramebuffers;
 static PFNGLBINDFRAMEBUFFERPROC glBindFramebuffer;
 static PFNGLFRAMEBUFFERTEXTURE2DPROC glFramebufferTexture2D;
 static PFNGLCHECKFRAMEBUFFERSTATUSPROC glCheckFramebufferStatus;
+static PFNGLBLITFRAMEBUFFERPROC glBlitFramebuffer;
 
 static PFNGLOBJECTLABELPROC glObjectLabel;
+
+// Optional, the renderer skips the GPU pass timers without them
+static PFNGLGENQUERIESPROC glGenQueries;
+static PFNGLBEGINQUERYPROC glBeginQuery;
+static PFNGLENDQUERYPROC glEndQuery;
+static PFNGLGETQUERYOBJECTUIVPROC glGetQueryObjectuiv;
 static PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVEXTPROC
   glGetFramebufferAttachmentParameteriv;
 
@@ -166,6 +184,30 @@ extern "C" RENDERER_LOAD_EXTENSIONS(RendererLoadExtensions)
     return HOKI_OGL_EXTENSIONS_FAILED;
   }
 
+  glDeleteProgram =
+    (PFNGLDELETEPROGRAMPROC)wglGetProcAddress("glDeleteProgram");
+  if (glDeleteProgram == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glProgramParameteri =
+    (PFNGLPROGRAMPARAMETERIPROC)wglGetProcAddress("glProgramParameteri");
+  if (glProgramParameteri == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glGetProgramBinary =
+    (PFNGLGETPROGRAMBINARYPROC)wglGetProcAddress("glGetProgramBinary");
+  if (glGetProgramBinary == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glProgramBinary =
+    (PFNGLPROGRAMBINARYPROC)wglGetProcAddress("glProgramBinary");
+  if (glProgramBinary == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
   glDeleteShader = (PFNGLDELETESHADERPROC)wglGetProcAddress("glDeleteShader");
   if (glDeleteShader == NULL) {
     return HOKI_OGL_EXTENSIONS_FAILED;
@@ -201,6 +243,41 @@ extern "C" RENDERER_LOAD_EXTENSIONS(RendererLoadExtensions)
     return HOKI_OGL_EXTENSIONS_FAILED;
   }
 
+  glGetUniformBlockIndex = (PFNGLGETUNIFORMBLOCKINDEXPROC)wglGetProcAddress(
+    "glGetUniformBlockIndex");
+  if (glGetUniformBlockIndex == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glUniformBlockBinding = (PFNGLUNIFORMBLOCKBINDINGPROC)wglGetProcAddress(
+    "glUniformBlockBinding");
+  if (glUniformBlockBinding == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glBindBufferBase =
+    (PFNGLBINDBUFFERBASEPROC)wglGetProcAddress("glBindBufferBase");
+  if (glBindBufferBase == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glBindBufferRange =
+    (PFNGLBINDBUFFERRANGEPROC)wglGetProcAddress("glBindBufferRange");
+  if (glBindBufferRange == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glMapBufferRange =
+    (PFNGLMAPBUFFERRANGEPROC)wglGetProcAddress("glMapBufferRange");
+  if (glMapBufferRange == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
+  glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)wglGetProcAddress("glUnmapBuffer");
+  if (glUnmapBuffer == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
   glUniform1f = (PFNGLUNIFORM1FPROC)wglGetProcAddress("glUniform1f");
   if (glUniform1f == NULL) {
     return HOKI_OGL_EXTENSIONS_FAILED;
@@ -296,6 +373,12 @@ extern "C" RENDERER_LOAD_EXTENSIONS(RendererLoadExtensions)
     return HOKI_OGL_EXTENSIONS_FAILED;
   }
 
+  glDeleteFramebuffers =
+    (PFNGLDELETEFRAMEBUFFERSPROC)wglGetProcAddress("glDeleteFramebuffers");
+  if (glDeleteFramebuffers == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
   glBindFramebuffer =
     (PFNGLBINDFRAMEBUFFEREXTPROC)wglGetProcAddress("glBindFramebuffer");
   if (glBindFramebuffer == NULL) {
@@ -315,10 +398,22 @@ extern "C" RENDERER_LOAD_EXTENSIONS(RendererLoadExtensions)
     return HOKI_OGL_EXTENSIONS_FAILED;
   }
 
+  glBlitFramebuffer =
+    (PFNGLBLITFRAMEBUFFERPROC)wglGetProcAddress("glBlitFramebuffer");
+  if (glBlitFramebuffer == NULL) {
+    return HOKI_OGL_EXTENSIONS_FAILED;
+  }
+
   glObjectLabel = (PFNGLOBJECTLABELPROC)wglGetProcAddress("glObjectLabel");
   if (glObjectLabel == NULL) {
     return HOKI_OGL_EXTENSIONS_FAILED;
   }
 
+  glGenQueries = (PFNGLGENQUERIESPROC)wglGetProcAddress("glGenQueries");
+  glBeginQuery = (PFNGLBEGINQUERYPROC)wglGetProcAddress("glBeginQuery");
+  glEndQuery = (PFNGLENDQUERYPROC)wglGetProcAddress("glEndQuery");
+  glGetQueryObjectuiv =
+    (PFNGLGETQUERYOBJECTUIVPROC)wglGetProcAddress("glGetQueryObjectuiv");
+
   return HOKI_OGL_EXTENSIONS_OK;
 }
\ No newline at end of file
@@ -1,66 +1,151 @@
 
-static void SetupUIContext(UISystem::ui_context& uiContext,
-                           game_window_info& windowInfo,
-                           render_context& renderContext)
+/** Atlas */
+static bool IsUIAtlasImage(const Asset::texture& texture)
 {
-  static const float size = 1.0f;
+  return texture.Type == Asset::TEXTURE_TYPE_IMAGE &&
+         texture.Image->Memory != nullptr && texture.Image->Components == 4;
+}
 
-  float scale, width, height;
-  if (windowInfo.Height > windowInfo.Width) { // portrait
-    scale = (float)windowInfo.Width / windowInfo.Height;
-    width = size;
-    height = size * scale;
-  } else {
-    scale = (float)windowInfo.Height / windowInfo.Width;
-    width = size * scale;
-    height = size;
-  }
-  uiContext.AspectScale = _v2(width, height);
-  uiContext.ViewProjection = orthographic_matrix(
-    0.0f, size, -uiContext.TopMargin, size - uiContext.TopMargin, -size, size);
+static const Asset::image_texture& GetUIImage(
+  const render_residency& residency,
+  const uint32_t handle)
+{
+  return *((const Asset::texture*)residency.Resources[handle].Data)->Image;
 }
 
-// Different texture coords
-static uint32_t BindUIRect(render_context& context)
+// Returns the resident id of the sprite
+static uint32_t AddUISprite(render_context& context,
+                            const uint32_t textureId,
+                            const v2 uvMin,
+                            const v2 uvMax)
 {
-  if (context.UIRectPrimitive != HOKI_OGL_NO_ID) {
-    return context.UIRectPrimitive;
-  }
+  HOKI_ASSERT(context.UISpriteCount < MAX_UI_SPRITES);
+  ui_sprite& sprite = context.UISprites[context.UISpriteCount++];
+  sprite.TextureId = textureId;
+  sprite.UvMin = uvMin;
+  sprite.UvMax = uvMax;
 
-  GLuint VBO, VAO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
+  return context.UISpriteCount;
+}
 
-  glBindVertexArray(VAO);
+static uint32_t CreateUIAtlasTexture(const uint32_t height)
+{
+  GLuint textureId;
+  glGenTextures(1, &textureId);
+  glBindTexture(GL_TEXTURE_2D, textureId);
+#if HOKI_DEV && !GL_ES_VERSION_3_0
+  glObjectLabel(GL_TEXTURE, textureId, -1, "ui_atlas");
+#endif
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               UI_ATLAS_WIDTH,
+               height,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               nullptr);
 
-  const GLfloat vertices[6][4] = { { 0.0f, 0.0f, 0.0, 0.0 },
-                                   { 0.0f, 1.0f, 0.0, 1.0 },
-                                   { 1.0f, 0.0f, 0.5, 0.0 },
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-                                   { 0.0f, 1.0f, 0.0, 1.0 },
-                                   { 1.0f, 0.0f, 0.5, 0.0 },
-                                   { 1.0f, 1.0f, 0.5, 1.0 } };
+  return textureId;
+}
 
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
+/**
+ * Packs the UI images registered so far on shelves, tallest first, into an
+ * atlas only as tall as they need. Images that are not RGBA, do not fit or are
+ * registered later keep a texture of their own.
+ */
+static void BuildUIAtlas(render_context& context)
+{
+  const render_residency& residency = *context.Residency;
+
+  uint32_t handles[MAX_UI_SPRITES];
+  uint32_t handleCount = 0;
+  for (uint32_t handle = 1; handle <= residency.HandleCount; handle++) {
+    const render_resource& resource = residency.Resources[handle];
+    if (resource.Type != RENDER_RESOURCE_UI_TEXTURE ||
+        residency.Ids[handle] != HOKI_OGL_NO_ID ||
+        !IsUIAtlasImage(*(const Asset::texture*)resource.Data) ||
+        handleCount == MAX_UI_SPRITES) {
+      continue;
+    }
 
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 4, 0);
+    const float height = GetUIImage(residency, handle).PixelSize.Y;
+    uint32_t i = handleCount++;
+    while (i > 0 &&
+           GetUIImage(residency, handles[i - 1]).PixelSize.Y < height) {
+      handles[i] = handles[i - 1];
+      i--;
+    }
+    handles[i] = handle;
+  }
 
-  // vertex texture coords
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1,
-                        2,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(GLfloat) * 4,
-                        (void*)(sizeof(GLfloat) * 2));
+  uint32_t positionsX[MAX_UI_SPRITES];
+  uint32_t positionsY[MAX_UI_SPRITES];
+  uint32_t packedCount = 0;
+  uint32_t shelfY = 0;
+  uint32_t shelfHeight = 0;
+  uint32_t cursorX = 0;
+  uint32_t atlasHeight = 0;
+  for (uint32_t i = 0; i < handleCount; i++) {
+    const Asset::image_texture& image = GetUIImage(residency, handles[i]);
+    const uint32_t width = (uint32_t)image.PixelSize.X;
+    const uint32_t height = (uint32_t)image.PixelSize.Y;
+    if (cursorX + width > UI_ATLAS_WIDTH) {
+      shelfY += shelfHeight + UI_ATLAS_PADDING;
+      shelfHeight = 0;
+      cursorX = 0;
+    }
+    if (width > UI_ATLAS_WIDTH || shelfY + height > UI_ATLAS_MAX_HEIGHT) {
+      break;
+    }
+
+    positionsX[i] = cursorX;
+    positionsY[i] = shelfY;
+    packedCount++;
+    cursorX += width + UI_ATLAS_PADDING;
+    shelfHeight = std::max(shelfHeight, height);
+    atlasHeight = std::max(atlasHeight, shelfY + height);
+  }
+
+  if (packedCount == 0) {
+    return;
+  }
 
-  context.UIRectPrimitive = VAO;
-  return context.UIRectPrimitive;
+  context.UIAtlasTextureId = CreateUIAtlasTexture(atlasHeight);
+  const v2 atlasSize = _v2((float)UI_ATLAS_WIDTH, (float)atlasHeight);
+  for (uint32_t i = 0; i < packedCount; i++) {
+    const Asset::image_texture& image = GetUIImage(residency, handles[i]);
+    const size_t size =
+      (size_t)image.PixelSize.X * image.PixelSize.Y * image.Components;
+    glTexSubImage2D(
+      GL_TEXTURE_2D,
+      0,
+      positionsX[i],
+      positionsY[i],
+      (int)image.PixelSize.X,
+      (int)image.PixelSize.Y,
+      GL_RGBA,
+      GL_UNSIGNED_BYTE,
+      StagePixels(context, image.Memory, size, GetImageBufferBytes(image)));
+    EndStagePixels();
+
+    const v2 position = _v2((float)positionsX[i], (float)positionsY[i]);
+    const v2 end = position + image.PixelSize;
+    const v2 uvMin = _v2(position.X / atlasSize.X, position.Y / atlasSize.Y);
+    const v2 uvMax = _v2(end.X / atlasSize.X, end.Y / atlasSize.Y);
+    context.Residency->Ids[handles[i]] =
+      AddUISprite(context, context.UIAtlasTextureId, uvMin, uvMax);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-static uint32_t BindUITexture(const Asset::texture& texture)
+static uint32_t BindUITexture(render_context& context,
+                              const Asset::texture& texture)
 {
   uint32_t texobj;
 
@@ -71,83 +156,172 @@ static uint32_t BindUITexture(const Asset::texture& texture)
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  HOKI_ASSERT(texture.Type != Asset::TEXTURE_TYPE_INVALID);
-  if (texture.Type == Asset::TEXTURE_TYPE_DDS) {
-    const Asset::DDS_Image& image = *texture.DDSImage;
-    Asset::DDS_Surface surface = (Asset::DDS_Surface)image.Surfaces[0];
-    glCompressedTexImage2D(GL_TEXTURE_2D,
-                           0,
-                           image.Format,
-                           surface.Width,
-                           surface.Height,
-                           0,
-                           surface.Size,
-                           surface.Pixels);
-
-    for (uint32_t i = 0; i < image.SurfaceCount; i++) {
-      Asset::DDS_Surface mipmapSurface = image.Surfaces[i + 1];
-
-      glCompressedTexImage2D(GL_TEXTURE_2D,
-                             i + 1,
-                             image.Format,
-                             mipmapSurface.Width,
-                             mipmapSurface.Height,
-                             0,
-                             mipmapSurface.Size,
-                             mipmapSurface.Pixels);
-    }
-  } else if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
-    const Asset::image_texture& image = *texture.Image;
 #if HOKI_DEV && !GL_ES_VERSION_3_0
+  if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
     // apply the name, -1 means NULL terminated
-    glObjectLabel(GL_TEXTURE, texobj, -1, image.Path.Value);
-#endif
-    int nrComponents = image.Components;
-    if (image.Memory) {
-      GLenum format = GL_RED;
-      if (nrComponents == 1) {
-        format = GL_RED;
-      } else if (nrComponents == 3) {
-        format = GL_RGB;
-      } else if (nrComponents == 4) {
-        format = GL_RGBA;
-      }
-
-      glTexImage2D(GL_TEXTURE_2D,
-                   0,
-                   format,
-                   (int)image.PixelSize.X,
-                   (int)image.PixelSize.Y,
-                   0,
-                   format,
-                   GL_UNSIGNED_BYTE,
-                   image.Memory);
-      glGenerateMipmap(GL_TEXTURE_2D);
-    }
+    glObjectLabel(GL_TEXTURE, texobj, -1, texture.Image->Path.Value);
   }
+#endif
+  UploadTextureData(context, texture);
   glBindTexture(GL_TEXTURE_2D, 0);
 
   return texobj;
 }
 
+static const ui_sprite& GetUISprite(render_context& context,
+                                    const Asset::texture& texture)
+{
+  static const ui_sprite noSprite = {};
+  if (texture.RenderHandle == RENDER_NO_HANDLE) {
+    return noSprite;
+  }
+
+  uint32_t& spriteId = GetResidentId(context, texture.RenderHandle);
+  if (spriteId == HOKI_OGL_NO_ID &&
+      context.UIAtlasTextureId == HOKI_OGL_NO_ID) {
+    BuildUIAtlas(context);
+  }
+  if (spriteId == HOKI_OGL_NO_ID) {
+    spriteId = AddUISprite(
+      context, BindUITexture(context, texture), _v2(0.0f), _v2(1.0f));
+  }
+
+  return context.UISprites[spriteId - 1];
+}
+
+/** Batch */
+static void BindUIVertexArray(render_context& context)
+{
+  if (context.UIVertexArray != HOKI_OGL_NO_ID) {
+    glBindVertexArray(context.UIVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, context.UIVertexBuffer);
+    return;
+  }
+
+  glGenVertexArrays(1, &context.UIVertexArray);
+  glGenBuffers(1, &context.UIVertexBuffer);
+  glBindVertexArray(context.UIVertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, context.UIVertexBuffer);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,
+                        2,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(ui_vertex),
+                        (void*)offsetof(ui_vertex, Position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,
+                        2,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(ui_vertex),
+                        (void*)offsetof(ui_vertex, TexCoords));
+}
+
+// Quads are already in UI space, the model matrix stays identity
+static void FlushUIBatch(render_context& context)
+{
+  if (context.UIVertexCount == 0) {
+    return;
+  }
+
+  SetUniform(context.UIShader.ModelMatrix, &IDENTITY_MATRIX, 1);
+  SetUniform(context.UIShader.ViewProjection,
+             &context.UIBatchContext->ViewProjection,
+             1);
+  BindUIVertexArray(context);
+  glBindTexture(GL_TEXTURE_2D, context.UIBatchTexture);
+
+  glBufferData(GL_ARRAY_BUFFER,
+               sizeof(ui_vertex) * context.UIVertexCount,
+               context.UIVertices,
+               GL_STREAM_DRAW);
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei)context.UIVertexCount);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  context.UIVertexCount = 0;
+}
+
+/**
+ * Appends a BindRect quad moved by modelMatrix. The texture coordinates are
+ * scaled and offset inside the sprite, a scale of 0.5 picks one half of a two
+ * state image.
+ */
+static void PushUIQuad(render_context& context,
+                       const UISystem::ui_context* uiContext,
+                       const ui_sprite& sprite,
+                       const mat4x4& modelMatrix,
+                       const v2 uvScale,
+                       const v2 uvOffset)
+{
+  if (sprite.TextureId == HOKI_OGL_NO_ID) {
+    return;
+  }
+
+  const size_t maxVertexCount =
+    sizeof(context.UIVertices) / sizeof(context.UIVertices[0]);
+  if (context.UIBatchTexture != sprite.TextureId ||
+      context.UIBatchContext != uiContext ||
+      context.UIVertexCount + 6 > maxVertexCount) {
+    FlushUIBatch(context);
+    context.UIBatchTexture = sprite.TextureId;
+    context.UIBatchContext = uiContext;
+  }
+
+  const v2 uvSize = sprite.UvMax - sprite.UvMin;
+  for (int i = 0; i < 6; i++) {
+    const v4 position = modelMatrix * _v4(RECT_CORNERS[i].X,
+                                          RECT_CORNERS[i].Y,
+                                          0.0f,
+                                          1.0f);
+    const v2 uv = hadamard_multiply(RECT_CORNERS[i], uvScale) + uvOffset;
+
+    ui_vertex& vertex = context.UIVertices[context.UIVertexCount++];
+    vertex.Position = _v2(position.X, position.Y);
+    vertex.TexCoords = sprite.UvMin + hadamard_multiply(uv, uvSize);
+  }
+}
+
+static void SetupUIContext(UISystem::ui_context& uiContext,
+                           game_window_info& windowInfo,
+                           render_context& renderContext)
+{
+  // Quads batched so far use the previous projection
+  FlushUIBatch(renderContext);
+
+  static const float size = 1.0f;
+
+  float scale, width, height;
+  if (windowInfo.Height > windowInfo.Width) { // portrait
+    scale = (float)windowInfo.Width / windowInfo.Height;
+    width = size;
+    height = size * scale;
+  } else {
+    scale = (float)windowInfo.Height / windowInfo.Width;
+    width = size * scale;
+    height = size;
+  }
+  uiContext.AspectScale = _v2(width, height);
+  uiContext.ViewProjection = orthographic_matrix(
+    0.0f, size, -uiContext.TopMargin, size - uiContext.TopMargin, -size, size);
+}
+
+// Two state images, the second half is the hot or on state
+const v2 UI_HALF_IMAGE = _v2(0.5f, 1.0f);
+
 static void RenderButton(const UISystem::ui_button& button,
-                         render_context context)
+                         render_context& context)
 {
   UISystem::ui_context& uiContext = *button.Context;
 
-  renderable* image =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)button.Image);
-  if (image->RenderId == HOKI_OGL_NO_ID) {
-    image->RenderId = BindUITexture(*button.Image);
-  }
+  const ui_sprite& sprite = GetUISprite(context, *button.Image);
 
   mat4x4 modelMatrix = IDENTITY_MATRIX *
                        mat4x4_translate(_v3(button.Position, 0.0f)) *
                        mat4x4_scale(_v3(button.Size, 0.0f));
 
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-  SetUniform(context.UIShader.ViewProjection, &uiContext.ViewProjection, 1);
-
   v2 offset = _v2(0.0f);
 
   v3 objectColor = _v3(1.0f);
@@ -162,63 +336,33 @@ static void RenderButton(const UISystem::ui_button& button,
     objectColor = _v3(0.0f, 0.0f, 1.0f);
   }
 
-  SetUniform(context.UIShader.TextureCoordOffset, &offset, 1);
-  SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
   // SetUniform(context.UIShader.ObjectColor, &objectColor, 1);
-  glBindVertexArray(BindUIRect(context));
-  glBindTexture(GL_TEXTURE_2D, image->RenderId);
-
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  PushUIQuad(
+    context, button.Context, sprite, modelMatrix, UI_HALF_IMAGE, offset);
 }
 
 static void RenderToggle(const UISystem::ui_toggle& toggle,
-                         render_context context)
+                         render_context& context)
 {
   UISystem::ui_context& uiContext = *toggle.Context;
 
-  renderable* image =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)toggle.Image);
-  if (image->RenderId == HOKI_OGL_NO_ID) {
-    image->RenderId = BindUITexture(*toggle.Image);
-  }
+  const ui_sprite& sprite = GetUISprite(context, *toggle.Image);
 
   mat4x4 modelMatrix = IDENTITY_MATRIX *
                        mat4x4_translate(_v3(toggle.Position, 0.0f)) *
                        mat4x4_scale(_v3(toggle.Size, 0.0f));
 
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-  SetUniform(context.UIShader.ViewProjection, &uiContext.ViewProjection, 1);
-
   v2 offset = _v2(0.0f);
   if (uiContext.HotId == toggle.Id || *toggle.On) {
     offset.X = 0.5f;
   }
-  SetUniform(context.UIShader.TextureCoordOffset, &offset, 1);
-  SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
-  // SetUniform(context.UIShader.ObjectColor, &objectColor, 1);
-  glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(BindUIRect(context));
-  glBindTexture(GL_TEXTURE_2D, image->RenderId);
-
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  PushUIQuad(
+    context, toggle.Context, sprite, modelMatrix, UI_HALF_IMAGE, offset);
 }
 
 static void RenderIcon(const UISystem::ui_icon& icon, render_context& context)
 {
-  UISystem::ui_context uiContext = *icon.Context;
-
-  renderable* image =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)icon.Image);
-
-  if (image->RenderId == HOKI_OGL_NO_ID) {
-    image->RenderId = BindUITexture(*icon.Image);
-  }
+  const ui_sprite& sprite = GetUISprite(context, *icon.Image);
 
   v2 offset = hadamard_multiply(icon.Size, icon.Origin);
   v3 position = _v3(icon.Position - offset, 0.0f);
@@ -226,52 +370,26 @@ static void RenderIcon(const UISystem::ui_icon& icon, render_context& context)
                        mat4x4_scale(_v3(icon.Size, 0.0f)) *
                        mat4x4_rotate(_v3(0.0f, 0.0f, icon.Angle));
 
-  v2 noOffset = _v2(0.0f);
-  SetUniform(context.UIShader.TextureCoordOffset, &noOffset, 1);
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-  SetUniform(context.UIShader.ViewProjection, &uiContext.ViewProjection, 1);
-
-  SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
-
-  glBindVertexArray(BindRect(context));
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, image->RenderId);
-
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  PushUIQuad(context, icon.Context, sprite, modelMatrix, _v2(1.0f), V2_ZERO);
 }
 
 static void RenderJoystick(const UISystem::ui_joystick& joystick,
-                           render_context context)
+                           render_context& context)
 {
   UISystem::ui_context& uiContext = *joystick.Context;
 
-  renderable* handle =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)joystick.Handle);
-  renderable* background =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)joystick.Background);
-
-  if (handle->RenderId == HOKI_OGL_NO_ID) {
-    handle->RenderId = BindUITexture(*joystick.Handle);
-    background->RenderId = BindUITexture(*joystick.Background);
-  }
+  const ui_sprite& handle = GetUISprite(context, *joystick.Handle);
+  const ui_sprite& background = GetUISprite(context, *joystick.Background);
 
   mat4x4 modelMatrix = IDENTITY_MATRIX *
                        mat4x4_translate(_v3(joystick.Position, 0.0f)) *
                        mat4x4_scale(_v3(joystick.BackgroundSize, 0.0f));
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-  SetUniform(context.UIShader.ViewProjection, &uiContext.ViewProjection, 1);
-
-  SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
-
-  SetUniform(context.UIShader.TextureCoordOffset, &V2_ZERO, 1);
-
-  glBindVertexArray(BindUIRect(context));
-  glBindTexture(GL_TEXTURE_2D, background->RenderId);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+  PushUIQuad(context,
+             joystick.Context,
+             background,
+             modelMatrix,
+             UI_HALF_IMAGE,
+             V2_ZERO);
 
   float angle = (float)rad_to_deg(
     atan2(joystick.ControlPosition->X, -joystick.ControlPosition->Y));
@@ -283,7 +401,6 @@ static void RenderJoystick(const UISystem::ui_joystick& joystick,
   if (uiContext.HotId == joystick.Id && joystickOverDeadzone) {
     offset.X = 0.5f;
   }
-  SetUniform(context.UIShader.TextureCoordOffset, &offset, 1);
 
   v2 centerForRotation = _v2(-0.5f);
   modelMatrix = IDENTITY_MATRIX *
@@ -295,48 +412,28 @@ static void RenderJoystick(const UISystem::ui_joystick& joystick,
                 mat4x4_translate(_v3(-centerForRotation, 0.0f)) *
                 mat4x4_rotate(_v3(0.0f, 0.0f, angle)) *
                 mat4x4_translate(_v3(centerForRotation, 0.0f));
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-
-  glBindTexture(GL_TEXTURE_2D, handle->RenderId);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  PushUIQuad(
+    context, joystick.Context, handle, modelMatrix, UI_HALF_IMAGE, offset);
 }
 
 static void RenderSlider(const UISystem::ui_slider& slider,
-                         render_context context)
+                         render_context& context)
 {
   UISystem::ui_context& uiContext = *slider.Context;
 
-  renderable* handle =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)slider.Handle);
-  renderable* background =
-    (renderable*)get(*context.RenderableStore, (uintptr_t)slider.Background);
-
-  if (handle->RenderId == HOKI_OGL_NO_ID) {
-    handle->RenderId = BindUITexture(*slider.Handle);
-    background->RenderId = BindUITexture(*slider.Background);
-  }
+  const ui_sprite& handle = GetUISprite(context, *slider.Handle);
+  const ui_sprite& background = GetUISprite(context, *slider.Background);
 
   mat4x4 modelMatrix = IDENTITY_MATRIX *
                        mat4x4_translate(_v3(slider.Position, 0.0f)) *
                        mat4x4_scale(_v3(slider.BackgroundSize, 0.0f));
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-  SetUniform(context.UIShader.ViewProjection, &uiContext.ViewProjection, 1);
-
-  SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
-  SetUniform(context.UIShader.TextureCoordOffset, &V2_ZERO, 1);
-
-  glBindVertexArray(BindRect(context));
-  glBindTexture(GL_TEXTURE_2D, background->RenderId);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+  PushUIQuad(
+    context, slider.Context, background, modelMatrix, _v2(1.0f), V2_ZERO);
 
   v2 offset = _v2(0.0f);
   if (uiContext.HotId == slider.Id) {
     offset.X = 0.5f;
   }
-  SetUniform(context.UIShader.TextureCoordOffset, &offset, 1);
 
   float valPercent = (*slider.Value + slider.Min) / slider.Max;
   v3 position = _v3(slider.Position.X - (slider.HandleSize.X * 0.5f) +
@@ -346,12 +443,6 @@ static void RenderSlider(const UISystem::ui_slider& slider,
 
   modelMatrix = IDENTITY_MATRIX * mat4x4_translate(position) *
                 mat4x4_scale(_v3(slider.HandleSize, 0.0f));
-  SetUniform(context.UIShader.ModelMatrix, &modelMatrix, 1);
-
-  glBindVertexArray(BindUIRect(context));
-  glBindTexture(GL_TEXTURE_2D, handle->RenderId);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  PushUIQuad(
+    context, slider.Context, handle, modelMatrix, UI_HALF_IMAGE, offset);
 }
@@ -1,6 +1,7 @@
 #include "ogl_main.h"
 
-#ifdef _WIN32
+// A GLES context or the null renderer's GL is already declared otherwise
+#if defined(_WIN32) && !defined(GL_ES_VERSION_3_0)
 #include <Windows.h>
 
 #include <gl/gl.h>
@@ -9,6 +10,16 @@
 #include "ogl_extensions.cpp"
 #endif
 
+// Timer queries are core on desktop, GLES has them with
+// EXT_disjoint_timer_query
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+#include <algorithm>
 #include <map>
 
 #include "../game/debug/debug_log.h"
@@ -34,15 +45,25 @@
 #include "ogl_text.cpp"
 #include "ogl_physics.cpp"
 
-static const float NEAR_PLANE = 0.1f;
-static const float FAR_PLANE = 160.0f;
+static const float NEAR_PLANE = CAMERA_NEAR_PLANE;
+static const float FAR_PLANE = CAMERA_FAR_PLANE;
+// Where the first shadow cascade ends and the last one
 static const float SHADOW_MAP_SPLIT_DEPTH = 15.0f;
-
-const unsigned int SHADOW_MAP_SIZE = 512;
-static const float FOV = 90.0f;
+static const float SHADOW_DISTANCE = 60.0f;
+// How far towards the light casters outside a cascade still reach into it
+static const float SHADOW_CASTER_DEPTH = 20.0f;
+// Frames between updates of the far cascade
+static const uint32_t SHADOW_FAR_CASCADE_INTERVAL = 2;
+// Static caster tiles reach this fraction of a cascade past it on each side,
+// the cascade can move that far before they are redrawn
+static const uint32_t SHADOW_STATIC_GUARD_DIVISOR = 8;
+// Fraction of a cascade's radius added to both ends of its depth range
+static const float SHADOW_DEPTH_GUARD = 0.25f;
+static const float FOV = CAMERA_FOV;
 static float ASPECT_RATIO = 1.0f;
 
-static uint32_t BindTexture(const Asset::texture& texture)
+static uint32_t BindTexture(render_context& context,
+                            const Asset::texture& texture)
 {
   uint32_t texobj;
 
@@ -69,60 +90,53 @@ static uint32_t BindTexture(const Asset::texture& texture)
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  HOKI_ASSERT(texture.Type != Asset::TEXTURE_TYPE_INVALID);
-  if (texture.Type == Asset::TEXTURE_TYPE_DDS) {
-    const Asset::DDS_Image& image = *texture.DDSImage;
-    Asset::DDS_Surface surface = (Asset::DDS_Surface)image.Surfaces[0];
-    glCompressedTexImage2D(GL_TEXTURE_2D,
-                           0,
-                           image.Format,
-                           surface.Width,
-                           surface.Height,
-                           0,
-                           surface.Size,
-                           surface.Pixels);
-
-    for (uint32_t i = 0; i < image.SurfaceCount; i++) {
-      Asset::DDS_Surface mipmapSurface = image.Surfaces[i + 1];
-
-      glCompressedTexImage2D(GL_TEXTURE_2D,
-                             i + 1,
-                             image.Format,
-                             mipmapSurface.Width,
-                             mipmapSurface.Height,
-                             0,
-                             mipmapSurface.Size,
-                             mipmapSurface.Pixels);
-    }
-  } else if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
-    const Asset::image_texture& image = *texture.Image;
 #if HOKI_DEV && !GL_ES_VERSION_3_0
+  if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
     // apply the name, -1 means NULL terminated
     glObjectLabel(GL_TEXTURE, texobj, -1, texture.Name.Value);
+  }
 #endif
-    int nrComponents = image.Components;
-    if (image.Memory) {
-      GLenum format = GL_RED;
-      if (nrComponents == 1) {
-        format = GL_RED;
-      } else if (nrComponents == 3) {
-        format = GL_RGB;
-      } else if (nrComponents == 4) {
-        format = GL_RGBA;
-      }
+  UploadTextureData(context, texture);
+  glBindTexture(GL_TEXTURE_2D, 0);
 
-      glTexImage2D(GL_TEXTURE_2D,
-                   0,
-                   format,
-                   (int)image.PixelSize.X,
-                   (int)image.PixelSize.Y,
-                   0,
-                   format,
-                   GL_UNSIGNED_BYTE,
-                   image.Memory);
-      glGenerateMipmap(GL_TEXTURE_2D);
-    }
-  }
+  return texobj;
+}
+
+static size_t GetBakedAnimationBytes(
+  const AnimationSystem::baked_animation& bakedAnimation)
+{
+  return (size_t)bakedAnimation.FrameCount * bakedAnimation.BoneCount *
+         sizeof(mat4x4);
+}
+
+static uint32_t BindBakedAnimation(
+  render_context& context,
+  const AnimationSystem::baked_animation& bakedAnimation)
+{
+  uint32_t texobj;
+
+  glGenTextures(1, &texobj);
+  glBindTexture(GL_TEXTURE_2D, texobj);
+
+  // Float textures are not filterable everywhere, frames are blended in the
+  // vertex shader instead
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  // One row per frame, one texel per matrix column
+  const size_t size = GetBakedAnimationBytes(bakedAnimation);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA32F,
+               (GLsizei)(bakedAnimation.BoneCount * 4),
+               (GLsizei)bakedAnimation.FrameCount,
+               0,
+               GL_RGBA,
+               GL_FLOAT,
+               StagePixels(context, bakedAnimation.Frames, size, size));
+  EndStagePixels();
   glBindTexture(GL_TEXTURE_2D, 0);
 
   return texobj;
@@ -147,8 +161,8 @@ static uint32_t BindModel(const Asset::model& model)
   // load data into vertex buffers
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER,
-               model.VertexCount * sizeof(model.Vertices[0]),
-               model.Vertices,
+               model.VertexCount * model.VertexStride,
+               model.PackedVertices,
                GL_STATIC_DRAW);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
@@ -157,126 +171,299 @@ static uint32_t BindModel(const Asset::model& model)
                model.Indices,
                GL_STATIC_DRAW);
 
-  // set the vertex attribute pointers
+  // set the vertex attribute pointers, see Asset::packed_vertex
+  const GLsizei stride = (GLsizei)model.VertexStride;
   // vertex Positions
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(0,
                         sizeof(v3) / sizeof(float),
                         GL_FLOAT,
                         GL_FALSE,
-                        sizeof(Asset::primitive_data),
-                        (void*)0);
+                        stride,
+                        (void*)offsetof(Asset::packed_vertex, Position));
 
   // vertex texture coords
   glEnableVertexAttribArray(1);
   glVertexAttribPointer(1,
-                        sizeof(v2) / sizeof(float),
-                        GL_FLOAT,
+                        2,
+                        GL_HALF_FLOAT,
                         GL_FALSE,
-                        sizeof(Asset::primitive_data),
-                        (void*)offsetof(Asset::primitive_data, TextureCoord));
+                        stride,
+                        (void*)offsetof(Asset::packed_vertex, TextureCoord));
 
   // vertex normals
   glEnableVertexAttribArray(2);
   glVertexAttribPointer(2,
-                        sizeof(v3) / sizeof(float),
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(Asset::primitive_data),
-                        (void*)offsetof(Asset::primitive_data, Normal));
+                        4,
+                        GL_INT_2_10_10_10_REV,
+                        GL_TRUE,
+                        stride,
+                        (void*)offsetof(Asset::packed_vertex, Normal));
 
   // vertex tangent
   glEnableVertexAttribArray(3);
   glVertexAttribPointer(3,
-                        sizeof(v3) / sizeof(float),
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(Asset::primitive_data),
-                        (void*)offsetof(Asset::primitive_data, Tangent));
-
-  // bone ids
-  glEnableVertexAttribArray(4);
-  glVertexAttribIPointer(4,
-                         Asset::MAX_BONES_PER_VERTEX,
-                         GL_UNSIGNED_SHORT,
-                         sizeof(Asset::primitive_data),
-                         (void*)offsetof(Asset::primitive_data, BoneIds));
-
-  // bone weights
-  glEnableVertexAttribArray(5);
-  glVertexAttribPointer(5,
-                        Asset::MAX_BONES_PER_VERTEX,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(Asset::primitive_data),
-                        (void*)offsetof(Asset::primitive_data, BoneWeights));
+                        4,
+                        GL_INT_2_10_10_10_REV,
+                        GL_TRUE,
+                        stride,
+                        (void*)offsetof(Asset::packed_vertex, Tangent));
+
+  // Static models have no bones, shaders only read them when skinning
+  if (model.VertexLayout == Asset::VERTEX_LAYOUT_SKINNED) {
+    // bone ids
+    glEnableVertexAttribArray(4);
+    glVertexAttribIPointer(4,
+                           Asset::MAX_BONES_PER_VERTEX,
+                           GL_UNSIGNED_BYTE,
+                           stride,
+                           (void*)offsetof(Asset::packed_vertex, BoneIds));
+
+    // bone weights
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5,
+                          Asset::MAX_BONES_PER_VERTEX,
+                          GL_UNSIGNED_BYTE,
+                          GL_TRUE,
+                          stride,
+                          (void*)offsetof(Asset::packed_vertex, BoneWeights));
+  }
 
   glBindVertexArray(0);
 
   return VAO;
 }
 
-static render_command* GetNextCommand(render_command_buffer& buffer, size_t i)
+static uint32_t GetModelRenderId(render_context& context,
+                                 const Asset::model& model)
 {
-  if (i >= buffer.Count) {
-    return nullptr;
+  uint32_t& modelId = GetResidentId(context, model.RenderHandle);
+  if (modelId == HOKI_OGL_NO_ID) {
+    modelId = BindModel(model);
+    InvalidateBoundState(context);
   }
-  return buffer.Commands + i;
+
+  return modelId;
 }
 
-static void RenderEntity(const game_entity& entity,
-                         render_context& context,
-                         const ogl_skinned_shader& shader,
-                         const bool translucentPass)
+static int32_t GetTextureRenderId(render_context& context,
+                                  const texture* const texture)
 {
+  if (texture == nullptr || texture->RenderHandle == RENDER_NO_HANDLE) {
+    return HOKI_OGL_INVALID_ID;
+  }
+
+  uint32_t& textureId = GetResidentId(context, texture->RenderHandle);
+  if (textureId == HOKI_OGL_NO_ID) {
+    textureId = BindTexture(context, *texture);
+    InvalidateBoundState(context);
+  }
 
-  renderable* model = (renderable*)get(*context.RenderableStore, entity.Model);
-  if (model->RenderId == HOKI_OGL_NO_ID) {
-    model->RenderId = BindModel(*entity.Model);
+  return (int32_t)textureId;
+}
+
+static uint32_t GetBakedPoseRenderId(
+  render_context& context,
+  const AnimationSystem::baked_animation& baked)
+{
+  if (baked.RenderHandle == RENDER_NO_HANDLE) {
+    return HOKI_OGL_NO_ID;
   }
 
-  if (entity.BoneCount > 0) {
-    SetUniform(shader.Bones, entity.BoneTransforms, entity.BoneCount);
+  uint32_t& poseId = GetResidentId(context, baked.RenderHandle);
+  if (poseId == HOKI_OGL_NO_ID) {
+    poseId = BindBakedAnimation(context, baked);
+    InvalidateBoundState(context);
   }
 
-  glBindVertexArray(model->RenderId);
-  mat4x4 viewProjection = context.ProjectionMatrix * context.ViewMatrix;
-  SetUniform(shader.ViewProjection, &viewProjection, 1);
-  SetUniform(shader.LightSpaceMatrix, &context.LightProjectionMatrix, 1);
-
-  int32_t textureIndex = 0;
-  if (context.ShadowMapNearTextureId != HOKI_OGL_NO_ID) {
-    glActiveTexture(GL_TEXTURE0 + textureIndex);
-    SetSamplerUniform(shader.ShadowMap, textureIndex);
-    glBindTexture(GL_TEXTURE_2D, context.ShadowMapNearTextureId);
-    textureIndex++;
+  return poseId;
+}
+
+/** Upload queue */
+// Nothing is on screen during load, so it takes everything it can at once
+static const size_t UPLOAD_PREWARM_BYTES = 64 * 1024 * 1024;
+static const size_t UPLOAD_FRAME_BYTES = 2 * 1024 * 1024;
+
+static size_t GetTextureBytes(const Asset::texture& texture)
+{
+  size_t result = 0;
+  if (texture.Type == Asset::TEXTURE_TYPE_DDS) {
+    for (uint32_t i = 0; i <= texture.DDSImage->SurfaceCount; i++) {
+      result += texture.DDSImage->Surfaces[i].Size;
+    }
+  } else if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
+    result = GetImageBufferBytes(*texture.Image);
   }
-  for (size_t n = 0; n < entity.Model->NodeCount; n++) {
-    Asset::model_node* nodeInfo = entity.Model->Nodes + n;
-    if (nodeInfo->Mesh == nullptr) {
+
+  return result;
+}
+
+/**
+ * Walks the registered handles that are not resident yet and creates them
+ * until the budget is spent, the first one always goes through. A draw that
+ * gets to a resource before the walk does still creates it on the spot.
+ */
+static void UploadPendingResources(render_context& context,
+                                   const size_t budget)
+{
+  render_residency& residency = *context.Residency;
+  size_t spent = 0;
+  while (spent < budget && residency.UploadCursor < residency.HandleCount) {
+    const uint32_t handle = ++residency.UploadCursor;
+    if (residency.Ids[handle] != HOKI_OGL_NO_ID) {
       continue;
     }
-    Asset::model_mesh& meshInfo = *nodeInfo->Mesh;
 
-    mat4x4 finalTransform = nodeInfo->Transform;
-    Asset::model_node* parentNode = nodeInfo->Parent;
-    while (!nodeInfo->Skinned && parentNode) {
-      if (parentNode->BoneId > -1) {
-        finalTransform =
-          entity.Bones[parentNode->BoneId].Transform * finalTransform;
-      } else {
-        finalTransform = parentNode->Transform * finalTransform;
-      }
+    const render_resource& resource = residency.Resources[handle];
+    switch (resource.Type) {
+      case RENDER_RESOURCE_TEXTURE: {
+        const texture& data = *(const texture*)resource.Data;
+        GetTextureRenderId(context, &data);
+        spent += GetTextureBytes(data);
+      } break;
+
+      case RENDER_RESOURCE_UI_TEXTURE: {
+        const texture& data = *(const texture*)resource.Data;
+        GetUISprite(context, data);
+        spent += GetTextureBytes(data);
+      } break;
+
+      case RENDER_RESOURCE_MODEL: {
+        const Asset::model& data = *(const Asset::model*)resource.Data;
+        GetModelRenderId(context, data);
+        spent += data.VertexCount * data.VertexStride +
+                 data.IndexCount * sizeof(data.Indices[0]);
+      } break;
+
+      case RENDER_RESOURCE_BAKED_POSE: {
+        const AnimationSystem::baked_animation& data =
+          *(const AnimationSystem::baked_animation*)resource.Data;
+        GetBakedPoseRenderId(context, data);
+        spent += GetBakedAnimationBytes(data);
+      } break;
 
-      parentNode = parentNode->Parent;
+      default:
+        break;
     }
+  }
+}
+
+/**
+ * Entity commands carry the transform and pose in their payload, these build
+ * a copy of the entity that points at it instead of the game's state.
+ */
+static game_entity GetCommandEntity(const render_command& command)
+{
+  const render_entity_state* state =
+    (const render_entity_state*)get_render_command_data(&command);
+
+  game_entity result = *command.Entity;
+  result.Position = state->Position;
+  result.Rotation = state->Rotation;
+  result.Scale = state->Scale;
+  result.BoneCount = state->BoneCount;
+  result.BoneTransforms = (mat4x4*)(state + 1);
+  result.NodeTransforms = result.BoneTransforms + state->BoneCount;
+
+  return result;
+}
+
+static instanced_entity GetCommandInstancedEntity(
+  const render_command& command,
+  AnimationSystem::baked_animation_run& outBakedRun)
+{
+  const render_entity_state* state =
+    (const render_entity_state*)get_render_command_data(&command);
+
+  instanced_entity result = *command.InstancedEntity;
+  result.Position = state->Position;
+  result.Rotation = state->Rotation;
+  result.Scale = state->Scale;
+  result.BoneCount = state->BoneCount;
+  result.BoneTransforms = (mat4x4*)(state + 1);
+  result.NodeTransforms = result.BoneTransforms + state->BoneCount;
+  if (result.BakedRun != nullptr) {
+    outBakedRun = *result.BakedRun;
+    outBakedRun.CurrentTime = state->BakedTime;
+    result.BakedRun = &outBakedRun;
+  }
+
+  return result;
+}
+
+// Material textures are prioritized over the entity's and the primitive's
+static void BindMaterial(render_context& context,
+                         const Asset::model_primitive& primitive,
+                         const texture* const entityTexture)
+{
+  const texture* albedoTexture = nullptr;
+  const texture* metallicTexture = nullptr;
+  const texture* roughnessTexture = nullptr;
+  if (primitive.Material != nullptr) {
+    albedoTexture = primitive.Material->AlbedoMap;
+    metallicTexture = primitive.Material->MetallicMap;
+    roughnessTexture = primitive.Material->RoughnessMap;
+  } else if (entityTexture != nullptr) {
+    albedoTexture = entityTexture;
+  } else if (primitive.Texture != nullptr) {
+    albedoTexture = primitive.Texture;
+  }
+
+  const GLint albedoMapId = GetTextureRenderId(context, albedoTexture);
+  const GLint metallicMapId = GetTextureRenderId(context, metallicTexture);
+  const GLint roughnessMapId = GetTextureRenderId(context, roughnessTexture);
+
+  // Uploads above may have rebound a unit, the cache skips this otherwise
+  if (context.ShadowMapTextureId != HOKI_OGL_NO_ID) {
+    BindTexture2D(context, TEXTURE_UNIT_SHADOW_MAP, context.ShadowMapTextureId);
+  }
+  if (albedoMapId != HOKI_OGL_INVALID_ID) {
+    BindTexture2D(context, TEXTURE_UNIT_ALBEDO_MAP, albedoMapId);
+  }
+  if (metallicMapId != HOKI_OGL_INVALID_ID) {
+    BindTexture2D(context, TEXTURE_UNIT_METALLIC_MAP, metallicMapId);
+  }
+  if (roughnessMapId != HOKI_OGL_INVALID_ID) {
+    BindTexture2D(context, TEXTURE_UNIT_ROUGHNESS_MAP, roughnessMapId);
+  }
 
-    mat4x4 modelMatrix = IDENTITY_MATRIX * mat4x4_translate(entity.Position) *
-                         quat_to_mat4x4(entity.Rotation) *
-                         mat4x4_scale(entity.Scale) * finalTransform;
-    SetUniform(shader.ModelMatrix, &modelMatrix, 1);
-    SetUniform(shader.HasBones, nodeInfo->Skinned);
+  BindMaterialBlock(context, primitive.Material);
+}
+
+// The animated mesh program, or the PBR variant the primitive needs
+static const ogl_skinned_shader* GetEntityShader(
+  const render_context& context,
+  const bool pbr,
+  const Asset::model_primitive& primitive,
+  const bool skinned)
+{
+  if (!pbr) {
+    return &context.AnimatedMeshShader;
+  }
+
+  const ogl_shader_pbr& shader =
+    context.PbrShaders[get_pbr_variant(primitive, skinned)];
+  HOKI_ASSERT(shader.Id != HOKI_OGL_NO_ID);
+  return &shader;
+}
+
+static void RenderEntity(const game_entity& entity,
+                         render_context& context,
+                         const bool pbr,
+                         const bool translucentPass)
+{
+  const uint32_t modelId = GetModelRenderId(context, *entity.Model);
+  BindVertexArray(context, modelId);
+
+  for (size_t n = 0; n < entity.Model->NodeCount; n++) {
+    Asset::model_node* nodeInfo = entity.Model->Nodes + n;
+    if (nodeInfo->Mesh == nullptr) {
+      continue;
+    }
+    Asset::model_mesh& meshInfo = *nodeInfo->Mesh;
 
+    // Primitives of a node may need different programs
+    const ogl_skinned_shader* nodeShader = nullptr;
     for (size_t p = 0; p < meshInfo.PrimitiveCount; p++) {
       Asset::model_primitive& primitive = meshInfo.Primitives[p];
 
@@ -289,57 +476,16 @@ static void RenderEntity(const game_entity& entity,
         continue;
       }
 
-      // Material texture is prioritized
-      const texture* albedoTexture = nullptr;
-      const texture* metallicTexture = nullptr;
-      const texture* roughnessTexture = nullptr;
-      const texture* normalTexture = nullptr;
-      if (primitive.Material != nullptr) {
-        albedoTexture = primitive.Material->AlbedoMap;
-        metallicTexture = primitive.Material->MetallicMap;
-        roughnessTexture = primitive.Material->RoughnessMap;
-        normalTexture = primitive.Material->NormalMap;
-      } else if (entity.Texture != nullptr) {
-        albedoTexture = entity.Texture;
-      } else if (primitive.Texture != nullptr) {
-        albedoTexture = primitive.Texture;
-      }
-
-      GLint albedoMapId = HOKI_OGL_INVALID_ID;
-      if (albedoTexture != nullptr) {
-        renderable* albedoTextureRenderable =
-          (renderable*)get(*context.RenderableStore, albedoTexture);
-        if (albedoTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          albedoTextureRenderable->RenderId = BindTexture(*albedoTexture);
-        }
-        albedoMapId = albedoTextureRenderable->RenderId;
-      }
-      GLint metallicMapId = HOKI_OGL_INVALID_ID;
-      if (metallicTexture != nullptr) {
-        renderable* metallicTextureRenderable =
-          (renderable*)get(*context.RenderableStore, metallicTexture);
-        if (metallicTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          metallicTextureRenderable->RenderId = BindTexture(*metallicTexture);
-        }
-        metallicMapId = metallicTextureRenderable->RenderId;
-      }
-      GLint roughnessMapId = HOKI_OGL_INVALID_ID;
-      if (roughnessTexture != nullptr) {
-        renderable* roughnessTextureRenderable =
-          (renderable*)get(*context.RenderableStore, roughnessTexture);
-        if (roughnessTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          roughnessTextureRenderable->RenderId = BindTexture(*roughnessTexture);
-        }
-        roughnessMapId = roughnessTextureRenderable->RenderId;
+      const ogl_skinned_shader* shader =
+        GetEntityShader(context, pbr, primitive, nodeInfo->Skinned);
+      if (shader != nodeShader) {
+        UseProgram(context, shader->Id);
+        SetUniform(shader->ModelMatrix, entity.NodeTransforms + n, 1);
+        SetUniform(shader->HasBones, nodeInfo->Skinned);
+        nodeShader = shader;
       }
 
-      SetUniform(shader.Material,
-                 primitive.Material,
-                 albedoMapId,
-                 roughnessMapId,
-                 metallicMapId,
-                 textureIndex,
-                 1);
+      BindMaterial(context, primitive, entity.Texture);
 
       glDrawElements(GL_TRIANGLES,
                      (GLsizei)primitive.IndexCount,
@@ -347,45 +493,33 @@ static void RenderEntity(const game_entity& entity,
                      (GLvoid*)primitive.IndexOffsetBytes);
     }
   }
-
-  glBindVertexArray(0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+// Draws each range of instances that survived culling in the game
 static void RenderPbrEntityInstanced(const instanced_entity& entity,
+                                     const render_instance_range* ranges,
+                                     const uint32_t rangeCount,
                                      render_context& context,
                                      const bool translucentPass)
 {
+  const uint32_t modelId = GetModelRenderId(context, *entity.Model);
 
-  renderable* model = (renderable*)get(*context.RenderableStore, entity.Model);
-  if (model->RenderId == HOKI_OGL_NO_ID) {
-    model->RenderId = BindModel(*entity.Model);
-  }
-
-  if (entity.BoneCount > 0) {
-    SetUniform(context.PbrInstancedShader.Bones,
-               entity.BoneTransforms,
-               entity.BoneCount);
-  }
-  SetUniform(context.PbrInstancedShader.InstanceCount, entity.InstanceCount);
-  SetUniform(
-    context.PbrInstancedShader.InstanceSpacing, &entity.InstanceSpacing, 1);
-
-  glBindVertexArray(model->RenderId);
+  const AnimationSystem::baked_animation_run* bakedRun = entity.BakedRun;
+  const bool bakedPose = bakedRun != nullptr && bakedRun->Baked != nullptr;
 
-  mat4x4 viewProjection = context.ProjectionMatrix * context.ViewMatrix;
+  BindVertexArray(context, modelId);
 
-  SetUniform(context.PbrInstancedShader.ViewProjection, &viewProjection, 1);
-  SetUniform(context.PbrInstancedShader.LightSpaceMatrix,
-             &context.LightProjectionMatrix,
-             1);
-  int32_t textureIndex = 0;
-  if (context.ShadowMapNearTextureId != HOKI_OGL_NO_ID) {
-    glActiveTexture(GL_TEXTURE0 + textureIndex);
-    SetSamplerUniform(context.PbrInstancedShader.ShadowMap, textureIndex);
-    glBindTexture(GL_TEXTURE_2D, context.ShadowMapNearTextureId);
-    textureIndex++;
+  uint32_t bakedPoseId = HOKI_OGL_NO_ID;
+  int bakedFrameCount = 0;
+  float bakedFrame = 0.0f;
+  if (bakedPose) {
+    const AnimationSystem::baked_animation& baked = *bakedRun->Baked;
+    bakedPoseId = GetBakedPoseRenderId(context, baked);
+    if (bakedPoseId == HOKI_OGL_NO_ID) {
+      return;
+    }
+    bakedFrameCount = (int)baked.FrameCount;
+    bakedFrame = bakedRun->CurrentTime * baked.FrameRate;
   }
   for (size_t n = 0; n < entity.Model->NodeCount; n++) {
     Asset::model_node* nodeInfo = entity.Model->Nodes + n;
@@ -395,30 +529,8 @@ static void RenderPbrEntityInstanced(const instanced_entity& entity,
 
     Asset::model_mesh& meshInfo = *nodeInfo->Mesh;
 
-    mat4x4 finalTransform = nodeInfo->Transform;
-    Asset::model_node* parentNode = nodeInfo->Parent;
-    while (!nodeInfo->Skinned && parentNode) {
-      if (parentNode->BoneId > -1) {
-        finalTransform =
-          entity.Bones[parentNode->BoneId].Transform * finalTransform;
-      } else {
-        finalTransform = parentNode->Transform * finalTransform;
-      }
-
-      parentNode = parentNode->Parent;
-    }
-
-    mat4x4 modelMatrix = IDENTITY_MATRIX * mat4x4_translate(entity.Position) *
-                         quat_to_mat4x4(entity.Rotation) *
-                         mat4x4_scale(entity.Scale) * finalTransform;
-
-    SetUniform(context.PbrInstancedShader.ModelMatrix, &modelMatrix, 1);
-#if 0
-    SetUniform(context.PbrInstancedShader.HasBones, false);
-#else
-    SetUniform(context.PbrInstancedShader.HasBones, nodeInfo->Skinned);
-#endif
-
+    // Primitives of a node may need different programs
+    const ogl_shader_pbr_instanced* nodeShader = nullptr;
     for (size_t p = 0; p < meshInfo.PrimitiveCount; p++) {
       Asset::model_primitive& primitive = meshInfo.Primitives[p];
 
@@ -431,71 +543,40 @@ static void RenderPbrEntityInstanced(const instanced_entity& entity,
         continue;
       }
 
-      // Material texture is prioritized
-      const texture* albedoTexture = nullptr;
-      const texture* metallicTexture = nullptr;
-      const texture* roughnessTexture = nullptr;
-      const texture* normalTexture = nullptr;
-      if (primitive.Material != nullptr) {
-        albedoTexture = primitive.Material->AlbedoMap;
-        metallicTexture = primitive.Material->MetallicMap;
-        roughnessTexture = primitive.Material->RoughnessMap;
-        normalTexture = primitive.Material->NormalMap;
-      } else if (entity.Texture != nullptr) {
-        albedoTexture = entity.Texture;
-      } else if (primitive.Texture != nullptr) {
-        albedoTexture = primitive.Texture;
-      }
-
-      GLint albedoMapId = HOKI_OGL_INVALID_ID;
-      if (albedoTexture != nullptr) {
-        renderable* albedoTextureRenderable =
-          (renderable*)get(*context.RenderableStore, albedoTexture);
-        if (albedoTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          albedoTextureRenderable->RenderId = BindTexture(*albedoTexture);
-        }
-        albedoMapId = albedoTextureRenderable->RenderId;
-      }
-      GLint metallicMapId = HOKI_OGL_INVALID_ID;
-      if (metallicTexture != nullptr) {
-        renderable* metallicTextureRenderable =
-          (renderable*)get(*context.RenderableStore, metallicTexture);
-        if (metallicTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          metallicTextureRenderable->RenderId = BindTexture(*metallicTexture);
+      const ogl_shader_pbr_instanced& shader =
+        context.PbrInstancedShaders[get_pbr_variant(primitive,
+                                                    nodeInfo->Skinned)];
+      HOKI_ASSERT(shader.Id != HOKI_OGL_NO_ID);
+      if (&shader != nodeShader) {
+        UseProgram(context, shader.Id);
+        SetUniform(shader.ModelMatrix, entity.NodeTransforms + n, 1);
+        SetUniform(shader.HasBakedPose, bakedPose);
+        SetUniform(shader.InstanceCount, entity.InstanceCount);
+        SetUniform(shader.InstanceSpacing, &entity.InstanceSpacing, 1);
+        if (bakedPose) {
+          SetUniform(shader.BakedFrameCount, bakedFrameCount);
+          SetUniform(shader.BakedFrame, bakedFrame);
         }
-        metallicMapId = metallicTextureRenderable->RenderId;
+        nodeShader = &shader;
       }
-      GLint roughnessMapId = HOKI_OGL_INVALID_ID;
-      if (roughnessTexture != nullptr) {
-        renderable* roughnessTextureRenderable =
-          (renderable*)get(*context.RenderableStore, roughnessTexture);
-        if (roughnessTextureRenderable->RenderId == HOKI_OGL_NO_ID) {
-          roughnessTextureRenderable->RenderId = BindTexture(*roughnessTexture);
-        }
-        roughnessMapId = roughnessTextureRenderable->RenderId;
+
+      BindMaterial(context, primitive, entity.Texture);
+      if (bakedPose) {
+        BindTexture2D(context, TEXTURE_UNIT_BAKED_POSE, bakedPoseId);
       }
 
-      SetUniform(context.PbrInstancedShader.Material,
-                 primitive.Material,
-                 albedoMapId,
-                 roughnessMapId,
-                 metallicMapId,
-                 textureIndex,
-                 1);
-
-      glDrawElementsInstanced(GL_TRIANGLES,
-                              (GLsizei)primitive.IndexCount,
-                              GL_UNSIGNED_SHORT,
-                              (GLvoid*)primitive.IndexOffsetBytes,
-                              entity.InstanceCount);
+      for (uint32_t r = 0; r < rangeCount; r++) {
+        SetUniform(shader.InstanceOffset, (int)ranges[r].First);
+        glDrawElementsInstanced(GL_TRIANGLES,
+                                (GLsizei)primitive.IndexCount,
+                                GL_UNSIGNED_SHORT,
+                                (GLvoid*)primitive.IndexOffsetBytes,
+                                (GLsizei)ranges[r].Count);
+      }
     }
   }
 
   HOKI_ASSERT_NO_OPENGL_ERRORS();
-
-  glBindVertexArray(0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 #if HOKI_DEV
@@ -612,22 +693,47 @@ static void DEBUG_RenderLight(const game_light& light, render_context& context)
 static void UpdateCamera(const game_camera& camera, render_context& context)
 {
   context.ViewMatrix = look_at(camera.Position, camera.Target);
-
-  if (context.HighQuality) {
-    SetUniform(context.PbrShader.CameraPos, &camera.Position, 1);
-  } else {
-    SetUniform(context.AnimatedMeshShader.CameraPos, &camera.Position, 1);
-  }
+  context.FrameBlock.CameraPos = camera.Position;
+  context.FrameBlockDirty = true;
 }
 
-static void RenderLight(shader_uniform_lights* targetLights,
-                        const game_light* light,
-                        render_context& context)
+// Point lights take the next slot, the slots are handed out again each frame
+static void RenderLight(const game_light& light, render_context& context)
 {
-  SetUniform(*targetLights, light);
+  uniform_block_frame& frame = context.FrameBlock;
+  switch (light.LightType) {
+    case LIGHT_TYPE_DIRECTION:
+      frame.DirLight.Direction = light.Vector;
+      frame.DirLight.Color = light.Color;
+      frame.DirLight.Ambient = light.Ambient;
+      frame.DirLight.Diffuse = light.Diffuse;
+      frame.DirLight.Specular = light.Specular;
+      break;
+
+    case LIGHT_TYPE_POINT: {
+      uniform_block_point_light& pointLight =
+        frame.PointLights[context.NextPointLight++ % MAX_LIGHTS];
+      pointLight.Position = light.Vector;
+      pointLight.Color = light.Color;
+      pointLight.Ambient = light.Ambient;
+      pointLight.Diffuse = light.Diffuse;
+      pointLight.Specular = light.Specular;
+      pointLight.Constant = light.Constant;
+      pointLight.Linear = light.Linear;
+      pointLight.Quadratic = light.Quadratic;
+    } break;
+
+    default:
+      HOKI_ASSERT_MESSAGE(false, "Undefined light type");
+  }
+
+  context.FrameBlockDirty = true;
 }
 
-static void SetupShadowmaps(render_context& context)
+static void CreateShadowmap(const uint32_t width,
+                            const uint32_t height,
+                            int32_t& outFbo,
+                            int32_t& outTextureId)
 {
   GLuint depthMapFbo;
   glGenFramebuffers(1, &depthMapFbo);
@@ -641,8 +747,8 @@ static void SetupShadowmaps(render_context& context)
   glTexImage2D(GL_TEXTURE_2D,
                0,
                GL_DEPTH_COMPONENT24,
-               SHADOW_MAP_SIZE,
-               SHADOW_MAP_SIZE,
+               width,
+               height,
                0,
                GL_DEPTH_COMPONENT,
                GL_UNSIGNED_INT,
@@ -676,63 +782,245 @@ static void SetupShadowmaps(render_context& context)
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-  context.ShadowMapNearTextureId = depthMapTextureId;
-  context.ShadowMapNearFbo = depthMapFbo;
+  outFbo = depthMapFbo;
+  outTextureId = depthMapTextureId;
 }
 
-static void RenderShadowmap(const MapSystem::map map,
-                            render_context& context,
-                            const game_window_info& windowInfo)
+static const render_quality_tier& GetQualityTier(const render_context& context)
+{
+  return RENDER_QUALITY_TIERS[context.Quality];
+}
+
+static shadow_settings GetShadowSettings(const render_context& context)
+{
+  const render_quality_tier& tier = GetQualityTier(context);
+  shadow_settings settings;
+  settings.CascadeCount = tier.ShadowCascadeCount;
+  settings.CascadeSize = tier.ShadowCascadeSize;
+
+  return settings;
+}
+
+static uint32_t GetStaticShadowGuard(const shadow_settings& settings)
+{
+  return settings.CascadeSize / SHADOW_STATIC_GUARD_DIVISOR;
+}
+
+static void GetShadowMapSize(const shadow_settings& settings,
+                             const uint32_t tileSize,
+                             uint32_t& width,
+                             uint32_t& height)
+{
+  width = tileSize * std::min(settings.CascadeCount, 2u);
+  height = tileSize * ((settings.CascadeCount + 1) / 2);
+}
+
+// Recreated when the quality changes
+static void SetupShadowmaps(render_context& context,
+                            const shadow_settings& settings)
 {
-  if (context.ShadowMapNearFbo == HOKI_OGL_NO_ID) {
-    SetupShadowmaps(context);
+  HOKI_ASSERT(settings.CascadeCount > 0 &&
+              settings.CascadeCount <= MAX_SHADOW_CASCADES);
+  if (context.ShadowMapFbo != HOKI_OGL_NO_ID) {
+    const GLuint framebuffers[] = { (GLuint)context.ShadowMapFbo,
+                                    (GLuint)context.ShadowMapStaticFbo };
+    const GLuint textures[] = { (GLuint)context.ShadowMapTextureId,
+                                (GLuint)context.ShadowMapStaticTextureId };
+    glDeleteFramebuffers(2, framebuffers);
+    glDeleteTextures(2, textures);
+  }
+
+  uint32_t width, height;
+  GetShadowMapSize(settings, settings.CascadeSize, width, height);
+  CreateShadowmap(
+    width, height, context.ShadowMapFbo, context.ShadowMapTextureId);
+  const uint32_t staticTileSize =
+    settings.CascadeSize + 2 * GetStaticShadowGuard(settings);
+  GetShadowMapSize(settings, staticTileSize, width, height);
+  CreateShadowmap(width,
+                  height,
+                  context.ShadowMapStaticFbo,
+                  context.ShadowMapStaticTextureId);
+
+  context.ShadowSettings = settings;
+  for (size_t i = 0; i < MAX_SHADOW_CASCADES; i++) {
+    context.ShadowCascades[i] = {};
   }
+}
 
-  glBindFramebuffer(GL_FRAMEBUFFER, context.ShadowMapNearFbo);
-  glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
-  glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+static bool IsSceneScaled(const render_context& context)
+{
+  return context.SceneFbo != HOKI_OGL_NO_ID;
+}
 
-  glCullFace(GL_FRONT);
+static void DeleteSceneTarget(render_context& context)
+{
+  if (IsSceneScaled(context)) {
+    const GLuint framebuffer = (GLuint)context.SceneFbo;
+    const GLuint textures[] = { (GLuint)context.SceneTextureId,
+                                (GLuint)context.SceneDepthTextureId };
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(2, textures);
+  }
+  context.SceneFbo = HOKI_OGL_NO_ID;
+  context.SceneTextureId = HOKI_OGL_NO_ID;
+  context.SceneDepthTextureId = HOKI_OGL_NO_ID;
+}
+
+static void CreateSceneTarget(render_context& context,
+                              const uint32_t width,
+                              const uint32_t height)
+{
+  DeleteSceneTarget(context);
+
+  GLuint textures[2];
+  glGenTextures(2, textures);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA8,
+               width,
+               height,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glBindTexture(GL_TEXTURE_2D, textures[1]);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_DEPTH_COMPONENT24,
+               width,
+               height,
+               0,
+               GL_DEPTH_COMPONENT,
+               GL_UNSIGNED_INT,
+               nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  GLuint fbo;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(
+    GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+  glFramebufferTexture2D(
+    GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[1], 0);
 
-  v3 mid =
-    get_midpoint_for_frustum(context.ShadowNearProjection * context.ViewMatrix);
-  v3 target = mid + map.Lights[0].Vector;
+  GLenum bufferComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  HOKI_ASSERT(bufferComplete == GL_FRAMEBUFFER_COMPLETE);
 
-  context.LightViewMatrix = look_at(mid, target);
+  context.SceneFbo = fbo;
+  context.SceneTextureId = textures[0];
+  context.SceneDepthTextureId = textures[1];
+}
 
-  context.LightProjectionMatrix =
-    context.ShadowOrthoProjection * context.LightViewMatrix;
-#if 1
-  // Avoid shadow moving when only the camera moves
-  float worldUnitsPerTexel = 2.0f / SHADOW_MAP_SIZE;
-  for (int i = 12; i < 15; i++) {
-    mat4x4& matrix = context.LightProjectionMatrix;
-    matrix.S[i] = quantize_f(matrix.S[12], worldUnitsPerTexel);
+static void BindSceneTarget(const render_context& context,
+                            const game_window_info& windowInfo)
+{
+  if (IsSceneScaled(context)) {
+    glBindFramebuffer(GL_FRAMEBUFFER, context.SceneFbo);
+    glViewport(0, 0, context.SceneWidth, context.SceneHeight);
+  } else {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowInfo.Width, windowInfo.Height);
   }
-#endif
+}
 
-  SetUniform(
-    context.ShadowShader.ViewProjection, &context.LightProjectionMatrix, 1);
+/**
+ * The scene renders at the tier's fraction of the window into its own target,
+ * a full scale tier draws straight to the window and skips the copy.
+ */
+static void BeginSceneTarget(render_context& context,
+                             const game_window_info& windowInfo)
+{
+  const float scale = GetQualityTier(context).RenderScale;
+  const uint32_t width =
+    std::max((uint32_t)((float)windowInfo.Width * scale + 0.5f), 1u);
+  const uint32_t height =
+    std::max((uint32_t)((float)windowInfo.Height * scale + 0.5f), 1u);
+
+  if (width >= (uint32_t)windowInfo.Width &&
+      height >= (uint32_t)windowInfo.Height) {
+    DeleteSceneTarget(context);
+  } else if (!IsSceneScaled(context) || context.SceneWidth != width ||
+             context.SceneHeight != height) {
+    CreateSceneTarget(context, width, height);
+  }
+  context.SceneWidth = width;
+  context.SceneHeight = height;
 
-  for (size_t i = 0; i < MapSystem::ENTITY_COUNT; i++) {
-    const game_entity& entity = map.EntitiesList[i];
+  BindSceneTarget(context, windowInfo);
+  if (IsSceneScaled(context)) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+}
 
-    if (&entity == &map.Entities.Field) {
-      continue;
-    }
+// Bilinear upscale to the window, what follows draws at native resolution
+static void ResolveSceneTarget(render_context& context,
+                               const game_window_info& windowInfo)
+{
+  if (!IsSceneScaled(context)) {
+    return;
+  }
 
-    if (entity.BoneCount > 0) {
-      SetUniform(
-        context.ShadowShader.Bones, entity.BoneTransforms, entity.BoneCount);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, context.SceneFbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(0,
+                    0,
+                    context.SceneWidth,
+                    context.SceneHeight,
+                    0,
+                    0,
+                    windowInfo.Width,
+                    windowInfo.Height,
+                    GL_COLOR_BUFFER_BIT,
+                    GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, windowInfo.Width, windowInfo.Height);
+}
+
+/**
+ * Draws the map's casters that touch the light frustum, either the static
+ * ones or the rest. The field only receives shadows.
+ */
+static uint32_t RenderShadowCasters(const MapSystem::map& map,
+                                    const render_command_buffer& commands,
+                                    render_context& context,
+                                    const frustum& lightFrustum,
+                                    const bool staticCasters)
+{
+  const game_entity* mapEntities = map.EntitiesList;
+  const game_entity* mapEntitiesEnd = mapEntities + MapSystem::ENTITY_COUNT;
+  uint32_t casterCount = 0;
+  uint32_t i = 0;
+  for (const render_command* command =
+         get_next_render_command(commands, nullptr);
+       command != nullptr;
+       command = get_next_render_command(commands, command), i++) {
+    if (command->Type != RENDER_COMMAND_TYPE_ENTITY ||
+        command->Entity < mapEntities ||
+        command->Entity >= mapEntitiesEnd ||
+        command->Entity == &map.Entities.Field ||
+        ((command->Flags & RENDER_STATIC) != 0) != staticCasters) {
+      continue;
     }
 
-    renderable* model =
-      (renderable*)get(*context.RenderableStore, entity.Model);
-    if (model->RenderId == HOKI_OGL_NO_ID) {
-      model->RenderId = BindModel(*entity.Model);
+    const render_entity_state* state =
+      (const render_entity_state*)get_render_command_data(command);
+    if (state->BoundsRadius > 0.0f &&
+        !sphere_in_frustum(
+          lightFrustum, state->BoundsCenter, state->BoundsRadius)) {
+      continue;
     }
+    const game_entity entity = GetCommandEntity(*command);
+    casterCount++;
 
-    glBindVertexArray(model->RenderId);
+    BindBonePalette(context, i);
+    BindVertexArray(context, GetModelRenderId(context, *entity.Model));
 
     for (size_t n = 0; n < entity.Model->NodeCount; n++) {
       Asset::model_node* nodeInfo = entity.Model->Nodes + n;
@@ -741,24 +1029,8 @@ static void RenderShadowmap(const MapSystem::map map,
       }
       Asset::model_mesh& meshInfo = *nodeInfo->Mesh;
 
-      mat4x4 finalTransform = nodeInfo->Transform;
-      Asset::model_node* parentNode = nodeInfo->Parent;
-      while (!nodeInfo->Skinned && parentNode) {
-        if (parentNode->BoneId > -1) {
-          finalTransform =
-            entity.Bones[parentNode->BoneId].Transform * finalTransform;
-        } else {
-          finalTransform = parentNode->Transform * finalTransform;
-        }
-
-        parentNode = parentNode->Parent;
-      }
-
-      mat4x4 modelMatrix = IDENTITY_MATRIX * mat4x4_translate(entity.Position) *
-                           quat_to_mat4x4(entity.Rotation) *
-                           mat4x4_scale(entity.Scale) * finalTransform;
-
-      SetUniform(context.ShadowShader.ModelMatrix, &modelMatrix, 1);
+      SetUniform(
+        context.ShadowShader.ModelMatrix, entity.NodeTransforms + n, 1);
       SetUniform(context.ShadowShader.HasBones, nodeInfo->Skinned);
 
       for (size_t p = 0; p < meshInfo.PrimitiveCount; p++) {
@@ -773,59 +1045,240 @@ static void RenderShadowmap(const MapSystem::map map,
                        (GLvoid*)primitive.IndexOffsetBytes);
       }
     }
-    glBindVertexArray(0);
   }
 
-  // glCullFace(GL_BACK);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, windowInfo.Width, windowInfo.Height);
+  return casterCount;
+}
 
-#if HOKI_DEV && 0
-  // Draw rect with shadow buffer contents
-  glUseProgram(context.SimpleTexturedShader.Id);
-  uint32_t plane = BindRect(context);
-  mat4x4 shadowmapPlaneModelMatrix =
-    IDENTITY_MATRIX * mat4x4_translate(_v3(0.0f)) * mat4x4_scale(_v3(0.9f));
-  SetUniform(
-    context.SimpleTexturedShader.ModelMatrix, &shadowmapPlaneModelMatrix, 1);
-  SetUniform(context.SimpleTexturedShader.ViewProjection, &IDENTITY_MATRIX, 1);
-  // draw mesh
-  glBindVertexArray(plane);
-  glBindTexture(GL_TEXTURE_2D, context.ShadowMapNearTextureId);
-  glActiveTexture(GL_TEXTURE0);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-#endif
+static uint32_t CountStaticCasters(const render_command_buffer& commands)
+{
+  uint32_t count = 0;
+  for (const render_command* command =
+         get_next_render_command(commands, nullptr);
+       command != nullptr;
+       command = get_next_render_command(commands, command)) {
+    if (command->Type == RENDER_COMMAND_TYPE_ENTITY &&
+        (command->Flags & RENDER_STATIC)) {
+      count++;
+    }
+  }
+
+  return count;
 }
 
-static void CameraPass(render_context& context)
+/**
+ * The cascade bounds the sphere around its slice of the view frustum, so its
+ * size does not change when the camera turns. The center is snapped to whole
+ * texels in light space, moving the camera then does not make the shadow
+ * edges crawl. The depth range has a guard band on both ends and only moves
+ * when the cascade leaves it, the static caster tile depends on it.
+ */
+static void FitShadowCascade(shadow_cascade& cascade,
+                             const float nearDepth,
+                             const mat4x4& lightView,
+                             const mat4x4& cameraInverse,
+                             const uint32_t cascadeSize)
 {
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_CAMERA:
-        UpdateCamera(*command->Camera, context);
-        break;
-    }
-    HOKI_ASSERT_NO_OPENGL_ERRORS();
+  const float farDepth = cascade.SplitDepth;
+  const float tanHalfFov = (float)tan(deg_to_rad(FOV) / 2.0f);
+  const float diagonal =
+    tanHalfFov * tanHalfFov * (ASPECT_RATIO * ASPECT_RATIO + 1.0f);
+  const float nearDiagonal = nearDepth * nearDepth * diagonal;
+  const float farDiagonal = farDepth * farDepth * diagonal;
+
+  // Depth where the near and far corners are equally far away
+  float centerDepth = (farDepth * farDepth - nearDepth * nearDepth +
+                       farDiagonal - nearDiagonal) /
+                      (2.0f * (farDepth - nearDepth));
+  centerDepth = std::min(centerDepth, farDepth);
+  const float radius = std::ceil(std::sqrt(
+    (farDepth - centerDepth) * (farDepth - centerDepth) + farDiagonal));
+
+  const v4 center = cameraInverse * _v4(0.0f, 0.0f, -centerDepth, 1.0f);
+  v4 lightCenter = lightView * center;
+  const float worldUnitsPerTexel = 2.0f * radius / cascadeSize;
+  for (int i = 0; i < 3; i++) {
+    lightCenter.E[i] = quantize_f(lightCenter.E[i], worldUnitsPerTexel);
+  }
+
+  const float clipNear = -lightCenter.Z - radius - SHADOW_CASTER_DEPTH;
+  const float clipFar = -lightCenter.Z + radius;
+  if (!cascade.Valid || cascade.Radius != radius ||
+      clipNear < cascade.ClipNear || clipFar > cascade.ClipFar) {
+    const float guard = radius * SHADOW_DEPTH_GUARD;
+    cascade.ClipNear = clipNear - guard;
+    cascade.ClipFar = clipFar + guard;
+    cascade.StaticValid = false;
   }
+  cascade.LightCenter = lightCenter.XYZ;
+  cascade.Radius = radius;
+
+  const mat4x4 projection = orthographic_matrix(lightCenter.X - radius,
+                                                lightCenter.X + radius,
+                                                lightCenter.Y + radius,
+                                                lightCenter.Y - radius,
+                                                cascade.ClipNear,
+                                                cascade.ClipFar);
+  cascade.LightProjection = projection * lightView;
+}
+
+// Same texels and depth range as the cascade, guard texels wider on each side
+static mat4x4 GetStaticShadowProjection(const shadow_cascade& cascade,
+                                        const uint32_t guard,
+                                        const uint32_t cascadeSize)
+{
+  const float extent =
+    cascade.Radius * (1.0f + 2.0f * (float)guard / (float)cascadeSize);
+  const v3 center = cascade.StaticCenter;
+  const mat4x4 projection = orthographic_matrix(center.X - extent,
+                                                center.X + extent,
+                                                center.Y + extent,
+                                                center.Y - extent,
+                                                cascade.ClipNear,
+                                                cascade.ClipFar);
+
+  return projection * cascade.StaticLightView;
 }
 
-static void EntityPass(render_context& context, ogl_skinned_shader* shader)
+/**
+ * Each cascade is drawn into its tile. Static casters are kept in a depth map
+ * of their own, with tiles a guard band wider than the cascades. While the
+ * cascade stays inside the guard band, the part under it is copied into the
+ * shadow map and the dynamic casters are drawn over it. Only moving past the
+ * band, or out of the depth range, redraws the static tile.
+ */
+static void RenderShadowmap(const MapSystem::map& map,
+                            const render_command_buffer& commands,
+                            render_context& context,
+                            const game_window_info& windowInfo)
 {
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
+  const shadow_settings settings = GetShadowSettings(context);
+  if (context.ShadowMapFbo == HOKI_OGL_NO_ID ||
+      context.ShadowSettings.CascadeCount != settings.CascadeCount ||
+      context.ShadowSettings.CascadeSize != settings.CascadeSize) {
+    SetupShadowmaps(context, settings);
+    InvalidateBoundState(context);
+  }
 
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_ENTITY:
-        RenderEntity(*command->Entity, context, *shader, false);
-        break;
+  // Only the light's direction orients the cascades
+  context.LightViewMatrix = look_at(V3_ZERO, map.Lights[0].Vector);
+  const mat4x4 cameraInverse = mat4x4_invert(context.ViewMatrix);
 
-      case RENDER_COMMAND_TYPE_LIGHT:
-        RenderLight(&shader->Lights, command->Light, context);
-        break;
+  const uint32_t staticCasterCount = CountStaticCasters(commands);
+  if (context.StaticShadowCasterCount != staticCasterCount) {
+    for (uint32_t i = 0; i < settings.CascadeCount; i++) {
+      context.ShadowCascades[i].StaticValid = false;
     }
+    context.StaticShadowCasterCount = staticCasterCount;
   }
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
+
+  context.ShadowFrame++;
+  context.FrameBlockDirty = true;
+  glCullFace(GL_FRONT);
+
+  const uint32_t size = settings.CascadeSize;
+  const uint32_t guard = GetStaticShadowGuard(settings);
+  const uint32_t staticSize = size + 2 * guard;
+  float nearDepth = NEAR_PLANE;
+  for (uint32_t i = 0; i < settings.CascadeCount; i++) {
+    shadow_cascade& cascade = context.ShadowCascades[i];
+    cascade.SplitDepth = SHADOW_MAP_SPLIT_DEPTH;
+    if (settings.CascadeCount > 1) {
+      cascade.SplitDepth *=
+        std::pow(SHADOW_DISTANCE / SHADOW_MAP_SPLIT_DEPTH,
+                 (float)i / (settings.CascadeCount - 1));
+    }
+    const float cascadeNear = nearDepth;
+    nearDepth = cascade.SplitDepth;
+
+    // The far cascade covers the most and changes the least
+    const bool farCascade = i > 0 && i == settings.CascadeCount - 1;
+    if (farCascade && cascade.Valid &&
+        context.ShadowFrame % SHADOW_FAR_CASCADE_INTERVAL != 0) {
+      continue;
+    }
+
+    FitShadowCascade(
+      cascade, cascadeNear, context.LightViewMatrix, cameraInverse, size);
+
+    // Both centers are snapped to texels, they are whole texels apart
+    const float texelSize = 2.0f * cascade.Radius / size;
+    GLint offsetX = (GLint)std::lround(
+      (cascade.LightCenter.X - cascade.StaticCenter.X) / texelSize);
+    GLint offsetY = (GLint)std::lround(
+      (cascade.LightCenter.Y - cascade.StaticCenter.Y) / texelSize);
+    const GLint staticX = (GLint)((i % 2) * staticSize);
+    const GLint staticY = (GLint)((i / 2) * staticSize);
+    if (!cascade.StaticValid || std::abs(offsetX) > (GLint)guard ||
+        std::abs(offsetY) > (GLint)guard ||
+        memcmp(&cascade.StaticLightView,
+               &context.LightViewMatrix,
+               sizeof(mat4x4)) != 0) {
+      cascade.StaticCenter = cascade.LightCenter;
+      cascade.StaticLightView = context.LightViewMatrix;
+      offsetX = 0;
+      offsetY = 0;
+      const mat4x4 staticProjection =
+        GetStaticShadowProjection(cascade, guard, size);
+      SetUniform(context.ShadowShader.ViewProjection, &staticProjection, 1);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, context.ShadowMapStaticFbo);
+      glViewport(staticX, staticY, staticSize, staticSize);
+      glEnable(GL_SCISSOR_TEST);
+      glScissor(staticX, staticY, staticSize, staticSize);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      glDisable(GL_SCISSOR_TEST);
+      RenderShadowCasters(
+        map, commands, context, get_frustum_planes(staticProjection), true);
+
+      cascade.StaticValid = true;
+    }
+
+    // The copy replaces the clear
+    const GLint x = (GLint)((i % 2) * size);
+    const GLint y = (GLint)((i / 2) * size);
+    const GLint sourceX = staticX + (GLint)guard + offsetX;
+    const GLint sourceY = staticY + (GLint)guard + offsetY;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, context.ShadowMapStaticFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, context.ShadowMapFbo);
+    glBlitFramebuffer(sourceX,
+                      sourceY,
+                      sourceX + size,
+                      sourceY + size,
+                      x,
+                      y,
+                      x + size,
+                      y + size,
+                      GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, context.ShadowMapFbo);
+
+    const frustum lightFrustum = get_frustum_planes(cascade.LightProjection);
+    SetUniform(
+      context.ShadowShader.ViewProjection, &cascade.LightProjection, 1);
+    glViewport(x, y, size, size);
+    RenderShadowCasters(map, commands, context, lightFrustum, false);
+    cascade.Valid = true;
+  }
+
+  // glCullFace(GL_BACK);
+  BindSceneTarget(context, windowInfo);
+
+#if HOKI_DEV && 0
+  // Draw rect with shadow buffer contents
+  glUseProgram(context.SimpleTexturedShader.Id);
+  uint32_t plane = BindRect(context);
+  mat4x4 shadowmapPlaneModelMatrix =
+    IDENTITY_MATRIX * mat4x4_translate(_v3(0.0f)) * mat4x4_scale(_v3(0.9f));
+  SetUniform(
+    context.SimpleTexturedShader.ModelMatrix, &shadowmapPlaneModelMatrix, 1);
+  SetUniform(context.SimpleTexturedShader.ViewProjection, &IDENTITY_MATRIX, 1);
+  // draw mesh
+  glBindVertexArray(plane);
+  glBindTexture(GL_TEXTURE_2D, context.ShadowMapTextureId);
+  glActiveTexture(GL_TEXTURE0);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+#endif
 }
 
 static void Initialize(render_context& context, game_window_info& windowInfo)
@@ -841,220 +1294,568 @@ static void Initialize(render_context& context, game_window_info& windowInfo)
   context.PerspectiveMatrix =
     perspective_matrix(FOV, ASPECT_RATIO, NEAR_PLANE, FAR_PLANE);
   context.ProjectionMatrix = context.PerspectiveMatrix;
+  context.FrameBlockDirty = true;
+}
 
-  // Shadow mapping stuff
-  context.ShadowNearProjection =
-    perspective_matrix(FOV, ASPECT_RATIO, NEAR_PLANE, SHADOW_MAP_SPLIT_DEPTH);
-  // context.ShadowFarProjection =
-  //  perspective_matrix(FOV, ASPECT_RATIO, SHADOW_MAP_SPLIT_DEPTH,
-  //  FAR_PLANE);
-
-  // calculate frustum size
-  mat4x4 projInv = mat4x4_invert(context.ShadowNearProjection);
-  v4 LBN = projInv * _v4(-1.0f, -1.0f, -1.0f, 1.0f);
-  LBN = LBN / LBN.W;
-  v4 RTF = projInv * _v4(1.0f, 1.0f, 1.0f, 1.0f);
-  RTF = RTF / RTF.W;
-  context.ShadowOrthoRadius = std::ceil(length(LBN.XYZ - RTF.XYZ));
-  context.ShadowOrthoProjection =
-    orthographic_matrix(-context.ShadowOrthoRadius,
-                        context.ShadowOrthoRadius,
-                        context.ShadowOrthoRadius,
-                        -context.ShadowOrthoRadius,
-                        -context.ShadowOrthoRadius,
-                        context.ShadowOrthoRadius);
+static uint64_t MakeSortKey(const render_pass pass,
+                            const uint32_t stage,
+                            const uint32_t shader,
+                            const uint32_t material,
+                            const uint32_t depth,
+                            const uint32_t sequence)
+{
+  HOKI_ASSERT(sequence <= 0x1FFFF);
+  return ((uint64_t)(pass & 0xF) << 60) | ((uint64_t)(stage & 0x3) << 58) |
+         ((uint64_t)(shader & 0x3F) << 52) |
+         ((uint64_t)(material & 0xFFFFFF) << 28) |
+         ((uint64_t)(depth & 0x7FF) << 17) | (uint64_t)(sequence & 0x1FFFF);
 }
 
-extern "C" RENDERER_MAIN(RendererMain)
+static render_pass GetSortKeyPass(const uint64_t key)
 {
-  if (windowInfo.Width == 0 || windowInfo.Height == 0) {
-    return;
+  return (render_pass)(key >> 60);
+}
+
+static uint32_t GetSortKeySequence(const uint64_t key)
+{
+  return (uint32_t)(key & 0x1FFFF);
+}
+
+// Uses last frame's view, close enough for ordering
+static uint32_t GetSortDepth(const render_context& context, const v3& position)
+{
+  const v4 viewPosition = context.ViewMatrix * _v4(position, 1.0f);
+  const float depth = clamp(-viewPosition.Z / FAR_PLANE, 0.0f, 1.0f);
+
+  return (uint32_t)(depth * 0xFFFF);
+}
+
+// The first drawn primitive stands for the entity, primitives of a model
+// mostly share their program and textures
+static const Asset::model_primitive* GetSortPrimitive(
+  const Asset::model& model,
+  bool& skinned)
+{
+  for (size_t n = 0; n < model.NodeCount; n++) {
+    const Asset::model_node& node = model.Nodes[n];
+    if (node.Mesh != nullptr && node.Mesh->PrimitiveCount > 0) {
+      skinned = node.Skinned;
+      return node.Mesh->Primitives;
+    }
   }
 
-  if (!context.Initialized) {
-    return;
+  return nullptr;
+}
+
+// 0 for the animated mesh program, the PBR variant plus one otherwise
+static uint32_t GetSortShader(const game_entity& entity, const bool pbr)
+{
+  bool skinned = false;
+  const Asset::model_primitive* primitive =
+    GetSortPrimitive(*entity.Model, skinned);
+  if (!pbr || primitive == nullptr) {
+    return 0;
   }
 
-  // glEnable(GL_FRAMEBUFFER_SRGB);
-#if HOKI_DEV
-  glClearColor(0.0f, 0.5f, 1.0f, 1.0f);
-#else
-  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-#endif
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  return get_pbr_variant(*primitive, skinned) + 1;
+}
 
-  glViewport(0, 0, windowInfo.Width, windowInfo.Height);
+/**
+ * Albedo texture handle over the model handle, in the order BindMaterial picks
+ * the texture. Handles are known before the GL objects exist, unlike names.
+ */
+static uint32_t GetSortMaterial(const game_entity& entity)
+{
+  bool skinned = false;
+  const Asset::model_primitive* primitive =
+    GetSortPrimitive(*entity.Model, skinned);
+  const texture* albedoTexture = entity.Texture;
+  if (primitive != nullptr && primitive->Material != nullptr) {
+    albedoTexture = primitive->Material->AlbedoMap;
+  } else if (primitive != nullptr && albedoTexture == nullptr) {
+    albedoTexture = primitive->Texture;
+  }
+  const uint32_t textureHandle =
+    albedoTexture != nullptr ? albedoTexture->RenderHandle : 0;
 
-#if HOKI_DEV
-  // calculate each frame
-  Initialize(context, windowInfo);
-#endif
+  return ((textureHandle & 0xFFF) << 12) | (entity.Model->RenderHandle & 0xFFF);
+}
 
-  // SETUP PASS
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
+static bool CompareSortEntries(const render_sort_entry& a,
+                               const render_sort_entry& b)
+{
+  return a.Key < b.Key;
+}
 
+static void PushSortEntry(render_context& context,
+                          const uint64_t key,
+                          const render_command* command)
+{
+  HOKI_ASSERT(context.SortedCommandCount < context.SortedCommandCapacity);
+  render_sort_entry& entry =
+    context.SortedCommands[context.SortedCommandCount++];
+  entry.Key = key;
+  entry.Command = command;
+}
+
+/**
+ * Gives every command a key for each pass it takes part in and sorts them, so
+ * the frame is a single walk. Opaque draws are grouped by program, texture
+ * and model and go front to back, translucent ones back to front.
+ */
+static void SortCommands(render_context& context)
+{
+  context.SortedCommandCount = 0;
+  uint32_t i = 0;
+  for (const render_command* command =
+         get_next_render_command(context.Commands, nullptr);
+       command != nullptr;
+       command = get_next_render_command(context.Commands, command), i++) {
     switch (command->Type) {
       case RENDER_COMMAND_TYPE_INITIALIZE:
-        Initialize(context, windowInfo);
+      case RENDER_COMMAND_TYPE_CREATE_SHADER:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_SETUP, 0, 0, 0, 0, i), command);
         break;
 
-      case RENDER_COMMAND_TYPE_CREATE_SHADER:
-        CreateShader(*command->ShaderProgram, context);
+      // Both go to the frame block that every program shares
+      case RENDER_COMMAND_TYPE_CAMERA:
+      case RENDER_COMMAND_TYPE_LIGHT:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_CAMERA, 0, 0, 0, 0, i), command);
+        break;
+
+      case RENDER_COMMAND_TYPE_SHADOW:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_SHADOW, 0, 0, 0, 0, i), command);
+        break;
+
+      case RENDER_COMMAND_TYPE_INSTANCED:
+      case RENDER_COMMAND_TYPE_ENTITY: {
+        // Kept in the stream for the shadow pass only
+        if (command->Flags & RENDER_OUTSIDE_VIEW) {
+          break;
+        }
+        const render_entity_state* state =
+          (const render_entity_state*)get_render_command_data(command);
+        const bool pbr = GetQualityTier(context).Pbr;
+        const uint32_t depth = GetSortDepth(context, state->Position);
+        const uint32_t shader = GetSortShader(*command->Entity, pbr);
+        const uint32_t material = GetSortMaterial(*command->Entity);
+        // Opaque draws only need coarse depth, the upper bits go to material
+        const uint32_t opaqueDepth = depth >> 5;
+        if (command->Type == RENDER_COMMAND_TYPE_ENTITY) {
+          PushSortEntry(context,
+                        MakeSortKey(RENDER_PASS_ENTITY,
+                                    1,
+                                    shader,
+                                    material,
+                                    opaqueDepth,
+                                    i),
+                        command);
+        } else if (pbr) {
+          PushSortEntry(context,
+                        MakeSortKey(RENDER_PASS_INSTANCED,
+                                    1,
+                                    shader,
+                                    material,
+                                    opaqueDepth,
+                                    i),
+                        command);
+        }
+
+        // Depth goes in the material bits so it decides the order
+        if (command->Flags & RENDER_TRANSLUCENT) {
+          PushSortEntry(
+            context,
+            MakeSortKey(RENDER_PASS_TRANSLUCENT, 1, 0, 0xFFFF - depth, 0, i),
+            command);
+        }
+      } break;
+
+      case RENDER_COMMAND_TYPE_UI_CONTEXT:
+      case RENDER_COMMAND_TYPE_UI_BUTTON:
+      case RENDER_COMMAND_TYPE_UI_ICON:
+      case RENDER_COMMAND_TYPE_UI_TOGGLE:
+      case RENDER_COMMAND_TYPE_UI_JOYSTICK:
+      case RENDER_COMMAND_TYPE_UI_SLIDER:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_UI, 0, 0, 0, 0, i), command);
+        break;
+
+      case RENDER_COMMAND_TYPE_TEXT:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_TEXT, 0, 0, 0, 0, i), command);
+        break;
+
+#if HOKI_DEV
+      case DEBUG_RENDER_COMMAND_TYPE_CYCLE_SHADERS:
+      case DEBUG_RENDER_COMMAND_TYPE_BONES:
+      case DEBUG_RENDER_COMMAND_TYPE_PHYSICS_BODY:
+      case DEBUG_RENDER_COMMAND_TYPE_LINE:
+      case DEBUG_RENDER_COMMAND_TYPE_SET_WIREFRAME:
+      case DEBUG_RENDER_COMMAND_TYPE_LIGHT:
+      case DEBUG_RENDER_COMMAND_TYPE_CUBE:
+        PushSortEntry(
+          context, MakeSortKey(RENDER_PASS_DEBUG, 0, 0, 0, 0, i), command);
+        break;
+#endif
+
+      default:
         break;
     }
+  }
 
-    HOKI_ASSERT_NO_OPENGL_ERRORS();
+  std::sort(context.SortedCommands,
+            context.SortedCommands + context.SortedCommandCount,
+            CompareSortEntries);
+}
+
+/** GPU timers */
+
+static bool HasTimerQueries()
+{
+#ifndef GL_ES_VERSION_3_0
+  return glGenQueries != NULL && glBeginQuery != NULL &&
+         glEndQuery != NULL && glGetQueryObjectuiv != NULL;
+#else
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (GLint i = 0; i < extensionCount; i++) {
+    const char* extension =
+      (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+    if (extension != nullptr &&
+        strcmp(extension, "GL_EXT_disjoint_timer_query") == 0) {
+      return true;
+    }
   }
-  // CAMERA PASS
-  if (context.HighQuality) {
-    glUseProgram(context.PbrShader.Id);
-    CameraPass(context);
-    glUseProgram(context.PbrInstancedShader.Id);
-    CameraPass(context);
-  } else {
-    glUseProgram(context.AnimatedMeshShader.Id);
-    CameraPass(context);
+  return false;
+#endif
+}
+
+// Collects what the GPU finished of the set this frame reuses
+static void BeginGpuTimerFrame(gpu_pass_timers& timers)
+{
+  if (!timers.Checked) {
+    timers.Checked = true;
+    timers.Supported = HasTimerQueries();
+    if (timers.Supported) {
+      glGenQueries(GPU_TIMER_FRAMES * RENDER_PASS_COUNT, &timers.Queries[0][0]);
+    }
+  }
+  if (!timers.Supported) {
+    return;
   }
 
-  // SHADOW PASS
-  glUseProgram(context.ShadowShader.Id);
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_SHADOW: {
-        RenderShadowmap(*command->Map, context, windowInfo);
-      } break;
+  // A power or context change since the last check voids the results
+  GLint disjoint = 0;
+#ifdef GL_ES_VERSION_3_0
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+#endif
+  const uint32_t set = timers.Frame % GPU_TIMER_FRAMES;
+  for (uint32_t pass = 0; pass < RENDER_PASS_COUNT; pass++) {
+    if (!timers.Pending[set][pass]) {
+      timers.PassMilliseconds[pass] = 0.0f;
+      continue;
     }
 
-    HOKI_ASSERT_NO_OPENGL_ERRORS();
+    const GLuint query = timers.Queries[set][pass];
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      continue;
+    }
+    GLuint nanoseconds = 0;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &nanoseconds);
+    timers.Pending[set][pass] = false;
+    if (!disjoint) {
+      timers.PassMilliseconds[pass] = (float)nanoseconds / 1000000.0f;
+    }
   }
+}
 
-  // INSTANCED PASS
-  if (context.HighQuality) {
-    glUseProgram(context.PbrInstancedShader.Id);
-    for (uint32_t i = 0;
-         render_command* command = GetNextCommand(context.Commands, i++);) {
+static void EndGpuTimerFrame(gpu_pass_timers& timers)
+{
+  timers.Frame++;
+}
 
-      switch (command->Type) {
-        case RENDER_COMMAND_TYPE_INSTANCED:
-          RenderPbrEntityInstanced(*command->InstancedEntity, context, false);
-          break;
+// Only one query can run, passes follow each other
+static void StartGpuTimer(gpu_pass_timers& timers, const render_pass pass)
+{
+  const uint32_t set = timers.Frame % GPU_TIMER_FRAMES;
+  if (!timers.Supported || pass == RENDER_PASS_NONE ||
+      timers.Pending[set][pass]) {
+    return;
+  }
 
-        case RENDER_COMMAND_TYPE_LIGHT:
-          RenderLight(
-            &context.PbrInstancedShader.Lights, command->Light, context);
-          break;
+  glBeginQuery(GL_TIME_ELAPSED, timers.Queries[set][pass]);
+  timers.ActivePass = pass;
+}
 
-        default:
-          continue;
-      }
+static void StopGpuTimer(gpu_pass_timers& timers, const render_pass pass)
+{
+  if (timers.ActivePass == RENDER_PASS_NONE || timers.ActivePass != pass) {
+    return;
+  }
 
-      HOKI_ASSERT_NO_OPENGL_ERRORS();
-    }
+  glEndQuery(GL_TIME_ELAPSED);
+  timers.Pending[timers.Frame % GPU_TIMER_FRAMES][pass] = true;
+  timers.ActivePass = RENDER_PASS_NONE;
+}
+
+// Draws what the pass left batched
+static void EndPass(const render_pass pass, render_context& context)
+{
+  if (pass == RENDER_PASS_UI) {
+    FlushUIBatch(context);
   }
+  StopGpuTimer(context.GpuTimers, pass);
+}
 
-  // ENTITY PASS
-  ogl_skinned_shader entityShader;
-  if (context.HighQuality) {
-    entityShader = context.PbrShader;
-  } else {
-    entityShader = context.AnimatedMeshShader;
+static void BeginPass(const render_pass pass, render_context& context)
+{
+  StartGpuTimer(context.GpuTimers, pass);
+  switch (pass) {
+    case RENDER_PASS_SHADOW:
+      UseProgram(context, context.ShadowShader.Id);
+      break;
+
+    // Entity draws pick their program per primitive
+    case RENDER_PASS_INSTANCED:
+    case RENDER_PASS_ENTITY:
+      FlushFrameBlock(context);
+      break;
+
+    case RENDER_PASS_TRANSLUCENT:
+      FlushFrameBlock(context);
+      glEnable(GL_BLEND);
+      break;
+
+    case RENDER_PASS_UI:
+      // UI and text bind their own objects
+      glBindVertexArray(0);
+      glActiveTexture(GL_TEXTURE0);
+      InvalidateBoundState(context);
+      UseProgram(context, context.UIShader.Id);
+      glEnable(GL_BLEND);
+      glDisable(GL_DEPTH_TEST);
+      break;
+
+    case RENDER_PASS_TEXT:
+      glBindVertexArray(0);
+      glActiveTexture(GL_TEXTURE0);
+      InvalidateBoundState(context);
+      UseProgram(context, context.TextShader.Id);
+      glEnable(GL_BLEND);
+      glEnable(GL_DEPTH_TEST);
+      break;
+
+    case RENDER_PASS_DEBUG:
+      glBindVertexArray(0);
+      glActiveTexture(GL_TEXTURE0);
+      InvalidateBoundState(context);
+      UseProgram(context, context.SimpleShader.Id);
+      glEnable(GL_BLEND);
+      glDisable(GL_DEPTH_TEST);
+      break;
+
+    default:
+      break;
   }
-  glUseProgram(entityShader.Id);
-  EntityPass(context, &entityShader);
+}
 
-  // TRANSLUCENT PASS
-  glEnable(GL_BLEND);
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_TRANSLUCENT:
-        RenderEntity(*command->Entity, context, entityShader, true);
-        break;
-    }
+extern "C" RENDERER_MAIN(RendererMain)
+{
+  if (windowInfo.Width == 0 || windowInfo.Height == 0) {
+    return;
+  }
 
-    HOKI_ASSERT_NO_OPENGL_ERRORS();
+  if (!context.Initialized) {
+    return;
   }
 
-  // UI PASS
-  glUseProgram(context.UIShader.Id);
-  glDisable(GL_DEPTH_TEST);
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_UI_BUTTON:
-        RenderButton(*command->Button, context);
-        break;
-      case RENDER_COMMAND_TYPE_UI_ICON:
-        RenderIcon(*command->Icon, context);
-        break;
-      case RENDER_COMMAND_TYPE_UI_CONTEXT:
-        SetupUIContext(*command->UIContext, windowInfo, context);
-        break;
-      case RENDER_COMMAND_TYPE_UI_TOGGLE:
-        RenderToggle(*command->Toggle, context);
-        break;
-      case RENDER_COMMAND_TYPE_UI_JOYSTICK:
-        RenderJoystick(*command->Joystick, context);
-        break;
-      case RENDER_COMMAND_TYPE_UI_SLIDER:
-        RenderSlider(*command->Slider, context);
-        break;
-    }
+  // glEnable(GL_FRAMEBUFFER_SRGB);
+#if HOKI_DEV
+  glClearColor(0.0f, 0.5f, 1.0f, 1.0f);
+#else
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+#endif
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+  BeginSceneTarget(context, windowInfo);
+
+#if HOKI_DEV
+  // calculate each frame
+  Initialize(context, windowInfo);
+#endif
+
+  if (context.FrameBlockBuffer == HOKI_OGL_NO_ID) {
+    SetupUniformBlocks(context);
   }
-  glEnable(GL_DEPTH_TEST);
 
-  // TEXT PASS
-  glUseProgram(context.TextShader.Id);
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
+  InvalidateBoundState(context);
+  SortCommands(context);
+  UploadBonePalettes(context);
+  context.NextPointLight = 0;
+  BeginGpuTimerFrame(context.GpuTimers);
+
+  const bool pbr = GetQualityTier(context).Pbr;
+  render_pass currentPass = RENDER_PASS_NONE;
+  bool sceneResolved = false;
+  for (uint32_t s = 0; s < context.SortedCommandCount; s++) {
+    const render_sort_entry& entry = context.SortedCommands[s];
+    const render_command* command = entry.Command;
+    const void* payload = get_render_command_data(command);
+
+    const render_pass pass = GetSortKeyPass(entry.Key);
+    if (pass != currentPass) {
+      EndPass(currentPass, context);
+      // UI, text and debug draws go over the scene at native resolution
+      if (pass >= RENDER_PASS_UI && !sceneResolved) {
+        ResolveSceneTarget(context, windowInfo);
+        sceneResolved = true;
+      }
+      BeginPass(pass, context);
+      currentPass = pass;
+    }
 
-    switch (command->Type) {
-      case RENDER_COMMAND_TYPE_TEXT:
-        RenderText(command->Text, windowInfo, context);
+    switch (pass) {
+      case RENDER_PASS_SETUP:
+        if (command->Type == RENDER_COMMAND_TYPE_INITIALIZE) {
+          Initialize(context, windowInfo);
+          UploadPendingResources(context, UPLOAD_PREWARM_BYTES);
+        } else {
+          CreateShader(*command->ShaderProgram, context);
+          InvalidateBoundState(context);
+        }
         break;
 
-      default:
+      case RENDER_PASS_CAMERA:
+        if (command->Type == RENDER_COMMAND_TYPE_LIGHT) {
+          RenderLight(*(const game_light*)payload, context);
+        } else {
+          UpdateCamera(*(const game_camera*)payload, context);
+        }
         break;
-    }
-  }
 
-#if HOKI_DEV
-  // DEBUG PASS
-  glUseProgram(context.SimpleShader.Id);
-  glDisable(GL_DEPTH_TEST);
-  for (uint32_t i = 0;
-       render_command* command = GetNextCommand(context.Commands, i++);) {
-    switch (command->Type) {
-      case DEBUG_RENDER_COMMAND_TYPE_CYCLE_SHADERS:
-        HOKI_ASSERT(false);
+      case RENDER_PASS_SHADOW:
+        RenderShadowmap(
+          *command->Map, context.Commands, context, windowInfo);
         break;
-      case DEBUG_RENDER_COMMAND_TYPE_BONES:
-        DEBUG_RenderBones(*command->Entity, context);
-        break;
-      case DEBUG_RENDER_COMMAND_TYPE_PHYSICS_BODY:
-        DEBUG_RenderPhysicsBody(*command->Body, context);
+
+      case RENDER_PASS_INSTANCED: {
+        AnimationSystem::baked_animation_run bakedRun;
+        const instanced_entity entity =
+          GetCommandInstancedEntity(*command, bakedRun);
+        const render_entity_state* state =
+          (const render_entity_state*)get_render_command_data(command);
+        BindBonePalette(context, GetSortKeySequence(entry.Key));
+        RenderPbrEntityInstanced(entity,
+                                 get_instance_ranges(state),
+                                 state->InstanceRangeCount,
+                                 context,
+                                 false);
+      } break;
+
+      case RENDER_PASS_ENTITY:
+        BindBonePalette(context, GetSortKeySequence(entry.Key));
+        RenderEntity(GetCommandEntity(*command), context, pbr, false);
         break;
-      case DEBUG_RENDER_COMMAND_TYPE_LINE:
-        DEBUG_RenderLine(*command->Line, context);
+
+      case RENDER_PASS_TRANSLUCENT:
+        BindBonePalette(context, GetSortKeySequence(entry.Key));
+        if (command->Type == RENDER_COMMAND_TYPE_INSTANCED) {
+          AnimationSystem::baked_animation_run bakedRun;
+          const instanced_entity entity =
+            GetCommandInstancedEntity(*command, bakedRun);
+          RenderEntity(entity, context, pbr, true);
+        } else {
+          RenderEntity(GetCommandEntity(*command), context, pbr, true);
+        }
         break;
-      case DEBUG_RENDER_COMMAND_TYPE_SET_WIREFRAME:
-        SetWireframe();
+
+      case RENDER_PASS_UI:
+        switch (command->Type) {
+          case RENDER_COMMAND_TYPE_UI_BUTTON:
+            RenderButton(*(const UISystem::ui_button*)payload, context);
+            break;
+          case RENDER_COMMAND_TYPE_UI_ICON:
+            RenderIcon(*(const UISystem::ui_icon*)payload, context);
+            break;
+          case RENDER_COMMAND_TYPE_UI_CONTEXT:
+            SetupUIContext(*command->UIContext, windowInfo, context);
+            break;
+          case RENDER_COMMAND_TYPE_UI_TOGGLE:
+            RenderToggle(*(const UISystem::ui_toggle*)payload, context);
+            break;
+          case RENDER_COMMAND_TYPE_UI_JOYSTICK:
+            RenderJoystick(*(const UISystem::ui_joystick*)payload, context);
+            break;
+          case RENDER_COMMAND_TYPE_UI_SLIDER:
+            RenderSlider(*(const UISystem::ui_slider*)payload, context);
+            break;
+
+          default:
+            break;
+        }
         break;
-      case DEBUG_RENDER_COMMAND_TYPE_LIGHT:
-        DEBUG_RenderLight(*command->Light, context);
+
+      case RENDER_PASS_TEXT:
+        RenderText((const UISystem::ui_text*)payload, windowInfo, context);
         break;
-      case DEBUG_RENDER_COMMAND_TYPE_CUBE:
-        DEBUG_RenderCube(*command->CubePos, context);
+
+#if HOKI_DEV
+      case RENDER_PASS_DEBUG:
+        switch (command->Type) {
+          case DEBUG_RENDER_COMMAND_TYPE_CYCLE_SHADERS:
+            HOKI_ASSERT(false);
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_BONES:
+            DEBUG_RenderBones(*command->Entity, context);
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_PHYSICS_BODY:
+            DEBUG_RenderPhysicsBody(*command->Body, context);
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_LINE:
+            DEBUG_RenderLine(*(const debug_render_line*)payload, context);
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_SET_WIREFRAME:
+            SetWireframe();
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_LIGHT:
+            DEBUG_RenderLight(*(const game_light*)payload, context);
+            InvalidateBoundState(context);
+            break;
+          case DEBUG_RENDER_COMMAND_TYPE_CUBE:
+            DEBUG_RenderCube(*(const v3*)payload, context);
+            break;
+
+          default:
+            break;
+        }
         break;
+#endif
 
       default:
         break;
     }
+
+    HOKI_ASSERT_NO_OPENGL_ERRORS();
   }
+  EndPass(currentPass, context);
+  EndGpuTimerFrame(context.GpuTimers);
+  if (!sceneResolved) {
+    ResolveSceneTarget(context, windowInfo);
+  }
+
+  // What the frame's draws did not need goes after them
+  UploadPendingResources(context, UPLOAD_FRAME_BYTES);
+  HOKI_ASSERT_NO_OPENGL_ERRORS();
+
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
   glEnable(GL_DEPTH_TEST);
-#endif
   glDisable(GL_BLEND);
 
   HOKI_ASSERT_NO_OPENGL_ERRORS();
@@ -13,17 +13,19 @@ static const int32_t HOKI_OGL_NO_ID = 0;
 static const int32_t HOKI_OGL_INVALID_ID = -1;
 
 const size_t MAX_LIGHTS = 4;
+// Matches MAX_SHADOW_CASCADES in frame_block.glsl
+const size_t MAX_SHADOW_CASCADES = 3;
 
 enum shader_uniform_type
 {
   SHADER_UNIFORM_UNSET,
   SHADER_UNIFORM_INT,
+  SHADER_UNIFORM_FLOAT,
   SHADER_UNIFORM_VEC2,
   SHADER_UNIFORM_VEC3,
   SHADER_UNIFORM_VEC4,
   SHADER_UNIFORM_MAT4,
   SHADER_UNIFORM_BOOL,
-  SHADER_UNIFORM_MAT4_ARRAY,
   SHADER_UNIFORM_STRUCT_MATERIAL,
   SHADER_UNIFORM_SAMPLER2D
 };
@@ -37,49 +39,83 @@ struct shader_uniform
 #endif
 };
 
-struct shader_uniform_light_base
+/**
+ * Uniform blocks, mirrored here with the std140 layout. The frame block is
+ * uploaded once per frame, each material gets a slot of its own and the bone
+ * palettes of a frame are streamed in with a single upload.
+ */
+enum uniform_block_binding
 {
-  int32_t ColorId;
-  int32_t AmbientId;
-  int32_t DiffuseId;
-  int32_t SpecularId;
+  UNIFORM_BLOCK_FRAME,
+  UNIFORM_BLOCK_MATERIAL,
+  UNIFORM_BLOCK_BONES
 };
 
-struct shader_uniform_light_dir_light : shader_uniform_light_base
+const size_t MAX_BONES = 60;
+const size_t MAX_MATERIAL_BLOCKS = 256;
+const size_t MAX_BONE_PALETTES = 64;
+const uint32_t NO_BONE_PALETTE = UINT32_MAX;
+
+struct uniform_block_dir_light
 {
-  int32_t DirectionId;
+  v3 Direction;
+  float Padding0;
+  v3 Color;
+  float Ambient;
+  float Diffuse;
+  float Specular;
+  float Padding1[2];
 };
 
-struct shader_uniform_light_point_light : shader_uniform_light_base
+struct uniform_block_point_light
 {
-  int32_t PositionId;
-  int32_t ConstantId;
-  int32_t LinearId;
-  int32_t QuadraticId;
+  v3 Position;
+  float Constant;
+  float Linear;
+  float Quadratic;
+  float Padding0[2];
+  v3 Color;
+  float Ambient;
+  float Diffuse;
+  float Specular;
+  float Padding1[2];
 };
 
-struct shader_uniform_lights
+struct uniform_block_frame
 {
-  shader_uniform_light_dir_light DirLight;
-  shader_uniform_light_point_light PointLights[MAX_LIGHTS];
-  size_t NextAvailablePointLight; // Tracks which light data to insert next
+  mat4x4 ViewProjection;
+  mat4x4 LightSpaceMatrices[MAX_SHADOW_CASCADES];
+  // View depth where each cascade ends, W is the cascade count
+  v4 CascadeSplits;
+  v3 CameraPos;
+  float ShadowFilterTaps;
+  uniform_block_dir_light DirLight;
+  uniform_block_point_light PointLights[MAX_LIGHTS];
 };
 
-struct shader_uniform_material
+struct uniform_block_material
 {
-  int32_t ShineId;
-
-  int32_t AlbedoId;
-  int32_t AlbedoMapId;
-  int32_t UseAlbedoMapId;
+  v3 Albedo;
+  float Shine;
+  float Metallic;
+  float Roughness;
+  float AmbientOcclusion;
+  uint32_t UseAlbedoMap;
+  uint32_t UseMetallicMap;
+  uint32_t UseRoughnessMap;
+  float Padding[2];
+};
 
-  int32_t MetallicId;
-  int32_t MetallicMapId;
-  int32_t UseMetallicMapId;
+const size_t BONE_BLOCK_SIZE = sizeof(mat4x4) * MAX_BONES;
 
-  int32_t RoughnessId;
-  int32_t RoughnessMapId;
-  int32_t UseRoughnessMapId;
+// Units the skinned shaders sample from, their samplers are set once at link
+enum texture_unit
+{
+  TEXTURE_UNIT_SHADOW_MAP,
+  TEXTURE_UNIT_ALBEDO_MAP,
+  TEXTURE_UNIT_METALLIC_MAP,
+  TEXTURE_UNIT_ROUGHNESS_MAP,
+  TEXTURE_UNIT_BAKED_POSE
 };
 
 struct ogl_shader_base
@@ -89,32 +125,36 @@ struct ogl_shader_base
   shader_uniform ViewProjection;
 };
 
+// View, lights and bones come from the uniform blocks
 struct ogl_skinned_shader : ogl_shader_base
 {
   shader_uniform HasBones;
-  shader_uniform Bones;
-  shader_uniform LightSpaceMatrix;
-  shader_uniform CameraPos;
-  shader_uniform_lights Lights;
-  shader_uniform_material Material;
   shader_uniform ShadowMap;
+  shader_uniform AlbedoMap;
+  shader_uniform MetallicMap;
+  shader_uniform RoughnessMap;
 };
 
 struct ogl_shader_animated_mesh : ogl_skinned_shader
-{
-  shader_uniform TextureDiffuse1;
-  shader_uniform TextureNormal1;
-};
+{};
 
 struct ogl_shader_pbr : ogl_skinned_shader
-{
-  shader_uniform TextureDiffuse1;
-};
+{};
 
 struct ogl_shader_pbr_instanced : ogl_shader_pbr
 {
   shader_uniform InstanceCount;
   shader_uniform InstanceSpacing;
+  shader_uniform InstanceOffset;
+  shader_uniform HasBakedPose;
+  shader_uniform BakedPose;
+  shader_uniform BakedFrameCount;
+  shader_uniform BakedFrame;
+};
+
+struct ogl_shader_shadow : ogl_shader_base
+{
+  shader_uniform HasBones;
 };
 
 struct ogl_shader_simple : ogl_shader_base
@@ -130,13 +170,13 @@ struct ogl_shader_simple_textured : ogl_shader_base
 struct ogl_shader_ui : ogl_shader_base
 {
   shader_uniform TextureDiffuse1;
-  shader_uniform TextureCoordOffset;
 };
 
 struct ogl_shader_text : ogl_shader_base
 {
   shader_uniform TextColor;
   shader_uniform CharacterTexture;
+  shader_uniform ShadowOffset;
 };
 
 struct ogl_shader_fill_reveal : ogl_shader_base
@@ -144,6 +184,159 @@ struct ogl_shader_fill_reveal : ogl_shader_base
   shader_uniform TextColor;
 };
 
+// Passes in the order RendererMain draws them, top bits of a sort key
+enum render_pass
+{
+  RENDER_PASS_NONE,
+  RENDER_PASS_SETUP,
+  RENDER_PASS_CAMERA,
+  RENDER_PASS_SHADOW,
+  RENDER_PASS_INSTANCED,
+  RENDER_PASS_ENTITY,
+  RENDER_PASS_TRANSLUCENT,
+  RENDER_PASS_UI,
+  RENDER_PASS_TEXT,
+  RENDER_PASS_DEBUG,
+  RENDER_PASS_COUNT
+};
+
+/**
+ * GL_TIME_ELAPSED queries around each pass, a set per frame in flight. A set
+ * is read when its frame comes around again, queries the GPU has not finished
+ * are left for later and their pass goes untimed, so nothing waits on them.
+ */
+const uint32_t GPU_TIMER_FRAMES = 3;
+
+struct gpu_pass_timers
+{
+  bool Checked;
+  bool Supported;
+  uint32_t Frame;
+  render_pass ActivePass;
+  uint32_t Queries[GPU_TIMER_FRAMES][RENDER_PASS_COUNT];
+  bool Pending[GPU_TIMER_FRAMES][RENDER_PASS_COUNT];
+  // GPU_TIMER_FRAMES frames old, 0 for passes that did not run
+  float PassMilliseconds[RENDER_PASS_COUNT];
+};
+
+/**
+ * Sort key layout, most significant first:
+ * pass 4 | stage 2 | shader 6 | material 24 | depth 11 | sequence 17
+ * Stage 0 holds per pass state like lights, stage 1 the draws. Shader is the
+ * PBR variant plus one, material the albedo texture handle over the model
+ * handle, 12 bits each. Passes where submission order matters leave them
+ * empty, the translucent pass puts its depth in the material bits. Sequence
+ * is the command's index in the stream, 17 bits hold RENDER_COMMAND_MAX_COUNT.
+ */
+struct render_sort_entry
+{
+  uint64_t Key;
+  const render_command* Command;
+};
+
+/**
+ * Glyphs of a glyph table share an atlas texture, packed on shelves that are
+ * filled left to right. A full atlas empties its least recently used shelf,
+ * and an atlas goes to another table when it is the least recently used.
+ */
+const uint32_t GLYPH_ATLAS_SIZE = 512;
+const size_t MAX_GLYPH_ATLASES = 4;
+const size_t MAX_GLYPH_ATLAS_SHELVES = 48;
+const size_t MAX_GLYPH_ATLAS_SLOTS = 512;
+// Glyphs per text draw, each one is drawn twice for the drop shadow
+const size_t MAX_TEXT_BATCH_GLYPHS = 1024;
+const size_t TEXT_VERTICES_PER_GLYPH = 12;
+
+struct glyph_atlas_shelf
+{
+  uint32_t Y;
+  uint32_t Height;
+  uint32_t CursorX;
+  uint32_t LastUsed;
+};
+
+struct glyph_atlas_slot
+{
+  uint32_t GlyphHandle;
+  uint32_t Shelf;
+  v2 UvMin;
+  v2 UvMax;
+};
+
+struct glyph_atlas
+{
+  const Asset::glyph_table* GlyphTable;
+  uint32_t TextureId;
+  uint32_t LastUsed;
+  uint32_t ShelfCount;
+  glyph_atlas_shelf Shelves[MAX_GLYPH_ATLAS_SHELVES];
+  glyph_atlas_slot Slots[MAX_GLYPH_ATLAS_SLOTS];
+};
+
+struct text_vertex
+{
+  v2 Position;
+  v2 TexCoords;
+  float Shadow;
+};
+
+/**
+ * UI images are packed into one atlas the first time one of them is uploaded.
+ * Widgets append their quads to a vertex buffer that is drawn when the texture
+ * or the UI context changes and at the end of the UI pass.
+ */
+const uint32_t UI_ATLAS_WIDTH = 2048;
+const uint32_t UI_ATLAS_MAX_HEIGHT = 2048;
+const uint32_t UI_ATLAS_PADDING = 1;
+const size_t MAX_UI_SPRITES = 64;
+const size_t MAX_UI_BATCH_QUADS = 256;
+
+// Where a UI image is drawn from, its own texture or a rect of the atlas
+struct ui_sprite
+{
+  uint32_t TextureId;
+  v2 UvMin;
+  v2 UvMax;
+};
+
+struct ui_vertex
+{
+  v2 Position;
+  v2 TexCoords;
+};
+
+/**
+ * Shadow cascades split the view from the near plane to the shadow distance
+ * and are square tiles of one depth texture, two tiles per row. The quality
+ * tier decides how many there are and their resolution.
+ */
+struct shadow_settings
+{
+  uint32_t CascadeCount;
+  uint32_t CascadeSize;
+};
+
+struct shadow_cascade
+{
+  float SplitDepth;
+  mat4x4 LightProjection;
+  bool Valid;
+  // Light space center, snapped to texels, and half the width of the tile
+  v3 LightCenter;
+  float Radius;
+  // Depth range of the projection, kept while the cascade fits inside it
+  float ClipNear;
+  float ClipFar;
+  // What the static caster tile, wider by the guard band, was drawn around
+  v3 StaticCenter;
+  mat4x4 StaticLightView;
+  bool StaticValid;
+};
+
+const size_t MAX_TEXTURE_UNITS = 8;
+// Translucent entities land in two passes
+const uint32_t RENDER_SORT_ENTRIES_PER_COMMAND = 2;
+
 struct render_context
 {
   bool Initialized;
@@ -154,16 +347,16 @@ struct render_context
   ogl_shader_simple_textured SimpleTexturedShader;
   ogl_shader_animated_mesh AnimatedMeshShader;
   ogl_shader_text TextShader;
-  ogl_shader_animated_mesh ShadowShader;
+  ogl_shader_shadow ShadowShader;
   ogl_shader_fill_reveal FillRevealShader;
   ogl_shader_ui UIShader;
-  ogl_shader_pbr PbrShader;
-  ogl_shader_pbr_instanced PbrInstancedShader;
+  // Indexed by Asset::pbr_variant_flags, Id stays 0 for variants not compiled
+  ogl_shader_pbr PbrShaders[Asset::PBR_VARIANT_COUNT];
+  ogl_shader_pbr_instanced PbrInstancedShaders[Asset::PBR_VARIANT_COUNT];
 
   int32_t PointPrimitive;
   int32_t LinePrimitive;
   int32_t RectPrimitive;
-  int32_t UIRectPrimitive;
   int32_t CubePrimitive;
   int32_t SpherePrimitive;
   int32_t TetrahedronPrimitive;
@@ -176,22 +369,82 @@ struct render_context
   mat4x4 ViewMatrix;
 
   render_command_buffer Commands;
+  // Reserved in the command stream's blocks every frame, see
+  // end_render_commands
+  render_sort_entry* SortedCommands;
+  uint32_t SortedCommandCount;
+  uint32_t SortedCommandCapacity;
   hash_table* RenderableStore;
-
-  int32_t ShadowMapNearTextureId;
-  int32_t ShadowMapNearFbo;
-  int32_t ShadowMapFarTextureId;
-  int32_t ShadowMapFarFbo;
+  render_residency* Residency;
+  shader_cache* ShaderCache;
+
+  // Last bound GL objects, lets the command walk skip redundant binds
+  uint32_t BoundProgram;
+  uint32_t BoundVertexArray;
+  uint32_t BoundTextures[MAX_TEXTURE_UNITS];
+  uint32_t ActiveTextureUnit;
+  uint32_t BoundMaterialBlock;
+  uint32_t BoundBonePalette;
+
+  // Uniform buffers, see uniform_block_binding
+  uint32_t UniformBufferAlignment;
+  uint32_t FrameBlockBuffer;
+  uniform_block_frame FrameBlock;
+  bool FrameBlockDirty;
+  uint32_t NextPointLight;
+  uint32_t MaterialBlockBuffer;
+  uint32_t MaterialBlockStride;
+  uint32_t MaterialBlockCount;
+  uint32_t BoneBlockBuffer;
+  uint32_t BoneBlockStride;
+  // Offset of each command's palette in the bone buffer, by stream index,
+  // reserved with SortedCommands
+  uint32_t* BonePaletteOffsets;
+  uint8_t BonePaletteStaging[MAX_BONE_PALETTES * BONE_BLOCK_SIZE];
+
+  // Pixel unpack buffer texture data is staged through
+  uint32_t UnpackBuffer;
+
+  // Text, LRU stamps count RenderText calls
+  glyph_atlas GlyphAtlases[MAX_GLYPH_ATLASES];
+  uint32_t TextClock;
+  uint32_t TextVertexArray;
+  uint32_t TextVertexBuffer;
+  text_vertex TextVertices[MAX_TEXT_BATCH_GLYPHS * TEXT_VERTICES_PER_GLYPH];
+
+  // UI, the resident id of a UI texture is its sprite index + 1
+  ui_sprite UISprites[MAX_UI_SPRITES];
+  uint32_t UISpriteCount;
+  uint32_t UIAtlasTextureId;
+  uint32_t UIVertexArray;
+  uint32_t UIVertexBuffer;
+  uint32_t UIBatchTexture;
+  const UISystem::ui_context* UIBatchContext;
+  uint32_t UIVertexCount;
+  ui_vertex UIVertices[MAX_UI_BATCH_QUADS * 6];
+
+  shadow_settings ShadowSettings;
+  shadow_cascade ShadowCascades[MAX_SHADOW_CASCADES];
+  uint32_t ShadowFrame;
+  int32_t ShadowMapTextureId;
+  int32_t ShadowMapFbo;
+  // Depth of the casters flagged RENDER_STATIC, same layout as the shadow map
+  int32_t ShadowMapStaticTextureId;
+  int32_t ShadowMapStaticFbo;
+  uint32_t StaticShadowCasterCount;
   mat4x4 LightViewMatrix;
-  mat4x4 LightProjectionMatrix;
 
-  mat4x4 DebugProjection;
-  bool HighQuality;
+  // The scene renders here when the tier scales it below the window size
+  int32_t SceneFbo;
+  int32_t SceneTextureId;
+  int32_t SceneDepthTextureId;
+  uint32_t SceneWidth;
+  uint32_t SceneHeight;
+
+  gpu_pass_timers GpuTimers;
 
-  mat4x4 ShadowNearProjection;
-  mat4x4 ShadowFarProjection;
-  mat4x4 ShadowOrthoProjection;
-  float ShadowOrthoRadius;
+  mat4x4 DebugProjection;
+  render_quality Quality;
 };
 
 #define RENDERER_MAIN(name)                                                    \
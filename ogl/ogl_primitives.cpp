@@ -88,6 +88,12 @@ static void DEBUG_RenderLine(const debug_render_line& line,
   DEBUG_RenderLine(line, context, _v3(1.0f, 0.0f, 1.0f));
 }
 
+// Corners of BindRect, for quads built on the CPU
+static const v2 RECT_CORNERS[6] = {
+  { { 0.0f, 0.0f } }, { { 0.0f, 1.0f } }, { { 1.0f, 0.0f } },
+  { { 0.0f, 1.0f } }, { { 1.0f, 0.0f } }, { { 1.0f, 1.0f } }
+};
+
 static uint32_t BindRect(render_context& context)
 {
   if (context.RectPrimitive != HOKI_OGL_NO_ID) {
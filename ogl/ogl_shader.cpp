@@ -1,88 +1,61 @@
+/** Bound state cache */
+static const uint32_t BOUND_STATE_UNKNOWN = UINT32_MAX;
 
-static const shader_uniform_lights SetupLightUniform(const GLuint programId)
+// Call after anything that binds GL objects without going through the cache
+static void InvalidateBoundState(render_context& context)
 {
-  HOKI_WARN(programId >= HOKI_OGL_NO_ID);
-  shader_uniform_lights result = {};
-  result.DirLight.DirectionId =
-    glGetUniformLocation(programId, "uDirLight.Direction");
-  result.DirLight.ColorId = glGetUniformLocation(programId, "uDirLight.Color");
-  result.DirLight.AmbientId =
-    glGetUniformLocation(programId, "uDirLight.Ambient");
-  result.DirLight.DiffuseId =
-    glGetUniformLocation(programId, "uDirLight.Diffuse");
-  result.DirLight.SpecularId =
-    glGetUniformLocation(programId, "uDirLight.Specular");
-
-  HOKI_WARN(result.DirLight.DirectionId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.DirLight.ColorId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.DirLight.AmbientId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.DirLight.DiffuseId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.DirLight.SpecularId >= HOKI_OGL_NO_ID);
-
-  for (size_t i = 0; i < MAX_LIGHTS; i++) {
-    std::string name = "uPointLights[" + std::to_string(i) + "]";
-    result.PointLights[i].PositionId =
-      glGetUniformLocation(programId, (name + ".Position").c_str());
-    result.PointLights[i].ColorId =
-      glGetUniformLocation(programId, (name + ".Color").c_str());
-    result.PointLights[i].AmbientId =
-      glGetUniformLocation(programId, (name + ".Ambient").c_str());
-    result.PointLights[i].DiffuseId =
-      glGetUniformLocation(programId, (name + ".Diffuse").c_str());
-    result.PointLights[i].SpecularId =
-      glGetUniformLocation(programId, (name + ".Specular").c_str());
-    result.PointLights[i].ConstantId =
-      glGetUniformLocation(programId, (name + ".Constant").c_str());
-    result.PointLights[i].LinearId =
-      glGetUniformLocation(programId, (name + ".Linear").c_str());
-    result.PointLights[i].QuadraticId =
-      glGetUniformLocation(programId, (name + ".Quadratic").c_str());
-
-    HOKI_WARN(result.PointLights[i].PositionId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].AmbientId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].DiffuseId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].SpecularId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].ConstantId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].LinearId >= HOKI_OGL_NO_ID);
-    HOKI_WARN(result.PointLights[i].QuadraticId >= HOKI_OGL_NO_ID);
-  }
-  result.NextAvailablePointLight = 0;
+  context.BoundProgram = BOUND_STATE_UNKNOWN;
+  context.BoundVertexArray = BOUND_STATE_UNKNOWN;
+  for (size_t i = 0; i < MAX_TEXTURE_UNITS; i++) {
+    context.BoundTextures[i] = BOUND_STATE_UNKNOWN;
+  }
+  context.ActiveTextureUnit = BOUND_STATE_UNKNOWN;
+  context.BoundMaterialBlock = BOUND_STATE_UNKNOWN;
+  context.BoundBonePalette = BOUND_STATE_UNKNOWN;
+}
 
-  return result;
+static void UseProgram(render_context& context, const uint32_t programId)
+{
+  if (context.BoundProgram != programId) {
+    glUseProgram(programId);
+    context.BoundProgram = programId;
+  }
 }
 
-static const shader_uniform_material SetupMaterialUniform(
-  const GLuint programId)
+static void BindVertexArray(render_context& context, const uint32_t vao)
 {
-  HOKI_WARN(programId >= HOKI_OGL_NO_ID);
-  shader_uniform_material result = {};
-  result.ShineId = glGetUniformLocation(programId, "uMaterial.Shine");
-
-  result.AlbedoId = glGetUniformLocation(programId, "uMaterial.Albedo");
-  result.AlbedoMapId = glGetUniformLocation(programId, "uMaterial.AlbedoMap");
-  result.UseAlbedoMapId =
-    glGetUniformLocation(programId, "uMaterial.UseAlbedoMap");
-
-  result.MetallicId = glGetUniformLocation(programId, "uMaterial.Metallic");
-  result.MetallicMapId =
-    glGetUniformLocation(programId, "uMaterial.MetallicMap");
-  result.UseMetallicMapId =
-    glGetUniformLocation(programId, "uMaterial.UseMetallicMap");
-
-  result.RoughnessId = glGetUniformLocation(programId, "uMaterial.Roughness");
-  result.RoughnessMapId =
-    glGetUniformLocation(programId, "uMaterial.RoughnessMap");
-  result.UseRoughnessMapId =
-    glGetUniformLocation(programId, "uMaterial.UseRoughnessMap");
-
-  HOKI_WARN(result.ShineId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.AlbedoId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.MetallicId >= HOKI_OGL_NO_ID);
-  HOKI_WARN(result.RoughnessId >= HOKI_OGL_NO_ID);
+  if (context.BoundVertexArray != vao) {
+    glBindVertexArray(vao);
+    context.BoundVertexArray = vao;
+  }
+}
 
-  return result;
+static void BindTexture2D(render_context& context,
+                          const uint32_t unit,
+                          const uint32_t textureId)
+{
+  HOKI_ASSERT(unit < MAX_TEXTURE_UNITS);
+  if (context.BoundTextures[unit] == textureId) {
+    return;
+  }
+  if (context.ActiveTextureUnit != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    context.ActiveTextureUnit = unit;
+  }
+  glBindTexture(GL_TEXTURE_2D, textureId);
+  context.BoundTextures[unit] = textureId;
+}
+
+/** Residency */
+// GL object behind a handle, HOKI_OGL_NO_ID until it is first created
+static uint32_t& GetResidentId(render_context& context, const uint32_t handle)
+{
+  HOKI_ASSERT(handle != RENDER_NO_HANDLE &&
+              handle <= context.Residency->HandleCount);
+  return context.Residency->Ids[handle];
 }
 
+
 static const shader_uniform SetupUniform(const GLuint programId,
                                          const char* name,
                                          const shader_uniform_type type)
@@ -100,30 +73,25 @@ static const shader_uniform SetupUniform(const GLuint programId,
   return result;
 }
 
+// Errors are checked once per command by the render walk, not per upload
 static void SetUniform(const shader_uniform uniform,
                        const mat4x4* mat4,
                        const size_t count)
 {
-  HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_MAT4 ||
-              uniform.Type == SHADER_UNIFORM_MAT4_ARRAY);
-#ifdef GL_ES_VERSION_3_0
-  if (uniform.Type == SHADER_UNIFORM_MAT4_ARRAY) {
-    glUniform4fv(uniform.Id, (GLsizei)(4 * count), (GLfloat*)mat4->S);
-  } else {
-    glUniformMatrix4fv(uniform.Id, (GLsizei)count, false, (GLfloat*)mat4->S);
-  }
-#else
+  HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_MAT4);
   glUniformMatrix4fv(uniform.Id, (GLsizei)count, false, (GLfloat*)mat4->S);
-#endif
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
 static void SetUniform(const shader_uniform uniform, const int value)
 {
   HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_INT);
   glUniform1i(uniform.Id, value);
+}
 
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
+static void SetUniform(const shader_uniform uniform, const float value)
+{
+  HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_FLOAT);
+  glUniform1f(uniform.Id, value);
 }
 
 static void SetUniform(const shader_uniform uniform,
@@ -132,8 +100,6 @@ static void SetUniform(const shader_uniform uniform,
 {
   HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_VEC2);
   glUniform2fv(uniform.Id, (GLsizei)count, vec2->E);
-
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
 static void SetUniform(const shader_uniform uniform,
@@ -142,8 +108,6 @@ static void SetUniform(const shader_uniform uniform,
 {
   HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_VEC3);
   glUniform3fv(uniform.Id, (GLsizei)count, vec3->E);
-
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
 static void SetUniform(const shader_uniform uniform,
@@ -152,107 +116,558 @@ static void SetUniform(const shader_uniform uniform,
 {
   HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_VEC4);
   glUniform4fv(uniform.Id, (GLsizei)count, vec4->E);
-
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
 static void SetUniform(const shader_uniform uniform, const bool value)
 {
   HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_BOOL);
   glUniform1i(uniform.Id, value ? 1 : 0);
+}
+
+static void SetSamplerUniform(const shader_uniform uniform, GLint value)
+{
+  HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_SAMPLER2D);
+  glUniform1i(uniform.Id, value);
+}
 
+static void SetupUniformBlock(const GLuint programId,
+                              const char* name,
+                              const uniform_block_binding binding)
+{
+  const GLuint index = glGetUniformBlockIndex(programId, name);
+  HOKI_WARN_MESSAGE(index != GL_INVALID_INDEX, name, 0);
+  if (index != GL_INVALID_INDEX) {
+    glUniformBlockBinding(programId, index, (GLuint)binding);
+  }
   HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
-static void SetUniform(shader_uniform_lights& uniform, const game_light* light)
+// Variants leave out what they do not use, setting those does nothing
+static const shader_uniform SetupVariantUniform(const GLuint programId,
+                                                const char* name,
+                                                const shader_uniform_type type,
+                                                const bool used)
 {
-  switch (light->LightType) {
-    case LIGHT_TYPE_DIRECTION:
-      glUniform3fv(
-        uniform.DirLight.DirectionId, (GLsizei)1, (GLfloat*)light->Vector.E);
-      glUniform3fv(uniform.DirLight.ColorId, 1, (GLfloat*)light->Color.E);
-      glUniform1f(uniform.DirLight.AmbientId, light->Ambient);
-      glUniform1f(uniform.DirLight.DiffuseId, light->Diffuse);
-      glUniform1f(uniform.DirLight.SpecularId, light->Specular);
-      break;
+  if (used) {
+    return SetupUniform(programId, name, type);
+  }
 
-    case LIGHT_TYPE_POINT: {
-      size_t idx = (uniform.NextAvailablePointLight++) % MAX_LIGHTS;
-      glUniform3fv(uniform.PointLights[idx].PositionId,
-                   (GLsizei)1,
-                   (GLfloat*)light->Vector.E);
-      glUniform3fv(
-        uniform.PointLights[idx].ColorId, 1, (GLfloat*)light->Color.E);
-      glUniform1f(uniform.PointLights[idx].AmbientId, light->Ambient);
-      glUniform1f(uniform.PointLights[idx].DiffuseId, light->Diffuse);
-      glUniform1f(uniform.PointLights[idx].SpecularId, light->Specular);
-      glUniform1f(uniform.PointLights[idx].ConstantId, light->Constant);
-      glUniform1f(uniform.PointLights[idx].LinearId, light->Linear);
-      glUniform1f(uniform.PointLights[idx].QuadraticId, light->Quadratic);
-    } break;
+  shader_uniform result = {};
+  result.Id = HOKI_OGL_INVALID_ID;
+  result.Type = type;
+#if HOKI_DEV
+  result.Name = (char*)name;
+#endif
 
-    default:
-      HOKI_ASSERT_MESSAGE(false, "Undefined light type");
+  return result;
+}
+
+/**
+ * The animated mesh program branches on uHasBones and samples the albedo map,
+ * a PBR variant has the skinning and material maps its flags name built in.
+ */
+static void SetupSkinnedShader(const GLuint programId,
+                               const ogl_shader_program& program,
+                               ogl_skinned_shader& shader)
+{
+  const bool animatedMesh = program.Type == Asset::SHADER_TYPE_ANIMATED_MESH;
+  const uint32_t variant =
+    animatedMesh ? (uint32_t)Asset::PBR_VARIANT_ALBEDO_MAP
+                 : (uint32_t)program.Variant;
+
+  shader.Id = programId;
+  shader.ModelMatrix =
+    SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
+  shader.HasBones = SetupVariantUniform(
+    programId, "uHasBones", SHADER_UNIFORM_BOOL, animatedMesh);
+  shader.ShadowMap =
+    SetupUniform(programId, "uShadowMap", SHADER_UNIFORM_SAMPLER2D);
+  shader.AlbedoMap =
+    SetupVariantUniform(programId,
+                        "uAlbedoMap",
+                        SHADER_UNIFORM_SAMPLER2D,
+                        variant & Asset::PBR_VARIANT_ALBEDO_MAP);
+  shader.MetallicMap =
+    SetupVariantUniform(programId,
+                        "uMetallicMap",
+                        SHADER_UNIFORM_SAMPLER2D,
+                        variant & Asset::PBR_VARIANT_METALLIC_MAP);
+  shader.RoughnessMap =
+    SetupVariantUniform(programId,
+                        "uRoughnessMap",
+                        SHADER_UNIFORM_SAMPLER2D,
+                        variant & Asset::PBR_VARIANT_ROUGHNESS_MAP);
+  SetSamplerUniform(shader.ShadowMap, TEXTURE_UNIT_SHADOW_MAP);
+  SetSamplerUniform(shader.AlbedoMap, TEXTURE_UNIT_ALBEDO_MAP);
+  SetSamplerUniform(shader.MetallicMap, TEXTURE_UNIT_METALLIC_MAP);
+  SetSamplerUniform(shader.RoughnessMap, TEXTURE_UNIT_ROUGHNESS_MAP);
+
+  SetupUniformBlock(programId, "FrameBlock", UNIFORM_BLOCK_FRAME);
+  SetupUniformBlock(programId, "MaterialBlock", UNIFORM_BLOCK_MATERIAL);
+  if (animatedMesh || (variant & Asset::PBR_VARIANT_SKINNED)) {
+    SetupUniformBlock(programId, "BoneBlock", UNIFORM_BLOCK_BONES);
   }
+}
+
+/** Uniform buffers */
+
+static uint32_t AlignUniformOffset(const render_context& context,
+                                   const size_t size)
+{
+  const uint32_t alignment = context.UniformBufferAlignment;
+  return (uint32_t)((size + alignment - 1) / alignment * alignment);
+}
 
+static void SetupUniformBlocks(render_context& context)
+{
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  context.UniformBufferAlignment = alignment > 16 ? (uint32_t)alignment : 16;
+  context.MaterialBlockStride =
+    AlignUniformOffset(context, sizeof(uniform_block_material));
+  context.BoneBlockStride = AlignUniformOffset(context, BONE_BLOCK_SIZE);
+
+  GLuint buffers[3];
+  glGenBuffers(3, buffers);
+  context.FrameBlockBuffer = buffers[0];
+  context.MaterialBlockBuffer = buffers[1];
+  context.BoneBlockBuffer = buffers[2];
+
+  glBindBuffer(GL_UNIFORM_BUFFER, context.FrameBlockBuffer);
+  glBufferData(GL_UNIFORM_BUFFER,
+               sizeof(uniform_block_frame),
+               nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(
+    GL_UNIFORM_BUFFER, UNIFORM_BLOCK_FRAME, context.FrameBlockBuffer);
+  context.FrameBlockDirty = true;
+
+  // Slot 0 is for primitives without a material, they sample their texture
+  uniform_block_material defaultMaterial = {};
+  defaultMaterial.Albedo = _v3(1.0f);
+  defaultMaterial.UseAlbedoMap = 1;
+  glBindBuffer(GL_UNIFORM_BUFFER, context.MaterialBlockBuffer);
+  glBufferData(GL_UNIFORM_BUFFER,
+               context.MaterialBlockStride * MAX_MATERIAL_BLOCKS,
+               nullptr,
+               GL_STATIC_DRAW);
+  glBufferSubData(
+    GL_UNIFORM_BUFFER, 0, sizeof(defaultMaterial), &defaultMaterial);
+  context.MaterialBlockCount = 1;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, context.BoneBlockBuffer);
+  glBufferData(GL_UNIFORM_BUFFER,
+               sizeof(context.BonePaletteStaging),
+               nullptr,
+               GL_STREAM_DRAW);
+
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
   HOKI_ASSERT_NO_OPENGL_ERRORS();
 }
 
-static void SetUniform(const shader_uniform_material uniform,
-                       const Asset::material* const material,
-                       const int32_t albedoMapId,
-                       const int32_t roughnessMapId,
-                       const int32_t metallicMapId,
-                       const int32_t samplerStartIndex,
-                       const size_t count)
+static void FlushFrameBlock(render_context& context)
 {
-  HOKI_ASSERT(count == 1);
-  glUniform1f(uniform.ShineId, material->Shine);
-  glUniform3fv(uniform.AlbedoId, 1, &material->Albedo.E[0]);
+  if (!context.FrameBlockDirty) {
+    return;
+  }
 
-  int32_t textureIndex = samplerStartIndex;
-  if (albedoMapId != HOKI_OGL_INVALID_ID) {
-    glActiveTexture(GL_TEXTURE0 + textureIndex);
-    glBindTexture(GL_TEXTURE_2D, albedoMapId);
-    glUniform1i(uniform.AlbedoMapId, textureIndex);
-    textureIndex++;
+  uniform_block_frame& frame = context.FrameBlock;
+  frame.ViewProjection = context.ProjectionMatrix * context.ViewMatrix;
+  const uint32_t cascadeCount = context.ShadowSettings.CascadeCount;
+  for (uint32_t i = 0; i < cascadeCount; i++) {
+    frame.LightSpaceMatrices[i] = context.ShadowCascades[i].LightProjection;
+    frame.CascadeSplits.E[i] = context.ShadowCascades[i].SplitDepth;
   }
-  glUniform1i(uniform.UseAlbedoMapId,
-              (albedoMapId != HOKI_OGL_INVALID_ID) ? 1 : 0);
+  frame.CascadeSplits.W = (float)cascadeCount;
+  frame.ShadowFilterTaps =
+    (float)RENDER_QUALITY_TIERS[context.Quality].ShadowFilterTaps;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, context.FrameBlockBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+  context.FrameBlockDirty = false;
+}
 
-  glUniform1f(uniform.MetallicId, material->Metallic);
-  if (metallicMapId != HOKI_OGL_INVALID_ID) {
-    glActiveTexture(GL_TEXTURE0 + textureIndex);
-    glBindTexture(GL_TEXTURE_2D, metallicMapId);
-    glUniform1i(uniform.MetallicMapId, textureIndex);
-    textureIndex++;
+static void WriteMaterialBlock(render_context& context,
+                               const uint32_t slot,
+                               const Asset::material& material)
+{
+  uniform_block_material block = {};
+  block.Albedo = material.Albedo;
+  block.Shine = material.Shine;
+  block.Metallic = material.Metallic;
+  block.Roughness = material.Roughness;
+  block.AmbientOcclusion = material.AmbientOcclusion;
+  block.UseAlbedoMap = material.AlbedoMap != nullptr;
+  block.UseMetallicMap = material.MetallicMap != nullptr;
+  block.UseRoughnessMap = material.RoughnessMap != nullptr;
+
+  glBindBuffer(GL_UNIFORM_BUFFER, context.MaterialBlockBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER,
+                  (GLintptr)slot * context.MaterialBlockStride,
+                  sizeof(block),
+                  &block);
+}
+
+/** Pixel unpack buffer */
+/**
+ * Copies texture data into a freshly orphaned unpack buffer, the texture call
+ * that follows then only queues a transfer from it and the copy does not wait
+ * on the GPU. Returns what to pass the call as its pixels, offset 0 of the
+ * buffer or the client memory when mapping failed. Call EndStagePixels after.
+ */
+static const void* StagePixels(render_context& context,
+                               const void* pixels,
+                               const size_t size,
+                               const size_t bufferSize)
+{
+  if (context.UnpackBuffer == HOKI_OGL_NO_ID) {
+    glGenBuffers(1, &context.UnpackBuffer);
   }
-  glUniform1i(uniform.UseMetallicMapId,
-              (metallicMapId != HOKI_OGL_INVALID_ID) ? 1 : 0);
 
-  glUniform1f(uniform.RoughnessId, material->Roughness);
-  if (roughnessMapId != HOKI_OGL_INVALID_ID) {
-    glActiveTexture(GL_TEXTURE0 + textureIndex);
-    glBindTexture(GL_TEXTURE_2D, roughnessMapId);
-    glUniform1i(uniform.RoughnessMapId, textureIndex);
-    textureIndex++;
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context.UnpackBuffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+  void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                   0,
+                                   size,
+                                   GL_MAP_WRITE_BIT |
+                                     GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (staging == nullptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return pixels;
   }
-  glUniform1i(uniform.UseRoughnessMapId,
-              (roughnessMapId != HOKI_OGL_INVALID_ID) ? 1 : 0);
 
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
+  memcpy(staging, pixels, size);
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return pixels;
+  }
+
+  return (const void*)0;
 }
 
-static void SetSamplerUniform(const shader_uniform uniform, GLint value)
+static void EndStagePixels()
 {
-  HOKI_ASSERT(uniform.Type == SHADER_UNIFORM_SAMPLER2D);
-  glUniform1i(uniform.Id, value);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
 
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
+// Rows are padded to the default unpack alignment of 4, the buffer has to
+// cover what the texture call reads
+static size_t GetImageBufferBytes(const Asset::image_texture& image)
+{
+  const size_t rowBytes = (size_t)image.PixelSize.X * image.Components;
+  return ((rowBytes + 3) & ~(size_t)3) * (size_t)image.PixelSize.Y;
 }
 
-static void CreateShader(const ogl_shader_program program,
-                         render_context& context)
+// Fills the bound texture, DDS images carry their mip chain
+static void UploadTextureData(render_context& context,
+                              const Asset::texture& texture)
+{
+  HOKI_ASSERT(texture.Type != Asset::TEXTURE_TYPE_INVALID);
+  if (texture.Type == Asset::TEXTURE_TYPE_DDS) {
+    const Asset::DDS_Image& image = *texture.DDSImage;
+    for (uint32_t i = 0; i <= image.SurfaceCount; i++) {
+      const Asset::DDS_Surface& surface = image.Surfaces[i];
+      glCompressedTexImage2D(
+        GL_TEXTURE_2D,
+        i,
+        image.Format,
+        surface.Width,
+        surface.Height,
+        0,
+        surface.Size,
+        StagePixels(context, surface.Pixels, surface.Size, surface.Size));
+      EndStagePixels();
+    }
+  } else if (texture.Type == Asset::TEXTURE_TYPE_IMAGE) {
+    const Asset::image_texture& image = *texture.Image;
+    if (image.Memory) {
+      GLenum format = GL_RED;
+      if (image.Components == 1) {
+        format = GL_RED;
+      } else if (image.Components == 3) {
+        format = GL_RGB;
+      } else if (image.Components == 4) {
+        format = GL_RGBA;
+      }
+
+      const size_t size =
+        (size_t)image.PixelSize.X * image.PixelSize.Y * image.Components;
+      glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        format,
+        (int)image.PixelSize.X,
+        (int)image.PixelSize.Y,
+        0,
+        format,
+        GL_UNSIGNED_BYTE,
+        StagePixels(context, image.Memory, size, GetImageBufferBytes(image)));
+      EndStagePixels();
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+  }
+}
+
+/**
+ * Materials are uploaded the first time they are drawn and keep their slot,
+ * after that a draw only binds the range. Once the slots run out the last one
+ * is rewritten per draw.
+ */
+static void BindMaterialBlock(render_context& context,
+                              const Asset::material* const material)
+{
+  uint32_t slot = 0;
+  if (material != nullptr && material->RenderHandle == RENDER_NO_HANDLE) {
+    slot = MAX_MATERIAL_BLOCKS - 1;
+    WriteMaterialBlock(context, slot, *material);
+  } else if (material != nullptr) {
+    uint32_t& residentSlot = GetResidentId(context, material->RenderHandle);
+    if (residentSlot != HOKI_OGL_NO_ID) {
+      slot = residentSlot - 1;
+    } else if (context.MaterialBlockCount < MAX_MATERIAL_BLOCKS - 1) {
+      slot = context.MaterialBlockCount++;
+      residentSlot = slot + 1;
+      WriteMaterialBlock(context, slot, *material);
+    } else {
+      HOKI_WARN_MESSAGE(false,
+                        "Material slots full (%u)",
+                        context.MaterialBlockCount);
+      slot = MAX_MATERIAL_BLOCKS - 1;
+      WriteMaterialBlock(context, slot, *material);
+    }
+  }
+
+  if (context.BoundMaterialBlock != slot) {
+    glBindBufferRange(GL_UNIFORM_BUFFER,
+                      UNIFORM_BLOCK_MATERIAL,
+                      context.MaterialBlockBuffer,
+                      (GLintptr)slot * context.MaterialBlockStride,
+                      sizeof(uniform_block_material));
+    context.BoundMaterialBlock = slot;
+  }
+}
+
+static bool HasBonePalette(const render_command& command)
+{
+  if (command.Type != RENDER_COMMAND_TYPE_ENTITY &&
+      command.Type != RENDER_COMMAND_TYPE_INSTANCED) {
+    return false;
+  }
+
+  const render_entity_state* state =
+    (const render_entity_state*)get_render_command_data(&command);
+  return state->BoneCount > 0;
+}
+
+/**
+ * Copies the bone palettes of the frame's entity commands next to each other
+ * and uploads them at once, draws then bind their range of the buffer. The
+ * buffer grows to fit every palette, past MAX_BONE_PALETTES they go up a
+ * staging buffer at a time.
+ */
+static void UploadBonePalettes(render_context& context)
+{
+  const uint32_t capacity =
+    (uint32_t)(sizeof(context.BonePaletteStaging) / context.BoneBlockStride);
+  uint32_t paletteCount = 0;
+  for (const render_command* command =
+         get_next_render_command(context.Commands, nullptr);
+       command != nullptr;
+       command = get_next_render_command(context.Commands, command)) {
+    paletteCount += HasBonePalette(*command) ? 1 : 0;
+  }
+
+  // Orphans last frame's palettes, draws that have none keep the first bound
+  const uint32_t bufferCount = paletteCount > 0 ? paletteCount : 1;
+  const bool chunked = paletteCount > capacity;
+  glBindBuffer(GL_UNIFORM_BUFFER, context.BoneBlockBuffer);
+  if (chunked) {
+    glBufferData(GL_UNIFORM_BUFFER,
+                 bufferCount * context.BoneBlockStride,
+                 nullptr,
+                 GL_STREAM_DRAW);
+  }
+
+  uint32_t paletteIndex = 0;
+  uint32_t stagedCount = 0;
+  uint32_t i = 0;
+  for (const render_command* command =
+         get_next_render_command(context.Commands, nullptr);
+       command != nullptr;
+       command = get_next_render_command(context.Commands, command), i++) {
+    context.BonePaletteOffsets[i] = NO_BONE_PALETTE;
+    if (!HasBonePalette(*command)) {
+      continue;
+    }
+
+    if (stagedCount == capacity) {
+      glBufferSubData(
+        GL_UNIFORM_BUFFER,
+        (GLintptr)(paletteIndex - stagedCount) * context.BoneBlockStride,
+        stagedCount * context.BoneBlockStride,
+        context.BonePaletteStaging);
+      stagedCount = 0;
+    }
+
+    const render_entity_state* state =
+      (const render_entity_state*)get_render_command_data(command);
+    HOKI_WARN_MESSAGE(state->BoneCount <= MAX_BONES,
+                      "Too many bones (%u)",
+                      state->BoneCount);
+    const uint32_t boneCount =
+      state->BoneCount < MAX_BONES ? state->BoneCount : (uint32_t)MAX_BONES;
+    memcpy(context.BonePaletteStaging + stagedCount * context.BoneBlockStride,
+           state + 1,
+           sizeof(mat4x4) * boneCount);
+    context.BonePaletteOffsets[i] = paletteIndex * context.BoneBlockStride;
+    paletteIndex++;
+    stagedCount++;
+  }
+
+  if (!chunked) {
+    glBufferData(GL_UNIFORM_BUFFER,
+                 bufferCount * context.BoneBlockStride,
+                 context.BonePaletteStaging,
+                 GL_STREAM_DRAW);
+  } else if (stagedCount > 0) {
+    glBufferSubData(
+      GL_UNIFORM_BUFFER,
+      (GLintptr)(paletteIndex - stagedCount) * context.BoneBlockStride,
+      stagedCount * context.BoneBlockStride,
+      context.BonePaletteStaging);
+  }
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    UNIFORM_BLOCK_BONES,
+                    context.BoneBlockBuffer,
+                    0,
+                    BONE_BLOCK_SIZE);
+  context.BoundBonePalette = 0;
+}
+
+static void BindBonePalette(render_context& context,
+                            const uint32_t commandIndex)
+{
+  HOKI_ASSERT(commandIndex < context.Commands.Count);
+  const uint32_t offset = context.BonePaletteOffsets[commandIndex];
+  if (offset == NO_BONE_PALETTE || context.BoundBonePalette == offset) {
+    return;
+  }
+
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    UNIFORM_BLOCK_BONES,
+                    context.BoneBlockBuffer,
+                    offset,
+                    BONE_BLOCK_SIZE);
+  context.BoundBonePalette = offset;
+}
+
+/**
+ * Shader program binaries
+ */
+static uint32_t HashBytes(uint32_t hash, const void* data, const size_t size)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static uint32_t HashString(const uint32_t hash, const char* string)
+{
+  return string != nullptr ? HashBytes(hash, string, strlen(string)) : hash;
+}
+
+static uint32_t GetProgramSourceHash(const ogl_shader_program& program)
+{
+  uint32_t hash = 2166136261u;
+  hash = HashString(hash, program.VertexShader->Memory);
+  hash = HashString(hash, program.FragmentShader->Memory);
+
+  return hash;
+}
+
+// A driver update invalidates every binary it did not produce
+static void ValidateShaderCache(shader_cache& cache)
+{
+  uint32_t driverHash = 2166136261u;
+  driverHash = HashString(driverHash, (const char*)glGetString(GL_VENDOR));
+  driverHash = HashString(driverHash, (const char*)glGetString(GL_RENDERER));
+  driverHash = HashString(driverHash, (const char*)glGetString(GL_VERSION));
+  if (cache.DriverHash != driverHash) {
+    cache.DriverHash = driverHash;
+    cache.EntryCount = 0;
+    cache.DataSize = 0;
+  }
+}
+
+// Returns HOKI_OGL_NO_ID when the program has to be linked from source
+static GLuint LoadCachedProgram(shader_cache& cache, const uint32_t sourceHash)
+{
+  for (uint32_t i = 0; i < cache.EntryCount; i++) {
+    const shader_cache_entry& entry = cache.Entries[i];
+    if (entry.SourceHash != sourceHash) {
+      continue;
+    }
+
+    GLuint programId = glCreateProgram();
+    glProgramBinary(
+      programId, entry.Format, cache.Data + entry.Offset, entry.Size);
+    int programLinkSuccess;
+    glGetProgramiv(programId, GL_LINK_STATUS, &programLinkSuccess);
+    if (programLinkSuccess) {
+      return programId;
+    }
+
+    // The driver rejected its own binary, start the cache over
+    glDeleteProgram(programId);
+    cache.EntryCount = 0;
+    cache.DataSize = 0;
+    cache.Dirty = true;
+    break;
+  }
+
+  return HOKI_OGL_NO_ID;
+}
+
+static void StoreProgramBinary(shader_cache& cache,
+                               const GLuint programId,
+                               const uint32_t sourceHash)
+{
+  GLint size = 0;
+  glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0 || (size_t)size > SHADER_CACHE_MAX_BYTES) {
+    return;
+  }
+
+  // Edited shaders leave old binaries behind, a full cache starts over
+  if (cache.EntryCount == SHADER_CACHE_MAX_PROGRAMS ||
+      cache.DataSize + (size_t)size > SHADER_CACHE_MAX_BYTES) {
+    cache.EntryCount = 0;
+    cache.DataSize = 0;
+  }
+
+  shader_cache_entry& entry = cache.Entries[cache.EntryCount];
+  GLenum format;
+  GLsizei written = 0;
+  glGetProgramBinary(
+    programId, size, &written, &format, cache.Data + cache.DataSize);
+  if (written <= 0) {
+    return;
+  }
+
+  entry.SourceHash = sourceHash;
+  entry.Format = format;
+  entry.Offset = cache.DataSize;
+  entry.Size = (uint32_t)written;
+  cache.EntryCount++;
+  cache.DataSize += (uint32_t)written;
+  cache.Dirty = true;
+}
+
+static GLuint LinkShaderProgram(const ogl_shader_program& program,
+                                render_context& context)
 {
   renderable* renderableVertexShader =
     (renderable*)get(*context.RenderableStore, (uintptr_t)program.VertexShader);
@@ -320,15 +735,9 @@ static void CreateShader(const ogl_shader_program program,
   }
 
   GLuint programId = glCreateProgram();
-
-#if HOKI_DEV && !GL_ES_VERSION_3_0
-  // apply the name, -1 means NULL terminated
-  glObjectLabel(GL_PROGRAM, programId, -1, debug_to_string(program.Type));
-  HOKI_ASSERT_NO_OPENGL_ERRORS();
-#endif
-
   glAttachShader(programId, renderableVertexShader->RenderId);
   glAttachShader(programId, renderableFragmentShader->RenderId);
+  glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram(programId);
 
   int programLinkSuccess;
@@ -345,6 +754,27 @@ static void CreateShader(const ogl_shader_program program,
   glDeleteShader(renderableVertexShader->RenderId);
   glDeleteShader(renderableFragmentShader->RenderId);
 
+  return programId;
+}
+
+static void CreateShader(const ogl_shader_program program,
+                         render_context& context)
+{
+  shader_cache& cache = *context.ShaderCache;
+  ValidateShaderCache(cache);
+  const uint32_t sourceHash = GetProgramSourceHash(program);
+  GLuint programId = LoadCachedProgram(cache, sourceHash);
+  if (programId == HOKI_OGL_NO_ID) {
+    programId = LinkShaderProgram(program, context);
+    StoreProgramBinary(cache, programId, sourceHash);
+  }
+
+#if HOKI_DEV && !GL_ES_VERSION_3_0
+  // apply the name, -1 means NULL terminated
+  glObjectLabel(GL_PROGRAM, programId, -1, debug_to_string(program.Type));
+  HOKI_ASSERT_NO_OPENGL_ERRORS();
+#endif
+
   glUseProgram(programId);
   switch (program.Type) {
 #if HOKI_DEV
@@ -376,90 +806,53 @@ static void CreateShader(const ogl_shader_program program,
 
     case Asset::SHADER_TYPE_ANIMATED_MESH:
       context.AnimatedMeshShader = {};
-      context.AnimatedMeshShader.Id = programId;
-      context.AnimatedMeshShader.ModelMatrix =
-        SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
-      context.AnimatedMeshShader.ViewProjection =
-        SetupUniform(programId, "uViewProjection", SHADER_UNIFORM_MAT4);
-      context.AnimatedMeshShader.HasBones =
-        SetupUniform(programId, "uHasBones", SHADER_UNIFORM_BOOL);
-      context.AnimatedMeshShader.Bones =
-        SetupUniform(programId, "uBones", SHADER_UNIFORM_MAT4_ARRAY);
-      context.AnimatedMeshShader.LightSpaceMatrix =
-        SetupUniform(programId, "uLightSpaceMatrix", SHADER_UNIFORM_MAT4);
-      context.AnimatedMeshShader.CameraPos =
-        SetupUniform(programId, "uCameraPos", SHADER_UNIFORM_VEC3);
-      context.AnimatedMeshShader.Lights = SetupLightUniform(programId);
-      context.AnimatedMeshShader.Material = SetupMaterialUniform(programId);
-      context.AnimatedMeshShader.TextureDiffuse1 =
-        SetupUniform(programId, "uTexture_diffuse1", SHADER_UNIFORM_SAMPLER2D);
-      context.AnimatedMeshShader.TextureNormal1 =
-        SetupUniform(programId, "uTexture_normal1", SHADER_UNIFORM_SAMPLER2D);
-      context.AnimatedMeshShader.ShadowMap =
-        SetupUniform(programId, "uShadowMap", SHADER_UNIFORM_SAMPLER2D);
+      SetupSkinnedShader(programId, program, context.AnimatedMeshShader);
       break;
 
-    case Asset::SHADER_TYPE_PBR:
-      context.PbrShader = {};
-      context.PbrShader.Id = programId;
-      context.PbrShader.ModelMatrix =
-        SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
-      context.PbrShader.ViewProjection =
-        SetupUniform(programId, "uViewProjection", SHADER_UNIFORM_MAT4);
-      context.PbrShader.HasBones =
-        SetupUniform(programId, "uHasBones", SHADER_UNIFORM_BOOL);
-      context.PbrShader.LightSpaceMatrix =
-        SetupUniform(programId, "uLightSpaceMatrix", SHADER_UNIFORM_MAT4);
-      context.PbrShader.Bones =
-        SetupUniform(programId, "uBones", SHADER_UNIFORM_MAT4_ARRAY);
-      context.PbrShader.CameraPos =
-        SetupUniform(programId, "uCameraPos", SHADER_UNIFORM_VEC3);
-      context.PbrShader.Lights = SetupLightUniform(programId);
-      context.PbrShader.Material = SetupMaterialUniform(programId);
-      context.PbrShader.TextureDiffuse1 =
-        SetupUniform(programId, "uTexture_diffuse1", SHADER_UNIFORM_SAMPLER2D);
-      context.PbrShader.ShadowMap =
-        SetupUniform(programId, "uShadowMap", SHADER_UNIFORM_SAMPLER2D);
-      break;
+    case Asset::SHADER_TYPE_PBR: {
+      HOKI_ASSERT(program.Variant < Asset::PBR_VARIANT_COUNT);
+      ogl_shader_pbr& shader = context.PbrShaders[program.Variant];
+      shader = {};
+      SetupSkinnedShader(programId, program, shader);
+    } break;
 
-    case Asset::SHADER_TYPE_PBR_INSTANCED:
-      context.PbrInstancedShader = {};
-      context.PbrInstancedShader.Id = programId;
-      context.PbrInstancedShader.ModelMatrix =
-        SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
-      context.PbrInstancedShader.ViewProjection =
-        SetupUniform(programId, "uViewProjection", SHADER_UNIFORM_MAT4);
-      context.PbrInstancedShader.HasBones =
-        SetupUniform(programId, "uHasBones", SHADER_UNIFORM_BOOL);
-      context.PbrInstancedShader.LightSpaceMatrix =
-        SetupUniform(programId, "uLightSpaceMatrix", SHADER_UNIFORM_MAT4);
-      context.PbrInstancedShader.Bones =
-        SetupUniform(programId, "uBones", SHADER_UNIFORM_MAT4_ARRAY);
-      context.PbrInstancedShader.CameraPos =
-        SetupUniform(programId, "uCameraPos", SHADER_UNIFORM_VEC3);
-      context.PbrInstancedShader.Lights = SetupLightUniform(programId);
-      context.PbrInstancedShader.Material = SetupMaterialUniform(programId);
-      context.PbrInstancedShader.TextureDiffuse1 =
-        SetupUniform(programId, "uTexture_diffuse1", SHADER_UNIFORM_SAMPLER2D);
-      context.PbrInstancedShader.ShadowMap =
-        SetupUniform(programId, "uShadowMap", SHADER_UNIFORM_SAMPLER2D);
-      context.PbrInstancedShader.InstanceCount =
+    case Asset::SHADER_TYPE_PBR_INSTANCED: {
+      HOKI_ASSERT(program.Variant < Asset::PBR_VARIANT_COUNT);
+      ogl_shader_pbr_instanced& shader =
+        context.PbrInstancedShaders[program.Variant];
+      const bool skinned = program.Variant & Asset::PBR_VARIANT_SKINNED;
+      shader = {};
+      SetupSkinnedShader(programId, program, shader);
+      shader.InstanceCount =
         SetupUniform(programId, "uInstanceCount", SHADER_UNIFORM_INT);
-      context.PbrInstancedShader.InstanceSpacing =
+      shader.InstanceSpacing =
         SetupUniform(programId, "uInstanceSpacing", SHADER_UNIFORM_VEC3);
-      break;
+      shader.InstanceOffset =
+        SetupUniform(programId, "uInstanceOffset", SHADER_UNIFORM_INT);
+      // Baked poses only skin, static variants leave them out
+      shader.HasBakedPose = SetupVariantUniform(
+        programId, "uHasBakedPose", SHADER_UNIFORM_BOOL, skinned);
+      shader.BakedPose = SetupVariantUniform(
+        programId, "uBakedPose", SHADER_UNIFORM_SAMPLER2D, skinned);
+      shader.BakedFrameCount = SetupVariantUniform(
+        programId, "uBakedFrameCount", SHADER_UNIFORM_INT, skinned);
+      shader.BakedFrame = SetupVariantUniform(
+        programId, "uBakedFrame", SHADER_UNIFORM_FLOAT, skinned);
+      SetSamplerUniform(shader.BakedPose, TEXTURE_UNIT_BAKED_POSE);
+    } break;
 
     case Asset::SHADER_TYPE_TEXT:
       context.TextShader = {};
       context.TextShader.Id = programId;
-      context.TextShader.ModelMatrix =
-        SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
       context.TextShader.ViewProjection =
         SetupUniform(programId, "uProjection", SHADER_UNIFORM_MAT4);
       context.TextShader.TextColor =
         SetupUniform(programId, "uTextColor", SHADER_UNIFORM_VEC3);
       context.TextShader.CharacterTexture =
         SetupUniform(programId, "uCharacterTexture", SHADER_UNIFORM_SAMPLER2D);
+      context.TextShader.ShadowOffset =
+        SetupUniform(programId, "uShadowOffset", SHADER_UNIFORM_VEC2);
+      SetSamplerUniform(context.TextShader.CharacterTexture, 0);
       break;
 
     case Asset::SHADER_TYPE_SHADOW:
@@ -469,12 +862,9 @@ static void CreateShader(const ogl_shader_program program,
         SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
       context.ShadowShader.ViewProjection =
         SetupUniform(programId, "uViewProjection", SHADER_UNIFORM_MAT4);
-      context.ShadowShader.Bones =
-        SetupUniform(programId, "uBones", SHADER_UNIFORM_MAT4_ARRAY);
-      context.ShadowShader.CameraPos =
-        SetupUniform(programId, "uCameraPos", SHADER_UNIFORM_VEC3);
       context.ShadowShader.HasBones =
         SetupUniform(programId, "uHasBones", SHADER_UNIFORM_BOOL);
+      SetupUniformBlock(programId, "BoneBlock", UNIFORM_BLOCK_BONES);
 
       break;
 
@@ -489,11 +879,10 @@ static void CreateShader(const ogl_shader_program program,
         SetupUniform(programId, "uModelMatrix", SHADER_UNIFORM_MAT4);
       context.UIShader.ViewProjection =
         SetupUniform(programId, "uViewProjection", SHADER_UNIFORM_MAT4);
-      context.UIShader.TextureCoordOffset =
-        SetupUniform(programId, "uTextureOffset", SHADER_UNIFORM_VEC2);
       context.UIShader.TextureDiffuse1 =
         SetupUniform(programId, "uTexture_diffuse1", SHADER_UNIFORM_SAMPLER2D);
       context.UIShader.Id = programId;
+      SetSamplerUniform(context.UIShader.TextureDiffuse1, 0);
       break;
 
     default:
@@ -3,29 +3,34 @@
 using Asset::glyph;
 using UISystem::ui_text;
 
-static uint32_t BindCharacterTexture(glyph& character, int characterCode)
+/** Glyph atlas */
+// Gap between glyphs, nearest sampling never reaches it
+static const uint32_t GLYPH_ATLAS_PADDING = 1;
+
+// Resident ids of glyphs point at their slot, zero stays free
+static uint32_t GetGlyphSlotId(const size_t atlasIndex, const size_t slotIndex)
+{
+  return (uint32_t)(atlasIndex * MAX_GLYPH_ATLAS_SLOTS + slotIndex + 1);
+}
+
+static uint32_t CreateGlyphAtlasTexture()
 {
   GLuint textureId;
-  // Generate texture
   glGenTextures(1, &textureId);
   glBindTexture(GL_TEXTURE_2D, textureId);
 #if HOKI_DEV && !GL_ES_VERSION_3_0
-  // apply the name, -1 means NULL terminated
-  char buffer[50];
-  sprintf_s(buffer, sizeof(buffer), "char_%c", characterCode);
-  glObjectLabel(GL_TEXTURE, textureId, -1, buffer);
+  glObjectLabel(GL_TEXTURE, textureId, -1, "glyph_atlas");
 #endif
   glTexImage2D(GL_TEXTURE_2D,
                0,
                GL_R8,
-               (uint32_t)character.PixelSize.X,
-               (uint32_t)character.PixelSize.Y,
+               GLYPH_ATLAS_SIZE,
+               GLYPH_ATLAS_SIZE,
                0,
                GL_RED,
                GL_UNSIGNED_BYTE,
-               character.Memory);
+               nullptr);
 
-  // Set texture options
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -34,6 +39,239 @@ static uint32_t BindCharacterTexture(glyph& character, int characterCode)
   return textureId;
 }
 
+// Empties the shelf, or every shelf with GLYPH_ATLAS_ALL_SHELVES
+static const uint32_t GLYPH_ATLAS_ALL_SHELVES = UINT32_MAX;
+static void EvictGlyphs(render_context& context,
+                        glyph_atlas& atlas,
+                        const uint32_t shelfIndex)
+{
+  for (size_t i = 0; i < MAX_GLYPH_ATLAS_SLOTS; i++) {
+    glyph_atlas_slot& slot = atlas.Slots[i];
+    if (slot.GlyphHandle == RENDER_NO_HANDLE ||
+        (shelfIndex != GLYPH_ATLAS_ALL_SHELVES && slot.Shelf != shelfIndex)) {
+      continue;
+    }
+    GetResidentId(context, slot.GlyphHandle) = HOKI_OGL_NO_ID;
+    slot.GlyphHandle = RENDER_NO_HANDLE;
+  }
+
+  if (shelfIndex == GLYPH_ATLAS_ALL_SHELVES) {
+    atlas.ShelfCount = 0;
+  } else {
+    atlas.Shelves[shelfIndex].CursorX = 0;
+  }
+}
+
+static size_t GetGlyphAtlas(render_context& context,
+                            const Asset::glyph_table* glyphTable)
+{
+  size_t oldest = 0;
+  for (size_t i = 0; i < MAX_GLYPH_ATLASES; i++) {
+    const glyph_atlas& atlas = context.GlyphAtlases[i];
+    if (atlas.GlyphTable == glyphTable && atlas.TextureId != HOKI_OGL_NO_ID) {
+      return i;
+    }
+    if (atlas.LastUsed < context.GlyphAtlases[oldest].LastUsed) {
+      oldest = i;
+    }
+  }
+
+  glyph_atlas& atlas = context.GlyphAtlases[oldest];
+  EvictGlyphs(context, atlas, GLYPH_ATLAS_ALL_SHELVES);
+  atlas.GlyphTable = glyphTable;
+  if (atlas.TextureId == HOKI_OGL_NO_ID) {
+    atlas.TextureId = CreateGlyphAtlasTexture();
+  }
+
+  return oldest;
+}
+
+/**
+ * Picks the shortest shelf the glyph fits on, opens a new one below the last,
+ * or empties the least recently used shelf that is tall enough. Shelves used
+ * by the text being batched are kept. Returns -1 when nothing fits.
+ */
+static int32_t AllocateGlyphShelf(render_context& context,
+                                  glyph_atlas& atlas,
+                                  const uint32_t width,
+                                  const uint32_t height)
+{
+  if (width > GLYPH_ATLAS_SIZE || height > GLYPH_ATLAS_SIZE) {
+    return -1;
+  }
+
+  int32_t result = -1;
+  for (uint32_t i = 0; i < atlas.ShelfCount; i++) {
+    const glyph_atlas_shelf& shelf = atlas.Shelves[i];
+    if (shelf.Height >= height && shelf.CursorX + width <= GLYPH_ATLAS_SIZE &&
+        (result < 0 || shelf.Height < atlas.Shelves[result].Height)) {
+      result = (int32_t)i;
+    }
+  }
+  if (result >= 0) {
+    return result;
+  }
+
+  if (atlas.ShelfCount < MAX_GLYPH_ATLAS_SHELVES) {
+    uint32_t bottom = 0;
+    if (atlas.ShelfCount > 0) {
+      const glyph_atlas_shelf& last = atlas.Shelves[atlas.ShelfCount - 1];
+      bottom = last.Y + last.Height;
+    }
+    if (bottom + height <= GLYPH_ATLAS_SIZE) {
+      glyph_atlas_shelf& shelf = atlas.Shelves[atlas.ShelfCount];
+      shelf = {};
+      shelf.Y = bottom;
+      shelf.Height = height;
+      return (int32_t)atlas.ShelfCount++;
+    }
+  }
+
+  for (uint32_t i = 0; i < atlas.ShelfCount; i++) {
+    const glyph_atlas_shelf& shelf = atlas.Shelves[i];
+    if (shelf.Height >= height && shelf.LastUsed < context.TextClock &&
+        (result < 0 || shelf.LastUsed < atlas.Shelves[result].LastUsed)) {
+      result = (int32_t)i;
+    }
+  }
+  if (result >= 0) {
+    EvictGlyphs(context, atlas, (uint32_t)result);
+  }
+
+  return result;
+}
+
+// Places the glyph in the atlas on first use, nullptr when it is full or the
+// glyph has no handle
+static const glyph_atlas_slot* GetGlyphSlot(render_context& context,
+                                            const size_t atlasIndex,
+                                            const glyph& info)
+{
+  if (info.RenderHandle == RENDER_NO_HANDLE) {
+    return nullptr;
+  }
+
+  glyph_atlas& atlas = context.GlyphAtlases[atlasIndex];
+  uint32_t& slotId = GetResidentId(context, info.RenderHandle);
+  if (slotId == HOKI_OGL_NO_ID) {
+    const uint32_t width = (uint32_t)info.PixelSize.X;
+    const uint32_t height = (uint32_t)info.PixelSize.Y;
+    const int32_t shelfIndex =
+      AllocateGlyphShelf(context,
+                         atlas,
+                         width + GLYPH_ATLAS_PADDING,
+                         height + GLYPH_ATLAS_PADDING);
+
+    size_t slotIndex = 0;
+    while (slotIndex < MAX_GLYPH_ATLAS_SLOTS &&
+           atlas.Slots[slotIndex].GlyphHandle != RENDER_NO_HANDLE) {
+      slotIndex++;
+    }
+    if (shelfIndex < 0 || slotIndex == MAX_GLYPH_ATLAS_SLOTS) {
+      HOKI_WARN_MESSAGE(false, "Glyph atlas full, skipping a glyph", 0);
+      return nullptr;
+    }
+
+    glyph_atlas_shelf& shelf = atlas.Shelves[shelfIndex];
+    const uint32_t x = shelf.CursorX;
+    const uint32_t y = shelf.Y;
+    shelf.CursorX += width + GLYPH_ATLAS_PADDING;
+
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    x,
+                    y,
+                    width,
+                    height,
+                    GL_RED,
+                    GL_UNSIGNED_BYTE,
+                    info.Memory);
+
+    glyph_atlas_slot& slot = atlas.Slots[slotIndex];
+    slot.GlyphHandle = info.RenderHandle;
+    slot.Shelf = (uint32_t)shelfIndex;
+    slot.UvMin = _v2((float)x, (float)y) * (1.0f / GLYPH_ATLAS_SIZE);
+    slot.UvMax =
+      _v2((float)(x + width), (float)(y + height)) * (1.0f / GLYPH_ATLAS_SIZE);
+    slotId = GetGlyphSlotId(atlasIndex, slotIndex);
+  }
+
+  HOKI_ASSERT((slotId - 1) / MAX_GLYPH_ATLAS_SLOTS == atlasIndex);
+  const glyph_atlas_slot& slot =
+    atlas.Slots[(slotId - 1) % MAX_GLYPH_ATLAS_SLOTS];
+  atlas.Shelves[slot.Shelf].LastUsed = context.TextClock;
+
+  return &slot;
+}
+
+/** Text batch */
+static void BindTextVertexArray(render_context& context)
+{
+  if (context.TextVertexArray != HOKI_OGL_NO_ID) {
+    glBindVertexArray(context.TextVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, context.TextVertexBuffer);
+    return;
+  }
+
+  glGenVertexArrays(1, &context.TextVertexArray);
+  glGenBuffers(1, &context.TextVertexBuffer);
+  glBindVertexArray(context.TextVertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, context.TextVertexBuffer);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,
+                        2,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(text_vertex),
+                        (void*)offsetof(text_vertex, Position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,
+                        2,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(text_vertex),
+                        (void*)offsetof(text_vertex, TexCoords));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2,
+                        1,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(text_vertex),
+                        (void*)offsetof(text_vertex, Shadow));
+}
+
+// The shadow copy goes first, the shader offsets it and draws it black
+static void PushGlyphQuads(text_vertex* vertices,
+                           const v2 position,
+                           const v2 size,
+                           const glyph_atlas_slot& slot)
+{
+  const v2 uvSize = slot.UvMax - slot.UvMin;
+  for (int copy = 0; copy < 2; copy++) {
+    for (int i = 0; i < 6; i++) {
+      text_vertex& vertex = vertices[copy * 6 + i];
+      vertex.Position = position + hadamard_multiply(RECT_CORNERS[i], size);
+      vertex.TexCoords =
+        slot.UvMin + hadamard_multiply(RECT_CORNERS[i], uvSize);
+      vertex.Shadow = copy == 0 ? 1.0f : 0.0f;
+    }
+  }
+}
+
+static void DrawTextBatch(render_context& context, const uint32_t vertexCount)
+{
+  if (vertexCount == 0) {
+    return;
+  }
+
+  glBufferData(GL_ARRAY_BUFFER,
+               sizeof(text_vertex) * vertexCount,
+               context.TextVertices,
+               GL_STREAM_DRAW);
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertexCount);
+}
+
 static bool HandleSpecial(const int character,
                           const v2 scaledBearing,
                           const float originOffset,
@@ -64,6 +302,11 @@ static bool HandleSpecial(const int character,
   }
 }
 
+/**
+ * A string is one draw, glyphs come from the atlas of its glyph table. The
+ * batch only flushes early when the string has more than
+ * MAX_TEXT_BATCH_GLYPHS glyphs.
+ */
 static void RenderText(const UISystem::ui_text* text,
                        const game_window_info windowInfo,
                        render_context& context)
@@ -74,6 +317,7 @@ static void RenderText(const UISystem::ui_text* text,
 
   v3 color = _v3(1.0f, 1.0f, 0.0f);
   SetUniform(context.TextShader.ViewProjection, &uiContext->ViewProjection, 1);
+  SetUniform(context.TextShader.TextColor, &color, 1);
 
   float fontSize = ceilf(text->PixelHeight / 10.0f) * 10.0f;
   float fontScale = text->PixelHeight / fontSize;
@@ -81,6 +325,18 @@ static void RenderText(const UISystem::ui_text* text,
     _v2(1.0f / (float)windowInfo.Width, 1.0f / (float)windowInfo.Height);
   v2 textPos = text->Position;
   float scaledOffset = text->OriginOffset * screenScale.Y;
+  SetUniform(context.TextShader.ShadowOffset, &screenScale, 1);
+
+  context.TextClock++;
+  const size_t atlasIndex = GetGlyphAtlas(context, text->GlyphTable);
+  glyph_atlas& atlas = context.GlyphAtlases[atlasIndex];
+  atlas.LastUsed = context.TextClock;
+
+  // New glyphs are uploaded through the same binding
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, atlas.TextureId);
+  BindTextVertexArray(context);
+  uint32_t vertexCount = 0;
 
   uint32_t* currentCharacterEntry = text->CodepointData.Codepoints;
   while (*currentCharacterEntry) {
@@ -95,7 +351,6 @@ static void RenderText(const UISystem::ui_text* text,
       hadamard_multiply(info->PixelBearing * fontScale, screenScale);
 
     // Special characters
-    v2 specialOffset = _v2(0.0f);
     if (HandleSpecial(codepoint,
                       scaledBearing,
                       scaledOffset,
@@ -105,42 +360,29 @@ static void RenderText(const UISystem::ui_text* text,
       continue;
     }
 
-    GLuint rectVAO = BindRect(context);
+    const glyph_atlas_slot* slot = GetGlyphSlot(context, atlasIndex, *info);
+    if (slot != nullptr) {
+      if (vertexCount + TEXT_VERTICES_PER_GLYPH >
+          ARRAY_SIZE(context.TextVertices)) {
+        DrawTextBatch(context, vertexCount);
+        vertexCount = 0;
+      }
 
-    renderable* glyphTexture =
-      (renderable*)get(*context.RenderableStore, (uintptr_t)info);
-    if (glyphTexture->RenderId == HOKI_OGL_NO_ID) {
-      glyphTexture->RenderId = BindCharacterTexture(*info, codepoint);
+      v2 charPos = textPos + scaledBearing;
+      charPos.Y += scaledOffset;
+      PushGlyphQuads(
+        context.TextVertices + vertexCount,
+        charPos,
+        hadamard_multiply(info->PixelSize * fontScale, screenScale),
+        *slot);
+      vertexCount += TEXT_VERTICES_PER_GLYPH;
     }
-    glBindVertexArray(rectVAO);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, glyphTexture->RenderId);
-    SetSamplerUniform(context.TextShader.CharacterTexture, 0);
-
-    v2 charPos = textPos + scaledBearing;
-    charPos.Y += scaledOffset;
-
-    // Shadow
-    SetUniform(context.TextShader.TextColor, &COLOR_BLACK, 1);
-    mat4x4 modelMatrix =
-      IDENTITY_MATRIX * mat4x4_translate(_v3(charPos + screenScale, 0.0f)) *
-      mat4x4_scale(
-        _v3(hadamard_multiply(info->PixelSize * fontScale, screenScale), 0.0f));
-    SetUniform(context.TextShader.ModelMatrix, &modelMatrix, 1);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // Text
-    SetUniform(context.TextShader.TextColor, &color, 1);
-    // Optimization: Move the shadow model matrix to draw the actual text
-    modelMatrix.M[3][0] = modelMatrix.M[3][0] - screenScale.X;
-    modelMatrix.M[3][1] = modelMatrix.M[3][1] - screenScale.Y;
-    SetUniform(context.TextShader.ModelMatrix, &modelMatrix, 1);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
 
     textPos.X += info->PixelAdvance * fontScale * screenScale.X;
   }
 
+  DrawTextBatch(context, vertexCount);
+
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
   glBindTexture(GL_TEXTURE_2D, 0);
@@ -10,7 +10,10 @@ layout (location = 5) in vec4 aBoneWeights;
 uniform bool uHasBones;
 uniform mat4 uModelMatrix;
 uniform mat4 uViewProjection;
-uniform mat4 uBones[MAX_BONES];
+layout (std140) uniform BoneBlock
+{
+    mat4 uBones[MAX_BONES];
+};
 
 void main()
 {
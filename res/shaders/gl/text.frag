@@ -1,6 +1,7 @@
 #version 330 core
 
 in vec2 TexCoords;
+flat in float Shadow;
 
 uniform sampler2D uCharacterTexture;
 uniform vec3 uTextColor;
@@ -11,7 +12,8 @@ void main()
 {
   vec4 sampled = vec4(1.0, 1.0, 1.0, texture(uCharacterTexture, TexCoords).r);
 
-  vec3 color = uTextColor;
+  // The drop shadow is always black
+  vec3 color = mix(uTextColor, vec3(0.0), Shadow);
 
   FragColor = vec4(color, sampled.a) * sampled;
 }
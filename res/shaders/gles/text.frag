@@ -2,6 +2,7 @@
 precision highp float;
 
 in vec2 TexCoords;
+flat in float Shadow;
 
 uniform sampler2D uCharacterTexture;
 uniform vec3 uTextColor;
@@ -12,7 +13,8 @@ void main()
 {
     vec4 sampled = vec4(1.0, 1.0, 1.0, texture(uCharacterTexture, TexCoords).r);
 
-    vec3 color = uTextColor;
+    // The drop shadow is always black
+    vec3 color = mix(uTextColor, vec3(0.0), Shadow);
 
     FragColor = vec4(color, 1.0) * sampled;
 }
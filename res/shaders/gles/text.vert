@@ -1,15 +1,18 @@
 #version 300 es
 precision highp float;
-layout (location = 0) in vec2 vertex; // <vec2 pos, vec2 tex>
-layout (location = 1) in vec2 texCoords; // <vec2 pos, vec2 tex>
+layout (location = 0) in vec2 vertex;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in float shadow; // 1.0 for the drop shadow copy
 
 out vec2 TexCoords;
+flat out float Shadow;
 
 uniform mat4 uProjection;
-uniform mat4 uModelMatrix;
+uniform vec2 uShadowOffset;
 
 void main()
 {
-    gl_Position = uProjection * uModelMatrix * vec4(vertex, 0.0, 1.0);
+    gl_Position = uProjection * vec4(vertex + uShadowOffset * shadow, 0.0, 1.0);
     TexCoords = texCoords;
+    Shadow = shadow;
 }
@@ -332,6 +332,10 @@ static PLATFORM_GET_FILE_SIZE(WinGetFileSize)
   wchar_t wString[4096];
   MultiByteToWideChar(CP_UTF8, 0, fullPath, -1, wString, 4096);
   DWORD shortPathLength = GetShortPathNameW(wString, NULL, 0);
+  // Missing files are empty, loading an asset asserts on it
+  if (shortPathLength == 0) {
+    return 0;
+  }
   wchar_t shortPath[MAX_PATH];
   GetShortPathNameW(wString, shortPath, shortPathLength);
   DWORD kek = GetLastError();
@@ -1174,6 +1178,14 @@ int CALLBACK WinMain(HINSTANCE hInstance,
               code = INPUT_CODE_NUM_5;
               break;
 
+            case '6':
+              code = INPUT_CODE_NUM_6;
+              break;
+
+            case '7':
+              code = INPUT_CODE_NUM_7;
+              break;
+
             case VK_F4:
               if (!altKeyDown) {
                 break;
@@ -1283,7 +1295,6 @@ int CALLBACK WinMain(HINSTANCE hInstance,
         &GlobalPlaybackLoop, &InputBuffer, secElapsedForFrame);
     }
 
-    RenderContext.Commands.Count = 0;
     gameCode.GameMain(
       Memory, gameWindowInfo, RenderContext, InputBuffer, secElapsedForFrame);
     GlobalRenderer.RendererMain(gameWindowInfo, RenderContext);